@@ -0,0 +1,36 @@
+#ifndef QFrustumCuller_h__
+#define QFrustumCuller_h__
+
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QVector4D>
+#include <vector>
+
+// CPU视锥剔除：节点的包围盒与包围球（球心取包围盒中心）按SoA存放，每帧从 投影*观察 矩阵提取六个裁剪平面，
+// 用SSE一次测试四个节点，输出可见节点的下标。包围球与包围盒都完整包住节点，任一个位于某个平面之外即剔除
+// 平面按OpenGL的裁剪范围（-w<=z<=w）提取，比Vulkan的0<=z<=w更保守
+class QFrustumCuller {
+public:
+	void clear();
+	void addNode(const QVector3D& min, const QVector3D& max, float radius);
+	int nodeCount() const { return nodeCount_; }
+
+	const std::vector<uint32_t>& cull(const QMatrix4x4& viewProj);			//不支持SSE时退回标量实现
+	const std::vector<uint32_t>& cullScalar(const QMatrix4x4& viewProj);
+	const std::vector<uint32_t>& visibleNodes() const { return visible_; }
+
+	static void extractPlanes(const QMatrix4x4& viewProj, QVector4D planes[6]);		//法线已归一化并指向视锥内部
+	static void benchmark(const std::vector<int>& sizes, int iterations);			//随机节点上的剔除吞吐量（节点/微秒）
+private:
+	int nodeCount_ = 0;
+	std::vector<float> centerX_;			//各数组长度补齐到4的倍数，补齐的部分不会输出
+	std::vector<float> centerY_;
+	std::vector<float> centerZ_;
+	std::vector<float> extentX_;			//包围盒的半长
+	std::vector<float> extentY_;
+	std::vector<float> extentZ_;
+	std::vector<float> radius_;
+	std::vector<uint32_t> visible_;
+};
+
+#endif // QFrustumCuller_h__
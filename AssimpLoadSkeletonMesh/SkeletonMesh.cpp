@@ -35,6 +35,12 @@ SkeletonMesh::SkeletonMesh(QVulkanWindow* window, std::string file_path)
 	boneRoot_ = processBoneNode(scene->mRootNode);
 	processNode(scene->mRootNode, scene, aiMatrix4x4());
 	processAnimations(scene);
+	// 包围体按绑定姿态计算：目前mesh_vert不做蒙皮，顶点即绑定姿态
+	for (uint32_t i = 0; i < meshes_.size(); i++) {
+		const SkeletonMeshNode& mesh = *meshes_[i];
+		frustumCuller_.addNode(QVector3D(mesh.cullMin_.x, mesh.cullMin_.y, mesh.cullMin_.z), QVector3D(mesh.cullMax_.x, mesh.cullMax_.y, mesh.cullMax_.z), mesh.cullRadius_);
+		allNodes_.push_back(i);
+	}
 }
 
 void SkeletonMesh::initVulkanResource()
@@ -55,19 +61,25 @@ void SkeletonMesh::releaseVulkanResource()
 	device_.destroyDescriptorSetLayout(descSetLayout_);
 	device_.destroySampler(commonSampler_);
 	meshes_.clear();
+	frustumCuller_.clear();
+	allNodes_.clear();
 	textures_.clear();
 	textureSet_.clear();
 }
 
 void SkeletonMesh::makeRenderCommand(vk::CommandBuffer& cmdBuffer, QMatrix4x4 matrix)
 {
+	QMatrix4x4 flipY;
+	flipY.scale(1, -1, 1);
+	const std::vector<uint32_t>& nodes = frustumCulling_ ? frustumCuller_.cull(matrix * flipY) : allNodes_;		//包围体已应用节点矩阵
+	drawnNodeCount_ = nodes.size();
+
 	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipline_);
-	for (auto& mesh : meshes_)
+	for (uint32_t i : nodes)
 	{
+		auto& mesh = meshes_[i];
 		QMatrix4x4 localMatrix;
 		memcpy(localMatrix.data(), &mesh->localMatrix_, sizeof(aiMatrix4x4));
-		QMatrix4x4 flipY;
-		flipY.scale(1, -1, 1);
 		QMatrix4x4 mvp = matrix * flipY * localMatrix.transposed();
 		cmdBuffer.pushConstants(piplineLayout_, vk::ShaderStageFlagBits::eVertex, 0, sizeof(float) * 16, mvp.constData());
 
@@ -6,6 +6,7 @@
 #include <map>
 #include "SkeletonMeshNode.h"
 #include "QFpsCamera.h"
+#include "QFrustumCuller.h"
 #include "QVulkanWindow"
 #include "SkeletonAnimation.h"
 
@@ -16,6 +17,10 @@ public:
 	void initVulkanResource();
 	void releaseVulkanResource();
 	void makeRenderCommand(vk::CommandBuffer& cmdBuffer, QMatrix4x4 matrix);
+	void setFrustumCulling(bool enabled) { frustumCulling_ = enabled; }
+	bool frustumCulling() const { return frustumCulling_; }
+	int nodeCount() const { return meshes_.size(); }
+	int drawnNodeCount() const { return drawnNodeCount_; }		//最近一帧通过视锥剔除的节点数
 protected:
 	void initVulkanTexture();
 	void initVulkanDescriptor();
@@ -48,6 +53,11 @@ private:
 	vk::PipelineCache piplineCache_;
 	vk::PipelineLayout piplineLayout_;
 	vk::Pipeline pipline_;
+
+	bool frustumCulling_ = true;
+	QFrustumCuller frustumCuller_;			//与meshes_一一对应，在导入时填充
+	std::vector<uint32_t> allNodes_;		//关闭视锥剔除时使用的全部节点下标
+	int drawnNodeCount_ = 0;
 };
 
 #endif // SkeletonMesh_h__
\ No newline at end of file
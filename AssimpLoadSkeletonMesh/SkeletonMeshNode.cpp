@@ -1,5 +1,6 @@
 #include "SkeletonMeshNode.h"
 #include "SkeletonMesh.h"
+#include <algorithm>
 
 SkeletonMeshNode::SkeletonMeshNode(SkeletonMesh* model, const aiMesh* mesh, const aiScene* scene, aiMatrix4x4 matrix)
 	: model_(model)
@@ -25,6 +26,17 @@ SkeletonMeshNode::SkeletonMeshNode(SkeletonMesh* model, const aiMesh* mesh, cons
 		}
 		vertices_[i] = vertex;
 	}
+	if (mesh->mNumVertices > 0) {
+		cullMin_ = cullMax_ = matrix * mesh->mVertices[0];
+		for (unsigned int i = 1; i < mesh->mNumVertices; i++) {
+			const aiVector3D position = matrix * mesh->mVertices[i];
+			cullMin_ = aiVector3D(std::min(cullMin_.x, position.x), std::min(cullMin_.y, position.y), std::min(cullMin_.z, position.z));
+			cullMax_ = aiVector3D(std::max(cullMax_.x, position.x), std::max(cullMax_.y, position.y), std::max(cullMax_.z, position.z));
+		}
+		const aiVector3D center = (cullMin_ + cullMax_) * 0.5f;
+		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+			cullRadius_ = std::max(cullRadius_, (matrix * mesh->mVertices[i] - center).Length());
+	}
 	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
 		aiFace face = mesh->mFaces[i];
 		for (unsigned int j = 0; j < face.mNumIndices; j++) {
@@ -47,6 +47,9 @@ public:
 	std::vector<unsigned int> indices_;
 	aiMatrix4x4 localMatrix_;
 	uint32_t materialIndex_ = 0;
+	aiVector3D cullMin_;			//应用节点矩阵后的包围盒与包围球（球心为包围盒中心），按绑定姿态计算，用于视锥剔除
+	aiVector3D cullMax_;
+	float cullRadius_ = 0.0f;
 
 	vk::Buffer buffer_;
 	vk::DeviceMemory bufferMemory_;
@@ -10,6 +10,7 @@ class SkeletonMeshRenderer : public QVulkanWindowRenderer {
 	friend class SkeletonMeshNode;
 public:
 	SkeletonMeshRenderer(QVulkanWindow* window);
+	void setFrustumCulling(bool enabled) { staticMesh_.setFrustumCulling(enabled); }
 protected:
 	void initResources() override;
 	void initSwapChainResources() override;
@@ -11,9 +11,12 @@ Q_LOGGING_CATEGORY(lcVk, "qt.vulkan")
 class VulkanWindow : public QVulkanWindow {
 public:
 	QVulkanWindowRenderer* createRenderer() override {
-		return staitcMesh_ = new SkeletonMeshRenderer(this);
+		staitcMesh_ = new SkeletonMeshRenderer(this);
+		staitcMesh_->setFrustumCulling(frustumCulling_);
+		return staitcMesh_;
 	}
 	SkeletonMeshRenderer* staitcMesh_;
+	bool frustumCulling_ = true;
 };
 
 int main(int argc, char* argv[]) {
@@ -30,6 +33,7 @@ int main(int argc, char* argv[]) {
 	QLoggingCategory::setFilterRules(QStringLiteral("qt.vulkan=true"));
 
 	VulkanWindow vkWindow;
+	vkWindow.frustumCulling_ = !app.arguments().contains("--no-frustum");		//关闭视锥剔除，用于对比
 	vkWindow.setVulkanInstance(&instance);
 	vkWindow.resize(1024, 768);
 	vkWindow.show();
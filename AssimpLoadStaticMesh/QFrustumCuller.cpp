@@ -0,0 +1,161 @@
+#include "QFrustumCuller.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_CULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+void QFrustumCuller::clear()
+{
+	nodeCount_ = 0;
+	for (std::vector<float>* values : { &centerX_, &centerY_, &centerZ_, &extentX_, &extentY_, &extentZ_, &radius_ })
+		values->clear();
+	visible_.clear();
+}
+
+void QFrustumCuller::addNode(const QVector3D& min, const QVector3D& max, float radius)
+{
+	if (nodeCount_ % 4 == 0) {
+		for (std::vector<float>* values : { &centerX_, &centerY_, &centerZ_, &extentX_, &extentY_, &extentZ_, &radius_ })
+			values->resize(nodeCount_ + 4, 0.0f);
+	}
+	const QVector3D center = (min + max) * 0.5f;
+	const QVector3D extent = (max - min) * 0.5f;
+	centerX_[nodeCount_] = center.x();
+	centerY_[nodeCount_] = center.y();
+	centerZ_[nodeCount_] = center.z();
+	extentX_[nodeCount_] = extent.x();
+	extentY_[nodeCount_] = extent.y();
+	extentZ_[nodeCount_] = extent.z();
+	radius_[nodeCount_] = radius;
+	nodeCount_++;
+	visible_.reserve(nodeCount_);
+}
+
+void QFrustumCuller::extractPlanes(const QMatrix4x4& viewProj, QVector4D planes[6])
+{
+	const QVector4D row0 = viewProj.row(0);
+	const QVector4D row1 = viewProj.row(1);
+	const QVector4D row2 = viewProj.row(2);
+	const QVector4D row3 = viewProj.row(3);
+	planes[0] = row3 + row0;		//左
+	planes[1] = row3 - row0;		//右
+	planes[2] = row3 + row1;		//下
+	planes[3] = row3 - row1;		//上
+	planes[4] = row3 + row2;		//近
+	planes[5] = row3 - row2;		//远
+	for (int i = 0; i < 6; i++) {
+		const float length = planes[i].toVector3D().length();
+		if (length > 0.0f)
+			planes[i] /= length;
+	}
+}
+
+const std::vector<uint32_t>& QFrustumCuller::cullScalar(const QMatrix4x4& viewProj)
+{
+	QVector4D planes[6];
+	extractPlanes(viewProj, planes);
+	visible_.clear();
+	for (int i = 0; i < nodeCount_; i++) {
+		bool inside = true;
+		for (int j = 0; j < 6 && inside; j++) {
+			const QVector4D& plane = planes[j];
+			const float distance = plane.x() * centerX_[i] + plane.y() * centerY_[i] + plane.z() * centerZ_[i] + plane.w();
+			const float boxRadius = std::abs(plane.x()) * extentX_[i] + std::abs(plane.y()) * extentY_[i] + std::abs(plane.z()) * extentZ_[i];
+			inside = distance + std::min(radius_[i], boxRadius) >= 0.0f;
+		}
+		if (inside)
+			visible_.push_back(i);
+	}
+	return visible_;
+}
+
+const std::vector<uint32_t>& QFrustumCuller::cull(const QMatrix4x4& viewProj)
+{
+#ifdef FRUSTUM_CULLER_SSE
+	QVector4D planes[6];
+	extractPlanes(viewProj, planes);
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int j = 0; j < 6; j++) {
+		planeX[j] = _mm_set1_ps(planes[j].x());
+		planeY[j] = _mm_set1_ps(planes[j].y());
+		planeZ[j] = _mm_set1_ps(planes[j].z());
+		planeW[j] = _mm_set1_ps(planes[j].w());
+		absX[j] = _mm_set1_ps(std::abs(planes[j].x()));
+		absY[j] = _mm_set1_ps(std::abs(planes[j].y()));
+		absZ[j] = _mm_set1_ps(std::abs(planes[j].z()));
+	}
+	const __m128 zero = _mm_setzero_ps();
+	visible_.clear();
+	for (int i = 0; i < nodeCount_; i += 4) {
+		const __m128 centerX = _mm_loadu_ps(centerX_.data() + i);
+		const __m128 centerY = _mm_loadu_ps(centerY_.data() + i);
+		const __m128 centerZ = _mm_loadu_ps(centerZ_.data() + i);
+		const __m128 extentX = _mm_loadu_ps(extentX_.data() + i);
+		const __m128 extentY = _mm_loadu_ps(extentY_.data() + i);
+		const __m128 extentZ = _mm_loadu_ps(extentZ_.data() + i);
+		const __m128 radius = _mm_loadu_ps(radius_.data() + i);
+		__m128 outside = zero;
+		for (int j = 0; j < 6; j++) {
+			// 运算顺序与标量实现一致，两者的结果逐位相同
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[j], centerX), _mm_mul_ps(planeY[j], centerY)), _mm_mul_ps(planeZ[j], centerZ)), planeW[j]);
+			const __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[j], extentX), _mm_mul_ps(absY[j], extentY)), _mm_mul_ps(absZ[j], extentZ));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, _mm_min_ps(radius, boxRadius)), zero));
+		}
+		const int mask = ~_mm_movemask_ps(outside) & 0xF;
+		for (int j = 0; j < 4; j++) {
+			if ((mask & (1 << j)) && i + j < nodeCount_)
+				visible_.push_back(i + j);
+		}
+	}
+	return visible_;
+#else
+	return cullScalar(viewProj);
+#endif
+}
+
+void QFrustumCuller::benchmark(const std::vector<int>& sizes, int iterations)
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> extent(0.1f, 2.0f);
+	std::uniform_real_distribution<float> tightness(0.6f, 1.0f);			//顶点包围球通常比包围盒的外接球更小
+	QMatrix4x4 viewProj;
+	viewProj.perspective(45.0f, 4.0f / 3.0f, 0.1f, 1000.0f);
+	viewProj.lookAt(QVector3D(0.0f, 0.0f, 0.0f), QVector3D(1.0f, 0.0f, 1.0f), QVector3D(0.0f, 1.0f, 0.0f));
+	iterations = std::max(iterations, 1);
+
+	for (int size : sizes) {
+		QFrustumCuller culler;
+		for (int i = 0; i < size; i++) {
+			const QVector3D center(position(random), position(random), position(random));
+			const QVector3D halfSize(extent(random), extent(random), extent(random));
+			culler.addNode(center - halfSize, center + halfSize, halfSize.length() * tightness(random));
+		}
+		const std::vector<uint32_t> expected = culler.cullScalar(viewProj);
+		if (culler.cull(viewProj) != expected)
+			qWarning() << "QFrustumCuller: SIMD and scalar results differ for" << size << "nodes";
+
+		for (bool simd : { false, true }) {
+			QElapsedTimer timer;
+			timer.start();
+			for (int i = 0; i < iterations; i++) {
+				if (simd)
+					culler.cull(viewProj);
+				else
+					culler.cullScalar(viewProj);
+			}
+			const double avgUs = timer.nsecsElapsed() / 1e3 / iterations;
+			qDebug() << "nodes:" << size
+				<< "visible:" << expected.size()
+				<< "mode:" << (simd ? "SSE" : "scalar")
+				<< "avg:" << avgUs << "us"
+				<< "throughput:" << size / std::max(avgUs, 1e-3) << "nodes/us";
+		}
+	}
+}
@@ -0,0 +1,107 @@
+#ifndef QVkGpuProfiler_h__
+#define QVkGpuProfiler_h__
+
+#include <QByteArray>
+#include <QVector>
+#include <QVulkanWindow>
+#include <functional>
+#include <optional>
+#include <vulkan\vulkan.hpp>
+
+// 不阻塞的GPU计时：每个帧槽位（concurrentFrameCount）一个时间戳查询池，具名区间在命令缓冲区中写入一对时间戳。
+// 某槽位再次开始录制时，QVulkanWindow已等待过该槽位上一次提交的fence，此时读取上一次的结果不会等待GPU，
+// 因此结果会晚 concurrentFrameCount 帧到达。
+// 时间戳同时换算到主机时钟（QVkTraceRecorder::nowNs），录制trace时结果会自动写入QVkTraceRecorder
+class QVkGpuProfiler {
+public:
+	struct ScopeResult {
+		QByteArray name;
+		int depth;					//嵌套深度，0为整帧
+		double beginMs;				//相对帧开始的时间
+		double durationMs;
+	};
+	struct FrameResult {
+		uint64_t frameIndex = 0;	//beginFrame的调用序号
+		int64_t hostBeginNs = 0;	//帧开始时间换算到主机时钟
+		QVector<ScopeResult> scopes;	//按开始顺序排列，scopes[0]为整帧
+		double totalMs() const { return scopes.isEmpty() ? 0.0 : scopes[0].durationMs; }
+		double scopeMs(const QByteArray& name) const;		//同名区间的耗时之和
+	};
+	using Callback = std::function<void(const FrameResult&)>;
+
+	// 区间的RAII封装，profiler为空或未启用时什么也不做
+	class Scope {
+	public:
+		Scope(QVkGpuProfiler* profiler, vk::CommandBuffer cmdBuffer, const char* name);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		QVkGpuProfiler* profiler_;
+		vk::CommandBuffer cmdBuffer_;
+		int scope_;
+	};
+
+	// 须在窗口显示（创建设备）之前调用：设备支持时将VK_EXT_calibrated_timestamps追加到设备扩展列表
+	// 其他扩展若也需要请求，应同样追加到窗口属性"qvkDeviceExtensions"记录的列表，否则会被这里覆盖
+	static void enableCalibratedTimestamps(QVulkanWindow* window);
+
+	QVkGpuProfiler(QVulkanWindow* window, int maxScopes = 64);
+	~QVkGpuProfiler();
+	QVkGpuProfiler(const QVkGpuProfiler&) = delete;
+	QVkGpuProfiler& operator=(const QVkGpuProfiler&) = delete;
+
+	void initResources();			//在渲染器的initResources中调用，设备不支持时间戳时isSupported()返回false
+	void releaseResources();
+
+	// 须在渲染通道之外调用：先派发该槽位上一次的结果，再重置查询池并写入整帧的开始时间戳
+	void beginFrame(vk::CommandBuffer cmdBuffer);
+	void endFrame(vk::CommandBuffer cmdBuffer);
+	// name须在结果派发之前保持有效，通常使用字符串字面量；区间须严格嵌套，超出maxScopes时返回-1并忽略
+	int beginScope(vk::CommandBuffer cmdBuffer, const char* name, vk::PipelineStageFlagBits stage = vk::PipelineStageFlagBits::eTopOfPipe);
+	void endScope(vk::CommandBuffer cmdBuffer, int scope, vk::PipelineStageFlagBits stage = vk::PipelineStageFlagBits::eBottomOfPipe);
+
+	void setEnabled(bool enabled) { enabled_ = enabled; }
+	bool isEnabled() const { return enabled_; }
+	bool isSupported() const { return !frames_.empty(); }
+	void setCallback(Callback callback) { callback_ = std::move(callback); }		//在beginFrame中调用
+	const FrameResult& lastResult() const { return lastResult_; }
+	int droppedFrameCount() const { return droppedFrameCount_; }		//结果不可用而丢弃的帧数
+	bool hasCalibratedTimestamps() const { return hostTimeDomain_.has_value(); }	//否则在initResources中提交一次时间戳估算偏移
+	int64_t toHostNs(uint64_t timestamp) const;
+private:
+	struct ScopeRecord {
+		const char* name;
+		int depth;
+		bool closed;
+	};
+	struct FrameSlot {
+		vk::QueryPool pool;
+		QVector<ScopeRecord> scopes;		//第i个区间占用查询 2i 与 2i+1
+		uint64_t frameIndex = 0;
+		bool recorded = false;
+	};
+	bool isRecording() const { return enabled_ && current_ != nullptr; }
+	void collect(FrameSlot& slot);
+	bool calibrate();					//VK_EXT_calibrated_timestamps，不阻塞
+	void calibrateBySubmit();
+private:
+	QVulkanWindow* window_ = nullptr;
+	int maxScopes_;
+	bool enabled_ = true;
+	double timestampPeriod_ = 1.0;		//每个时间戳计数的纳秒数
+	uint64_t timestampMask_ = ~0ull;
+	std::optional<vk::TimeDomainEXT> hostTimeDomain_;
+	uint64_t calibrationTimestamp_ = 0;
+	int64_t calibrationHostNs_ = 0;
+	std::vector<FrameSlot> frames_;
+	FrameSlot* current_ = nullptr;
+	int depth_ = 0;
+	uint64_t frameCount_ = 0;
+	int droppedFrameCount_ = 0;
+	FrameResult lastResult_;
+	Callback callback_;
+	std::vector<uint64_t> queryData_;
+};
+
+#endif // QVkGpuProfiler_h__
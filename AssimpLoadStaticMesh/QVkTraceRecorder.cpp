@@ -0,0 +1,137 @@
+#include "QVkTraceRecorder.h"
+#include <QDebug>
+#include <QFile>
+#include <chrono>
+#include <set>
+
+QVkTraceRecorder::Scope::Scope(const char* name, const char* category)
+	: name_(name)
+	, category_(category)
+	, beginNs_(QVkTraceRecorder::instance().isRecording() ? nowNs() : 0)
+{
+}
+
+QVkTraceRecorder::Scope::~Scope()
+{
+	QVkTraceRecorder& recorder = QVkTraceRecorder::instance();
+	if (beginNs_ != 0 && recorder.isRecording())
+		recorder.addCpuEvent(name_, category_, beginNs_, nowNs());
+}
+
+QVkTraceRecorder& QVkTraceRecorder::instance()
+{
+	static QVkTraceRecorder recorder;
+	return recorder;
+}
+
+int64_t QVkTraceRecorder::nowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void QVkTraceRecorder::start()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	events_.clear();
+	droppedEventCount_ = 0;
+	startNs_ = nowNs();
+	recording_ = true;
+}
+
+void QVkTraceRecorder::stop()
+{
+	recording_ = false;
+}
+
+void QVkTraceRecorder::addCpuEvent(const char* name, const char* category, int64_t beginNs, int64_t endNs)
+{
+	addEvent({ QByteArray(name), category, beginNs, endNs - beginNs, currentThreadId(), -1 });
+}
+
+void QVkTraceRecorder::addGpuFrame(const QVkGpuProfiler::FrameResult& result)
+{
+	for (const QVkGpuProfiler::ScopeResult& scope : result.scopes) {
+		const int64_t beginNs = result.hostBeginNs + int64_t(scope.beginMs * 1e6);
+		addEvent({ scope.name, "gpu", beginNs, int64_t(scope.durationMs * 1e6), 0, int64_t(result.frameIndex) });
+	}
+}
+
+void QVkTraceRecorder::addEvent(Event&& event)
+{
+	if (!isRecording())
+		return;
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (event.beginNs < startNs_ || events_.size() >= TRACE_MAX_EVENTS) {		//开始录制之前提交的GPU帧也丢弃
+		droppedEventCount_++;
+		return;
+	}
+	events_.push_back(std::move(event));
+}
+
+int QVkTraceRecorder::currentThreadId()
+{
+	static std::atomic<int> nextThreadId = 1;
+	thread_local int threadId = nextThreadId++;
+	return threadId;
+}
+
+int QVkTraceRecorder::eventCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return events_.size();
+}
+
+int QVkTraceRecorder::droppedEventCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return droppedEventCount_;
+}
+
+bool QVkTraceRecorder::save(const QString& filePath) const
+{
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qWarning() << "QVkTraceRecorder: Failed to open" << filePath;
+		return false;
+	}
+	auto escape = [](const QByteArray& text) {
+		QByteArray escaped;
+		escaped.reserve(text.size());
+		for (char c : text) {
+			if (c == '"' || c == '\\')
+				escaped.append('\\');
+			if (uint8_t(c) >= 0x20)
+				escaped.append(c);
+		}
+		return escaped;
+	};
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	// Chrome trace格式：ph为X的完整事件，ts与dur的单位为微秒；GPU作为一个单独的线程显示
+	QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	json += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Vulkan\"}},\n";
+	json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU graphics queue\"}},\n";
+	std::set<int> threadIds;
+	for (const Event& event : events_) {
+		if (event.threadId != 0 && threadIds.insert(event.threadId).second)
+			json += QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,\"args\":{\"name\":\"CPU thread %1\"}},\n").arg(event.threadId).toLatin1();
+	}
+	for (size_t i = 0; i < events_.size(); i++) {
+		const Event& event = events_[i];
+		json += "{\"name\":\"" + escape(event.name) + "\",\"cat\":\"" + event.category + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + QByteArray::number(event.threadId);
+		json += ",\"ts\":" + QByteArray::number((event.beginNs - startNs_) / 1e3, 'f', 3) + ",\"dur\":" + QByteArray::number(event.durationNs / 1e3, 'f', 3);
+		if (event.frameIndex >= 0)
+			json += ",\"args\":{\"frame\":" + QByteArray::number(event.frameIndex) + "}";
+		json += i + 1 < events_.size() ? "},\n" : "}\n";
+		if (json.size() > (1 << 20)) {			//分块写出
+			if (file.write(json) != json.size())
+				return false;
+			json.clear();
+		}
+	}
+	json += "]}\n";
+	if (file.write(json) != json.size())
+		return false;
+	qDebug() << "QVkTraceRecorder: Wrote" << events_.size() << "events to" << filePath << "dropped:" << droppedEventCount_;
+	return true;
+}
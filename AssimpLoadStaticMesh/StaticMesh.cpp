@@ -3,7 +3,12 @@
 #include <assimp/scene.h>
 #include <filesystem>
 #include "QImage"
+#include <QDebug>
+#include <QVector4D>
 #include <fstream>
+#include "QVkTraceRecorder.h"
+
+#define DEVICE_EXTENSIONS_PROPERTY "qvkDeviceExtensions"		//与QVkGpuProfiler共用的已请求设备扩展列表
 
 static std::vector<char> readFile(const std::string& filename) {
 	std::ifstream file(filename, std::ios::ate | std::ios::binary);
@@ -26,13 +31,26 @@ static std::vector<char> readFile(const std::string& filename) {
 StaticMesh::StaticMesh(QVulkanWindow* window, std::string file_path)
 	: window_(window)
 	, meshPath_(file_path) {
-	scene = importer_.ReadFile(file_path, aiProcess_Triangulate | aiProcess_FlipUVs);
+	QVkTraceRecorder::Scope trace("StaticMesh::StaticMesh", "loader");
+	{
+		QVkTraceRecorder::Scope readTrace("Assimp::Importer::ReadFile", "loader");
+		scene = importer_.ReadFile(file_path, aiProcess_Triangulate | aiProcess_FlipUVs);
+	}
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
 		printf("ERROR::ASSIMP:: %s", importer_.GetErrorString());
 		return;
 	}
-	processMaterialTextures(scene);
+	{
+		QVkTraceRecorder::Scope materialTrace("StaticMesh::processMaterialTextures", "loader");
+		processMaterialTextures(scene);
+	}
+	QVkTraceRecorder::Scope nodeTrace("StaticMesh::processNode", "loader");
 	processNode(scene->mRootNode, scene, aiMatrix4x4());
+	for (uint32_t i = 0; i < meshes_.size(); i++) {
+		const StaticMeshNode& mesh = *meshes_[i];
+		frustumCuller_.addNode(QVector3D(mesh.cullMin_.x, mesh.cullMin_.y, mesh.cullMin_.z), QVector3D(mesh.cullMax_.x, mesh.cullMax_.y, mesh.cullMax_.z), mesh.cullRadius_);
+		allNodes_.push_back(i);
+	}
 }
 
 void StaticMesh::processNode(const aiNode* node, const aiScene* scene, aiMatrix4x4 mat)
@@ -82,13 +100,39 @@ void StaticMesh::initVulkanResource()
 {
 	Q_ASSERT(window_->device());
 	device_ = window_->device();
-	initVulkanTexture();
-	initVulkanDescriptor();
-	initVulkanPipline();
+	QVkTraceRecorder::Scope trace("StaticMesh::initVulkanResource", "loader");
+	{
+		QVkTraceRecorder::Scope textureTrace("StaticMesh::initVulkanTexture", "loader");
+		initVulkanTexture();
+	}
+	{
+		QVkTraceRecorder::Scope descriptorTrace("StaticMesh::initVulkanDescriptor", "loader");
+		initVulkanDescriptor();
+	}
+	{
+		QVkTraceRecorder::Scope piplineTrace("StaticMesh::initVulkanPipline", "loader");
+		initVulkanPipline();
+	}
+	initOcclusionResource();
 }
 
 void StaticMesh::releaseVulkanResource()
 {
+	device_.destroyQueryPool(occlusionQueryPool_);
+	device_.destroyBuffer(boxBuffer_);
+	device_.freeMemory(boxMemory_);
+	device_.destroyPipeline(occlusionPipline_);
+	device_.destroyRenderPass(depthRenderPass_);
+	device_.destroyRenderPass(loadRenderPass_);
+	device_.destroyBuffer(conditionBuffer_);
+	device_.freeMemory(conditionMemory_);
+	occlusionQueryPool_ = nullptr;
+	depthRenderPass_ = nullptr;
+	loadRenderPass_ = nullptr;
+	conditionBuffer_ = nullptr;
+	conditionMemory_ = nullptr;
+	queryFrame_ = -1;
+	hiddenNodes_.clear();
 	device_.destroyPipeline(pipline_);
 	device_.destroyPipelineLayout(piplineLayout_);
 	device_.destroyPipelineCache(piplineCache_);
@@ -96,28 +140,296 @@ void StaticMesh::releaseVulkanResource()
 	device_.destroyDescriptorSetLayout(descSetLayout_);
 	device_.destroySampler(commonSampler_);
 	meshes_.clear();
+	frustumCuller_.clear();
+	allNodes_.clear();
 	textures_.clear();
 	textureSet_.clear();
 }
 
+static bool crossesNearPlane(const QMatrix4x4& mvp, const aiVector3D& min, const aiVector3D& max)
+{
+	// 包围盒有角点位于近平面之前时，盒子会被近平面裁掉一部分，查询结果可能为0而节点仍然可见，因此视为可见。
+	// QFpsCamera的投影没有做裁剪空间校正，Vulkan按z>=0裁剪，近平面即裁剪空间z=0
+	const QVector4D plane = mvp.row(2);
+	for (int i = 0; i < 8; i++) {
+		const float x = (i & 1) ? max.x : min.x;
+		const float y = (i & 2) ? max.y : min.y;
+		const float z = (i & 4) ? max.z : min.z;
+		if (plane.x() * x + plane.y() * y + plane.z() * z + plane.w() < 0.0f)
+			return true;
+	}
+	return false;
+}
+
+void StaticMesh::prepareFrame(vk::CommandBuffer& cmdBuffer)
+{
+	queryFrame_ = -1;
+	const uint32_t nodeCount = meshes_.size();
+	if (!occlusionQueryPool_ || nodeCount == 0)
+		return;
+	if (!occlusionCulling_) {
+		std::fill(occlusion_.begin(), occlusion_.end(), OcclusionState());		//重新开启时从全部可见开始
+		return;
+	}
+	const int frame = window_->currentFrame();
+	const uint32_t firstQuery = frame * nodeCount;
+	if (slotReset_[frame]) {
+		// QVulkanWindow已等待过该槽位上一次提交的fence，读取不会阻塞；当时没有发出的查询不可用，跳过
+		const vk::Result result = device_.getQueryPoolResults(occlusionQueryPool_, firstQuery, nodeCount, queryData_.size() * sizeof(uint64_t), queryData_.data(), 2 * sizeof(uint64_t),
+			vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+		if (result == vk::Result::eSuccess || result == vk::Result::eNotReady) {
+			for (uint32_t i = 0; i < nodeCount; i++) {
+				if (queryData_[i * 2 + 1] == 0)
+					continue;
+				OcclusionState& state = occlusion_[i];
+				if (queryData_[i * 2] > 0) {
+					state.visible = true;			//重新露出的节点立即恢复绘制
+					state.occludedResults = 0;
+				}
+				else if (++state.occludedResults >= OCCLUSION_HIDE_RESULTS) {
+					state.visible = false;
+				}
+			}
+		}
+	}
+	cmdBuffer.resetQueryPool(occlusionQueryPool_, firstQuery, nodeCount);
+	slotReset_[frame] = true;
+	queryFrame_ = frame;
+}
+
 void StaticMesh::makeRenderCommand(vk::CommandBuffer& cmdBuffer, QMatrix4x4 matrix)
 {
+	const bool culling = occlusionCulling_ && queryFrame_ >= 0;
+	const uint32_t firstQuery = culling ? queryFrame_ * meshes_.size() : 0;
+	hiddenNodes_.clear();
+	drawnNodeCount_ = 0;
+	QMatrix4x4 flipY;
+	flipY.scale(1, -1, 1);
+	const std::vector<uint32_t>* nodes = &allNodes_;
+	if (frustumCulling_) {
+		QVkTraceRecorder::Scope trace("QFrustumCuller::cull");
+		nodes = &frustumCuller_.cull(matrix * flipY);			//包围体已应用节点矩阵
+	}
+	frustumVisibleNodeCount_ = nodes->size();
+
 	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipline_);
-	for (auto& mesh : meshes_) {
+	for (uint32_t i : *nodes) {
+		auto& mesh = meshes_[i];
 		QMatrix4x4 localMatrix;
 		memcpy(localMatrix.data(), &mesh->localMatrix_, sizeof(aiMatrix4x4));
-		QMatrix4x4 flipY;
-		flipY.scale(1, -1, 1);
 		QMatrix4x4 mvp = matrix * flipY * localMatrix.transposed();
-		cmdBuffer.pushConstants(piplineLayout_, vk::ShaderStageFlagBits::eVertex, 0, sizeof(float) * 16, mvp.constData());
+		if (culling && !occlusion_[i].visible && !crossesNearPlane(mvp, mesh->boundsMin_, mesh->boundsMax_)) {
+			hiddenNodes_.push_back({ i, mvp });
+			continue;
+		}
+		bindNode(cmdBuffer, *mesh, mvp);
+		if (culling)
+			cmdBuffer.beginQuery(occlusionQueryPool_, firstQuery + i, {});
+		cmdBuffer.drawIndexed(mesh->indexBufferInfo_.range / (sizeof(unsigned int)), 1, 0, 0, 0);
+		if (culling)
+			cmdBuffer.endQuery(occlusionQueryPool_, firstQuery + i);
+		drawnNodeCount_++;
+	}
+	if (hiddenNodes_.empty())
+		return;
+
+	// 被剔除的节点：在可见节点写入的深度上测试外扩后的包围盒
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, occlusionPipline_);
+	cmdBuffer.bindVertexBuffers(0, boxBuffer_, { 0 });
+	cmdBuffer.bindIndexBuffer(boxBuffer_, sizeof(StaticMeshNode::Vertex) * 8, vk::IndexType::eUint32);
+	for (const auto& hidden : hiddenNodes_) {
+		const StaticMeshNode& mesh = *meshes_[hidden.first];
+		const aiVector3D size = mesh.boundsMax_ - mesh.boundsMin_;
+		const float padding = size.Length() * OCCLUSION_BOX_INFLATE + 1e-4f;
+		QMatrix4x4 boxMatrix = hidden.second;
+		boxMatrix.translate(mesh.boundsMin_.x - padding, mesh.boundsMin_.y - padding, mesh.boundsMin_.z - padding);
+		boxMatrix.scale(size.x + padding * 2, size.y + padding * 2, size.z + padding * 2);
+		cmdBuffer.pushConstants(piplineLayout_, vk::ShaderStageFlagBits::eVertex, 0, sizeof(float) * 16, boxMatrix.constData());
+		cmdBuffer.beginQuery(occlusionQueryPool_, firstQuery + hidden.first, {});
+		cmdBuffer.drawIndexed(36, 1, 0, 0, 0);
+		cmdBuffer.endQuery(occlusionQueryPool_, firstQuery + hidden.first);
+	}
+}
 
-		if (mesh->descSet_)
-			cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, piplineLayout_, 0, 1, &mesh->descSet_, 0, nullptr);
+void StaticMesh::makeConditionalCommand(vk::CommandBuffer& cmdBuffer)
+{
+	conditionalNodeCount_ = 0;
+	if (!loadRenderPass_ || queryFrame_ < 0 || hiddenNodes_.empty())
+		return;
 
-		cmdBuffer.bindVertexBuffers(0, mesh->vertexBufferInfo_.buffer, mesh->vertexBufferInfo_.offset);
-		cmdBuffer.bindIndexBuffer(mesh->indexBufferInfo_.buffer, mesh->indexBufferInfo_.offset, vk::IndexType::eUint32);
-		cmdBuffer.drawIndexed(mesh->indexBufferInfo_.range / (sizeof(unsigned int)), 1, 0, 0, 0);
+	// 把被剔除节点的包围盒查询结果拷贝为条件渲染的判断值，下标连续的节点合并为一次拷贝；
+	// 本帧没有发出的查询（视锥外的节点）等待不到结果，不能在拷贝范围内
+	const uint32_t firstQuery = queryFrame_ * meshes_.size();
+	for (size_t begin = 0; begin < hiddenNodes_.size();) {
+		size_t end = begin + 1;
+		while (end < hiddenNodes_.size() && hiddenNodes_[end].first == hiddenNodes_[end - 1].first + 1)
+			end++;
+		const uint32_t query = firstQuery + hiddenNodes_[begin].first;
+		cmdBuffer.copyQueryPoolResults(occlusionQueryPool_, query, uint32_t(end - begin), conditionBuffer_, query * sizeof(uint32_t), sizeof(uint32_t), vk::QueryResultFlagBits::eWait);
+		begin = end;
+	}
+	vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eConditionalRenderingReadEXT);
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eConditionalRenderingEXT, {}, barrier, nullptr, nullptr);
+
+	const QSize size = window_->swapChainImageSize();
+	vk::RenderPassBeginInfo beginInfo;
+	beginInfo.renderPass = loadRenderPass_;
+	beginInfo.framebuffer = window_->currentFramebuffer();
+	beginInfo.renderArea.extent.width = size.width();
+	beginInfo.renderArea.extent.height = size.height();
+	cmdBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
+
+	// 视口与裁剪矩形是命令缓冲区的动态状态，沿用第一个渲染通道中设置的值
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipline_);
+	for (const auto& hidden : hiddenNodes_) {
+		const StaticMeshNode& mesh = *meshes_[hidden.first];
+		bindNode(cmdBuffer, mesh, hidden.second);
+		vk::ConditionalRenderingBeginInfoEXT conditionInfo(conditionBuffer_, (firstQuery + hidden.first) * sizeof(uint32_t));
+		cmdBuffer.beginConditionalRenderingEXT(conditionInfo);
+		cmdBuffer.drawIndexed(mesh.indexBufferInfo_.range / (sizeof(unsigned int)), 1, 0, 0, 0);
+		cmdBuffer.endConditionalRenderingEXT();
 	}
+	cmdBuffer.endRenderPass();
+	conditionalNodeCount_ = hiddenNodes_.size();
+}
+
+vk::RenderPass StaticMesh::renderPass() const
+{
+	return depthRenderPass_ ? depthRenderPass_ : vk::RenderPass(window_->defaultRenderPass());
+}
+
+void StaticMesh::enableConditionalRendering(QVulkanWindow* window)
+{
+	if (!window->supportedDeviceExtensions().contains(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME))
+		return;
+	QByteArrayList extensions = window->property(DEVICE_EXTENSIONS_PROPERTY).value<QByteArrayList>();
+	if (!extensions.contains(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME))
+		extensions.append(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME);
+	window->setDeviceExtensions(extensions);
+	window->setProperty(DEVICE_EXTENSIONS_PROPERTY, QVariant::fromValue(extensions));
+	window->setEnabledFeaturesModifier([](VkPhysicalDeviceFeatures2& features) {
+		static VkPhysicalDeviceConditionalRenderingFeaturesEXT conditionalRenderingFeatures = {};		//须存活到设备创建之后
+		conditionalRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT;
+		conditionalRenderingFeatures.conditionalRendering = VK_TRUE;
+		conditionalRenderingFeatures.pNext = features.pNext;
+		features.pNext = &conditionalRenderingFeatures;
+	});
+}
+
+// 与默认渲染通道兼容（附件格式与采样数相同），只支持单采样；第一个通道清除并保存深度，第二个通道载入颜色与深度
+static vk::RenderPass createSceneRenderPass(vk::Device device, QVulkanWindow* window, bool load)
+{
+	vk::AttachmentDescription attachments[2];
+	attachments[0].format = (vk::Format)window->colorFormat();
+	attachments[0].samples = vk::SampleCountFlagBits::e1;
+	attachments[0].loadOp = load ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear;
+	attachments[0].storeOp = vk::AttachmentStoreOp::eStore;
+	attachments[0].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+	attachments[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+	attachments[0].initialLayout = load ? vk::ImageLayout::ePresentSrcKHR : vk::ImageLayout::eUndefined;
+	attachments[0].finalLayout = vk::ImageLayout::ePresentSrcKHR;
+
+	attachments[1].format = (vk::Format)window->depthStencilFormat();
+	attachments[1].samples = vk::SampleCountFlagBits::e1;
+	attachments[1].loadOp = load ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear;
+	attachments[1].storeOp = load ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore;
+	attachments[1].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+	attachments[1].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+	attachments[1].initialLayout = load ? vk::ImageLayout::eDepthStencilAttachmentOptimal : vk::ImageLayout::eUndefined;
+	attachments[1].finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+	vk::AttachmentReference colorRef(0, vk::ImageLayout::eColorAttachmentOptimal);
+	vk::AttachmentReference depthRef(1, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+	vk::SubpassDescription subpass;
+	subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorRef;
+	subpass.pDepthStencilAttachment = &depthRef;
+
+	// 等待之前对颜色与深度附件的写入（上一帧或第一个通道）
+	vk::SubpassDependency dependency;
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+	dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+	dependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+	dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+	vk::RenderPassCreateInfo renderPassInfo;
+	renderPassInfo.attachmentCount = 2;
+	renderPassInfo.pAttachments = attachments;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 1;
+	renderPassInfo.pDependencies = &dependency;
+	return device.createRenderPass(renderPassInfo);
+}
+
+void StaticMesh::initOcclusionResource()
+{
+	const int frameCount = window_->concurrentFrameCount();
+	occlusion_.assign(meshes_.size(), OcclusionState());
+	queryData_.resize(meshes_.size() * 2);				//每个查询一个样本数加一个可用性标志
+	slotReset_.assign(frameCount, false);
+	if (meshes_.empty())
+		return;
+
+	vk::QueryPoolCreateInfo queryPoolInfo;
+	queryPoolInfo.queryType = vk::QueryType::eOcclusion;
+	queryPoolInfo.queryCount = meshes_.size() * frameCount;
+	occlusionQueryPool_ = device_.createQueryPool(queryPoolInfo);
+
+	// 单位立方体，顶点沿用网格的顶点格式，使包围盒管线可以复用mesh_vert
+	StaticMeshNode::Vertex vertices[8] = {};
+	for (int i = 0; i < 8; i++)
+		vertices[i].position = aiVector3D((i & 1) ? 1.0f : 0.0f, (i & 2) ? 1.0f : 0.0f, (i & 4) ? 1.0f : 0.0f);
+	const uint32_t indices[36] = {
+		0, 2, 1, 1, 2, 3,		// z = 0
+		4, 5, 6, 5, 7, 6,		// z = 1
+		0, 1, 4, 1, 5, 4,		// y = 0
+		2, 6, 3, 3, 6, 7,		// y = 1
+		0, 4, 2, 2, 4, 6,		// x = 0
+		1, 3, 5, 3, 7, 5,		// x = 1
+	};
+	vk::BufferCreateInfo bufferInfo;
+	bufferInfo.usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer;
+	bufferInfo.size = sizeof(vertices) + sizeof(indices);
+	boxBuffer_ = device_.createBuffer(bufferInfo);
+	vk::MemoryRequirements memReq = device_.getBufferMemoryRequirements(boxBuffer_);
+	vk::MemoryAllocateInfo memAllocInfo(memReq.size, window_->hostVisibleMemoryIndex());
+	boxMemory_ = device_.allocateMemory(memAllocInfo);
+	device_.bindBufferMemory(boxBuffer_, boxMemory_, 0);
+	uint8_t* bufferMemPtr = (uint8_t*)device_.mapMemory(boxMemory_, 0, memReq.size);
+	memcpy(bufferMemPtr, vertices, sizeof(vertices));
+	memcpy(bufferMemPtr + sizeof(vertices), indices, sizeof(indices));
+	device_.unmapMemory(boxMemory_);
+
+	const QByteArrayList extensions = window_->property(DEVICE_EXTENSIONS_PROPERTY).value<QByteArrayList>();
+	if (!extensions.contains(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME) || window_->sampleCountFlagBits() != VK_SAMPLE_COUNT_1_BIT) {
+		qDebug() << "StaticMesh: conditional rendering is off, reappearing nodes are drawn" << frameCount << "frames late";
+		return;
+	}
+	depthRenderPass_ = createSceneRenderPass(device_, window_, false);
+	loadRenderPass_ = createSceneRenderPass(device_, window_, true);
+
+	bufferInfo.usage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eConditionalRenderingEXT;
+	bufferInfo.size = sizeof(uint32_t) * meshes_.size() * frameCount;
+	conditionBuffer_ = device_.createBuffer(bufferInfo);
+	memReq = device_.getBufferMemoryRequirements(conditionBuffer_);
+	memAllocInfo = vk::MemoryAllocateInfo(memReq.size, window_->deviceLocalMemoryIndex());
+	conditionMemory_ = device_.allocateMemory(memAllocInfo);
+	device_.bindBufferMemory(conditionBuffer_, conditionMemory_, 0);
+}
+
+void StaticMesh::bindNode(vk::CommandBuffer& cmdBuffer, const StaticMeshNode& mesh, const QMatrix4x4& mvp)
+{
+	cmdBuffer.pushConstants(piplineLayout_, vk::ShaderStageFlagBits::eVertex, 0, sizeof(float) * 16, mvp.constData());
+
+	if (mesh.descSet_)
+		cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, piplineLayout_, 0, 1, &mesh.descSet_, 0, nullptr);
+
+	cmdBuffer.bindVertexBuffers(0, mesh.vertexBufferInfo_.buffer, mesh.vertexBufferInfo_.offset);
+	cmdBuffer.bindIndexBuffer(mesh.indexBufferInfo_.buffer, mesh.indexBufferInfo_.offset, vk::IndexType::eUint32);
 }
 
 void StaticMesh::initVulkanTexture() {
@@ -335,6 +647,12 @@ void StaticMesh::initVulkanPipline()
 	piplineCache_ = device_.createPipelineCache(vk::PipelineCacheCreateInfo());
 	pipline_ = device_.createGraphicsPipeline(piplineCache_, piplineInfo).value;
 
+	// 遮挡查询用的包围盒管线：只保留顶点着色器，深度测试但不写入，也不写颜色
+	piplineInfo.stageCount = 1;
+	DSState.depthWriteEnable = false;
+	colorBlendAttachmentState.colorWriteMask = {};
+	occlusionPipline_ = device_.createGraphicsPipeline(piplineCache_, piplineInfo).value;
+
 	device_.destroyShaderModule(vertShader);
 	device_.destroyShaderModule(fragShader);
 }
\ No newline at end of file
@@ -6,20 +6,46 @@
 #include <map>
 #include "StaticMeshNode.h"
 #include "QFpsCamera.h"
+#include "QFrustumCuller.h"
 #include "QVulkanWindow"
 
+#define OCCLUSION_HIDE_RESULTS 3			//连续多少次查询结果为0才剔除，避免在边缘处闪烁
+#define OCCLUSION_BOX_INFLATE 0.02f			//包围盒按对角线长度外扩的比例，使节点在露出之前就被判定为可见
+
 class StaticMesh {
 	friend class StaticMeshNode;
 public:
 	StaticMesh(QVulkanWindow* window, std::string file_path);
 	void initVulkanResource();
 	void releaseVulkanResource();
+	// 遮挡剔除：可见节点的绘制本身包在遮挡查询中，被剔除的节点在所有可见节点之后用外扩的包围盒做只测深度的查询，
+	// 结果在该帧槽位下一次录制时读取（不等待，即滞后concurrentFrameCount()帧），据此决定节点是否绘制。须在渲染通道之外调用prepareFrame
+	// 开启条件渲染后，makeConditionalCommand在同一帧内按包围盒的查询结果绘制被剔除的节点，重新露出的节点不会滞后出现
+	void prepareFrame(vk::CommandBuffer& cmdBuffer);
 	void makeRenderCommand(vk::CommandBuffer& cmdBuffer, QMatrix4x4 matrix);
+	void makeConditionalCommand(vk::CommandBuffer& cmdBuffer);		//在makeRenderCommand所在的渲染通道结束之后调用
+	vk::RenderPass renderPass() const;		//makeRenderCommand须在此渲染通道中录制，开启条件渲染时它会保留深度
+	// 须在窗口显示（创建设备）之前调用：设备支持时追加VK_EXT_conditional_rendering并开启conditionalRendering特性，需要Vulkan 1.1的实例
+	static void enableConditionalRendering(QVulkanWindow* window);
+	void setOcclusionCulling(bool enabled) { occlusionCulling_ = enabled; }
+	bool occlusionCulling() const { return occlusionCulling_; }
+	int nodeCount() const { return meshes_.size(); }
+	int drawnNodeCount() const { return drawnNodeCount_; }		//最近一帧实际绘制的节点数
+	int conditionalNodeCount() const { return conditionalNodeCount_; }		//最近一帧按查询结果条件绘制的节点数
+	void setFrustumCulling(bool enabled) { frustumCulling_ = enabled; }		//视锥剔除在遮挡剔除之前进行，视锥外的节点既不绘制也不查询
+	bool frustumCulling() const { return frustumCulling_; }
+	int frustumVisibleNodeCount() const { return frustumVisibleNodeCount_; }
 protected:
 	void initVulkanTexture();
 	void initVulkanDescriptor();
 	void initVulkanPipline();
+	void initOcclusionResource();
 private:
+	struct OcclusionState {
+		bool visible = true;
+		int occludedResults = 0;
+	};
+	void bindNode(vk::CommandBuffer& cmdBuffer, const StaticMeshNode& mesh, const QMatrix4x4& mvp);
 	void processNode(const aiNode* node, const aiScene* scene, aiMatrix4x4 mat);
 	void processMaterialTextures(const aiScene* scene);
 private:
@@ -40,6 +66,29 @@ private:
 	vk::PipelineCache piplineCache_;
 	vk::PipelineLayout piplineLayout_;
 	vk::Pipeline pipline_;
+
+	bool frustumCulling_ = true;
+	QFrustumCuller frustumCuller_;			//与meshes_一一对应，在导入时填充
+	std::vector<uint32_t> allNodes_;		//关闭视锥剔除时使用的全部节点下标
+	int frustumVisibleNodeCount_ = 0;
+
+	bool occlusionCulling_ = true;
+	vk::Pipeline occlusionPipline_;			//只有顶点着色器，不写颜色与深度
+	vk::Buffer boxBuffer_;					//单位立方体[0,1]^3的顶点与索引
+	vk::DeviceMemory boxMemory_;
+	vk::QueryPool occlusionQueryPool_;		//每个帧槽位 meshes_.size() 个查询
+	std::vector<OcclusionState> occlusion_;
+	std::vector<uint64_t> queryData_;
+	std::vector<bool> slotReset_;			//帧槽位的查询是否已重置过，未重置的查询不能读取
+	int queryFrame_ = -1;					//prepareFrame重置过的帧槽位
+	int drawnNodeCount_ = 0;
+	std::vector<std::pair<uint32_t, QMatrix4x4>> hiddenNodes_;		//本帧被剔除、只做了包围盒查询的节点
+
+	vk::RenderPass depthRenderPass_;		//开启条件渲染时代替默认渲染通道，保存深度
+	vk::RenderPass loadRenderPass_;			//载入颜色与深度，条件绘制被剔除的节点
+	vk::Buffer conditionBuffer_;			//每个帧槽位 meshes_.size() 个32位查询结果，作为条件渲染的判断值
+	vk::DeviceMemory conditionMemory_;
+	int conditionalNodeCount_ = 0;
 };
 
 #endif // StaticMesh_h__
@@ -1,15 +1,32 @@
 #include "StaticMeshRenderer.h"
+#include <QDebug>
+#include "QVkTraceRecorder.h"
 
 StaticMeshRenderer::StaticMeshRenderer(QVulkanWindow* window)
 	:window_(window)
 	,staticMesh_(window, "./Genji/Genji.FBX")
+	,gpuProfiler_(window)
 {
 	camera_.setup(window);
+	gpuProfiler_.setCallback([this](const QVkGpuProfiler::FrameResult& result) {
+		meshGpuMs_ += result.scopeMs("StaticMesh") + result.scopeMs("StaticMeshConditional");
+		if (++meshGpuFrames_ < MESH_STATS_INTERVAL)
+			return;
+		qDebug().nospace() << "StaticMesh: drawn " << staticMesh_.drawnNodeCount() << "/" << staticMesh_.nodeCount()
+			<< " nodes, conditional " << staticMesh_.conditionalNodeCount()
+			<< " nodes, in frustum " << staticMesh_.frustumVisibleNodeCount()
+			<< ", frustum culling " << (staticMesh_.frustumCulling() ? "on" : "off")
+			<< ", occlusion culling " << (staticMesh_.occlusionCulling() ? "on" : "off")
+			<< ", GPU " << meshGpuMs_ / meshGpuFrames_ << " ms";
+		meshGpuMs_ = 0.0;
+		meshGpuFrames_ = 0;
+	});
 }
 
 void StaticMeshRenderer::initResources()
 {
 	staticMesh_.initVulkanResource();
+	gpuProfiler_.initResources();
 }
 
 void StaticMeshRenderer::initSwapChainResources()
@@ -22,13 +39,17 @@ void StaticMeshRenderer::releaseSwapChainResources()
 
 void StaticMeshRenderer::releaseResources()
 {
+	gpuProfiler_.releaseResources();
 	staticMesh_.releaseVulkanResource();
 }
 
 void StaticMeshRenderer::startNextFrame()
 {
+	QVkTraceRecorder::Scope trace("StaticMeshRenderer::startNextFrame");
 	vk::CommandBuffer cmdBuffer = window_->currentCommandBuffer();
 	const QSize size = window_->swapChainImageSize();
+	gpuProfiler_.beginFrame(cmdBuffer);
+	staticMesh_.prepareFrame(cmdBuffer);
 
 	vk::ClearValue clearValues[3] = {
 		vk::ClearColorValue(std::array<float,4>{0.0f,0.0f,0.0f,1.0f }),
@@ -37,7 +58,7 @@ void StaticMeshRenderer::startNextFrame()
 	};
 
 	vk::RenderPassBeginInfo beginInfo;
-	beginInfo.renderPass = window_->defaultRenderPass();
+	beginInfo.renderPass = staticMesh_.renderPass();
 	beginInfo.framebuffer = window_->currentFramebuffer();
 	beginInfo.renderArea.extent.width = size.width();
 	beginInfo.renderArea.extent.height = size.height();
@@ -62,9 +83,19 @@ void StaticMeshRenderer::startNextFrame()
 	scissor.extent.height = size.height();
 	cmdBuffer.setScissor(0, scissor);
 
-	staticMesh_.makeRenderCommand(cmdBuffer, camera_.getMatrix());
+	{
+		QVkTraceRecorder::Scope meshTrace("StaticMesh::makeRenderCommand");
+		QVkGpuProfiler::Scope meshScope(&gpuProfiler_, cmdBuffer, "StaticMesh");
+		staticMesh_.makeRenderCommand(cmdBuffer, camera_.getMatrix());
+	}
 
 	cmdBuffer.endRenderPass();
+	{
+		QVkTraceRecorder::Scope conditionalTrace("StaticMesh::makeConditionalCommand");
+		QVkGpuProfiler::Scope conditionalScope(&gpuProfiler_, cmdBuffer, "StaticMeshConditional");
+		staticMesh_.makeConditionalCommand(cmdBuffer);
+	}
+	gpuProfiler_.endFrame(cmdBuffer);
 
 	window_->frameReady();
 	window_->requestUpdate();
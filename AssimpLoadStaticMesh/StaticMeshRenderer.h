@@ -4,12 +4,17 @@
 #include <QVulkanWindow>
 #include <vulkan\vulkan.hpp>
 #include "QFpsCamera.h"
+#include "QVkGpuProfiler.h"
 #include "StaticMesh.h"
 
+#define MESH_STATS_INTERVAL 120			//每隔多少帧输出一次绘制节点数与GPU耗时
+
 class StaticMeshRenderer : public QVulkanWindowRenderer {
 	friend class StaticMeshNode;
 public:
 	StaticMeshRenderer(QVulkanWindow* window);
+	void setOcclusionCulling(bool enabled) { staticMesh_.setOcclusionCulling(enabled); }
+	void setFrustumCulling(bool enabled) { staticMesh_.setFrustumCulling(enabled); }
 protected:
 	void initResources() override;
 	void initSwapChainResources() override;
@@ -21,6 +26,9 @@ private:
 	vk::Device device_;
 	StaticMesh staticMesh_;
 	QFpsCamera camera_;
+	QVkGpuProfiler gpuProfiler_;
+	double meshGpuMs_ = 0.0;			//最近 MESH_STATS_INTERVAL 帧"StaticMesh"与"StaticMeshConditional"区间的GPU耗时之和
+	int meshGpuFrames_ = 0;
 };
 
 #endif // StaticMeshRenderer_h__
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include <QLoggingCategory>
 #include <QVulkanInstance>
 #include <vulkan/vulkan.hpp>
+#include <cstring>
+#include "QFrustumCuller.h"
+#include "QVkTraceRecorder.h"
 #include "StaticMeshRenderer.h"
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
@@ -11,28 +14,69 @@ Q_LOGGING_CATEGORY(lcVk, "qt.vulkan")
 class VulkanWindow : public QVulkanWindow {
 public:
 	QVulkanWindowRenderer* createRenderer() override {
-		return staitcMesh_ = new StaticMeshRenderer(this);
+		staitcMesh_ = new StaticMeshRenderer(this);
+		staitcMesh_->setOcclusionCulling(occlusionCulling_);
+		staitcMesh_->setFrustumCulling(frustumCulling_);
+		return staitcMesh_;
 	}
 	StaticMeshRenderer* staitcMesh_;
+	bool occlusionCulling_ = true;
+	bool frustumCulling_ = true;
 };
 
 int main(int argc, char* argv[]) {
 	QGuiApplication app(argc, argv);
 
+	// --cull-benchmark：只测试视锥剔除的CPU吞吐量，不创建窗口
+	if (app.arguments().contains("--cull-benchmark")) {
+		QFrustumCuller::benchmark({ 1000, 10000, 100000, 1000000 }, 100);
+		return 0;
+	}
+
 	static vk::DynamicLoader  dynamicLoader;
 	PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dynamicLoader.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
 	VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
 	QVulkanInstance instance;
 	instance.setLayers({ "VK_LAYER_KHRONOS_validation" });
+	instance.setApiVersion(QVersionNumber(1, 1));			//条件渲染的特性通过VkPhysicalDeviceFeatures2开启
 	if (!instance.create())
 		qFatal("Failed to create Vulkan instance: %d", instance.errorCode());
 	VULKAN_HPP_DEFAULT_DISPATCHER.init(instance.vkInstance());
 	QLoggingCategory::setFilterRules(QStringLiteral("qt.vulkan=true"));
 
+	// --trace PATH：录制模型加载各阶段与每帧的CPU/GPU时间线，退出时写出Chrome trace JSON
+	const char* tracePath = nullptr;
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--trace") == 0)
+			tracePath = argv[i + 1];
+	}
+	// --no-occlusion / --no-frustum：关闭节点的遮挡剔除或视锥剔除，用于对比
+	bool occlusionCulling = true;
+	bool frustumCulling = true;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--no-occlusion") == 0)
+			occlusionCulling = false;
+		if (strcmp(argv[i], "--no-frustum") == 0)
+			frustumCulling = false;
+	}
+
 	VulkanWindow vkWindow;
+	vkWindow.occlusionCulling_ = occlusionCulling;
+	vkWindow.frustumCulling_ = frustumCulling;
 	vkWindow.setVulkanInstance(&instance);
 	vkWindow.resize(1024, 768);
+	if (tracePath) {
+		QVkGpuProfiler::enableCalibratedTimestamps(&vkWindow);
+		QVkTraceRecorder::instance().start();
+	}
+	if (occlusionCulling)
+		StaticMesh::enableConditionalRendering(&vkWindow);
 	vkWindow.show();
 
-	return app.exec();
+	const int ret = app.exec();
+	if (tracePath) {
+		QVkTraceRecorder::instance().stop();
+		QVkTraceRecorder::instance().save(tracePath);
+	}
+	return ret;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "BloomRenderer.h"
+#include <algorithm>
 #include <fstream>
+#include <utility>
 
 static std::vector<char> readFile(const std::string& filename) {
 	std::ifstream file(filename, std::ios::ate | std::ios::binary);
@@ -19,6 +21,52 @@ static std::vector<char> readFile(const std::string& filename) {
 	return buffer;
 }
 
+#define MAX_LINEAR_TAPS 20		//与gaussblur_linear_frag.frag一致
+
+#define BLUR_PATH_COUNT 3				//BlurPath的个数，用于模糊性能测试
+
+static const char* blurPathNames[BLUR_PATH_COUNT] = { "Fragment", "Compute", "Linear" };
+
+// 第i个样本的权重随距离线性递减，归一化时中心权重按两次计入；setBlurSize与线性采样的核共用
+static constexpr float blurWeight(int size, int i)
+{
+	return float(size - i) / float(size * (size + 1));
+}
+
+// 线性采样的核：离散核的第i、i+1个样本合并为一次双线性采样，
+// 偏移取两者按权重的加权位置（以模糊步长为单位），权重取两者之和
+struct LinearBlurKernel
+{
+	int tapCount;
+	float centerWeight;
+	float offsets[MAX_LINEAR_TAPS];
+	float weights[MAX_LINEAR_TAPS];
+};
+
+static constexpr LinearBlurKernel makeLinearBlurKernel(int size)
+{
+	LinearBlurKernel kernel = {};
+	kernel.centerWeight = blurWeight(size, 0);
+	for (int i = 1; i < size; i += 2) {
+		const float w1 = blurWeight(size, i);
+		const float w2 = i + 1 < size ? blurWeight(size, i + 1) : 0.0f;
+		kernel.weights[kernel.tapCount] = w1 + w2;
+		kernel.offsets[kernel.tapCount] = (i * w1 + (i + 1) * w2) / (w1 + w2);
+		kernel.tapCount++;
+	}
+	return kernel;
+}
+
+template<size_t... Index>
+static constexpr std::array<LinearBlurKernel, sizeof...(Index)> makeLinearBlurKernels(std::index_sequence<Index...>)
+{
+	return { makeLinearBlurKernel(int(Index) + 1)... };
+}
+
+// 第size-1项对应setBlurSize(size)，每个size的离散核都有完全对应的线性核
+static constexpr auto linearBlurKernels = makeLinearBlurKernels(std::make_index_sequence<LINEAR_BLUR_KERNEL_COUNT>());
+static_assert(linearBlurKernels[LINEAR_BLUR_KERNEL_COUNT - 1].tapCount <= MAX_LINEAR_TAPS, "linear blur kernel exceeds MAX_LINEAR_TAPS");
+
 BloomRenderer::BloomRenderer()
 {
 	setBlurSize(20);
@@ -27,17 +75,11 @@ BloomRenderer::BloomRenderer()
 
 void BloomRenderer::setBlurSize(int size)
 {
-	if (size <= 0 || size == blurParams_.size || size >= std::size(blurParams_.weight))
+	if (size <= 0 || size >= std::size(blurParams_.weight))
 		return;
-	float sum = 0, s = 1;
-	for (int i = size - 1; i >= 0; i--) {
-		blurParams_.weight[i] = (blurParams_.weight[0] + s);
-		++s;
-		sum += blurParams_.weight[i] * 2;
-	}
-	for (int i = 0; i < size; i++) {
-		blurParams_.weight[i] /= sum;
-	}
+	blurParams_.size = size;
+	for (int i = 0; i < size; i++)
+		blurParams_.weight[i] = blurWeight(size, i);
 }
 
 void BloomRenderer::setBlurStrength(float strength)
@@ -50,9 +92,50 @@ void BloomRenderer::setBlurScale(float scale)
 	blurParams_.scale = scale;
 }
 
+void BloomRenderer::setBlurPath(BlurPath path)
+{
+	blurPath_ = path;
+}
+
+void BloomRenderer::setBloomMode(BloomMode mode)
+{
+	bloomMode_ = mode;
+}
+
+void BloomRenderer::setBloomThreshold(float threshold, float knee)
+{
+	bloomParams_.threshold = threshold;
+	bloomParams_.knee = std::max(knee, 0.0f);
+}
+
+void BloomRenderer::setBloomIntensity(float intensity)
+{
+	bloomParams_.intensity = intensity;
+}
+
+void BloomRenderer::setBlurResolutionScale(float scale)
+{
+	blurResolutionScale_ = std::clamp(scale, BLUR_MIN_RESOLUTION_SCALE, 1.0f);
+}
+
+void BloomRenderer::setBlurAutoScale(bool enabled, float budgetMs)
+{
+	blurAutoScale_.enabled = enabled;
+	blurAutoScale_.budgetMs = budgetMs;
+	blurAutoScale_.skipFrames = QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT;
+	blurAutoScale_.sampleCount = 0;
+	blurAutoScale_.totalMs = 0;
+}
+
+void BloomRenderer::setExposure(float exposure)
+{
+	bloomParams_.exposure = exposure;
+}
+
 void BloomRenderer::initResources()
 {
 	vk::Device device = window_->device();
+	const bool hdr = window_->hdrSceneTarget();
 	vk::SamplerCreateInfo samplerInfo;
 	samplerInfo.magFilter = vk::Filter::eNearest;
 	samplerInfo.minFilter = vk::Filter::eNearest;
@@ -63,7 +146,7 @@ void BloomRenderer::initResources()
 	sampler_ = device.createSampler(samplerInfo);
 
 	vk::AttachmentDescription attachmentDesc;
-	attachmentDesc.format = vk::Format::eR8G8B8A8Unorm;
+	attachmentDesc.format = hdr ? vk::Format::eR16G16B16A16Sfloat : vk::Format::eR8G8B8A8Unorm;
 	attachmentDesc.samples = vk::SampleCountFlagBits::e1;
 	attachmentDesc.loadOp = vk::AttachmentLoadOp::eClear;
 	attachmentDesc.storeOp = vk::AttachmentStoreOp::eStore;
@@ -87,16 +170,6 @@ void BloomRenderer::initResources()
 	renderPassInfo.pSubpasses = &subpassDesc;
 	renderPass_ = device.createRenderPass(renderPassInfo);
 
-	vk::DescriptorPoolSize descPoolSize = {
-		vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 2)
-	};
-
-	vk::DescriptorPoolCreateInfo descPoolInfo;
-	descPoolInfo.maxSets = 2;
-	descPoolInfo.poolSizeCount = 1;
-	descPoolInfo.pPoolSizes = &descPoolSize;
-	descPool_ = device.createDescriptorPool(descPoolInfo);
-
 	vk::DescriptorSetLayoutBinding layoutBinding{
 		0, vk::DescriptorType::eCombinedImageSampler,1,vk::ShaderStageFlagBits::eFragment
 	};
@@ -109,11 +182,6 @@ void BloomRenderer::initResources()
 
 	descSetLayout_ = device.createDescriptorSetLayout(descLayoutInfo);
 
-	for (int i = 0; i < 2; ++i) {
-		vk::DescriptorSetAllocateInfo descSetAllocInfo(descPool_, 1, &descSetLayout_);
-		descSet_[i] = device.allocateDescriptorSets(descSetAllocInfo).front();
-	}
-
 	vk::GraphicsPipelineCreateInfo piplineInfo;
 
 	auto vertShaderCode = readFile("./full_screen.spv");
@@ -218,11 +286,184 @@ void BloomRenderer::initResources()
 
 	piplineCache_ = device.createPipelineCache(vk::PipelineCacheCreateInfo());
 
+	// HDR场景目标下模糊只输出线性结果，色调映射留给最终合成
+	struct BlurSpecData {
+		int direction;
+		int tonemap;
+	}blurSpecData = { 0, hdr ? 0 : 1 };
+	vk::SpecializationMapEntry blurSpecMapEntries[2] = {
+		{ 0, offsetof(BlurSpecData, direction), sizeof(int) },
+		{ 1, offsetof(BlurSpecData, tonemap), sizeof(int) },
+	};
+	vk::SpecializationInfo blurSpecInfo(2, blurSpecMapEntries, sizeof(BlurSpecData), &blurSpecData);
+	piplineShaderStage[1].pSpecializationInfo = &blurSpecInfo;
+	blurSpecData.direction = 1;
 	hBlurPipline_ = device.createGraphicsPipeline(piplineCache_, piplineInfo).value;
 
-	specData = 1;
+	blurSpecData.direction = 0;
 	vBlurPipline_ = device.createGraphicsPipeline(piplineCache_, piplineInfo).value;
 
+	struct LinearBlurSpecData {
+		int direction;
+		int tapCount;
+		float centerWeight;
+		float offsets[MAX_LINEAR_TAPS];
+		float weights[MAX_LINEAR_TAPS];
+		int tonemap;
+	}linearSpecData;
+	linearSpecData.tonemap = blurSpecData.tonemap;
+	std::vector<vk::SpecializationMapEntry> linearSpecMapEntries = {
+		{ 0, offsetof(LinearBlurSpecData, direction), sizeof(int) },
+		{ 1, offsetof(LinearBlurSpecData, tapCount), sizeof(int) },
+		{ 2, offsetof(LinearBlurSpecData, centerWeight), sizeof(float) },
+	};
+	for (uint32_t i = 0; i < MAX_LINEAR_TAPS; i++) {
+		linearSpecMapEntries.emplace_back(3 + i, uint32_t(offsetof(LinearBlurSpecData, offsets) + i * sizeof(float)), sizeof(float));
+		linearSpecMapEntries.emplace_back(3 + MAX_LINEAR_TAPS + i, uint32_t(offsetof(LinearBlurSpecData, weights) + i * sizeof(float)), sizeof(float));
+	}
+	linearSpecMapEntries.emplace_back(3 + 2 * MAX_LINEAR_TAPS, uint32_t(offsetof(LinearBlurSpecData, tonemap)), sizeof(int));
+	vk::SpecializationInfo linearSpecInfo;
+	linearSpecInfo.mapEntryCount = linearSpecMapEntries.size();
+	linearSpecInfo.pMapEntries = linearSpecMapEntries.data();
+	linearSpecInfo.dataSize = sizeof(LinearBlurSpecData);
+	linearSpecInfo.pData = &linearSpecData;
+
+	auto linearShaderCode = readFile("./gaussblur_linear_frag.spv");
+	shaderInfo.codeSize = linearShaderCode.size();
+	shaderInfo.pCode = reinterpret_cast<uint32_t*>(linearShaderCode.data());
+	piplineShaderStage[1].module = device.createShaderModule(shaderInfo);
+	piplineShaderStage[1].pSpecializationInfo = &linearSpecInfo;
+	for (int i = 0; i < LINEAR_BLUR_KERNEL_COUNT; i++) {
+		const LinearBlurKernel& kernel = linearBlurKernels[i];
+		linearSpecData.tapCount = kernel.tapCount;
+		linearSpecData.centerWeight = kernel.centerWeight;
+		std::copy(std::begin(kernel.offsets), std::end(kernel.offsets), linearSpecData.offsets);
+		std::copy(std::begin(kernel.weights), std::end(kernel.weights), linearSpecData.weights);
+		linearSpecData.direction = 1;
+		linearHBlurPipline_[i] = device.createGraphicsPipeline(piplineCache_, piplineInfo).value;
+		linearSpecData.direction = 0;
+		linearVBlurPipline_[i] = device.createGraphicsPipeline(piplineCache_, piplineInfo).value;
+	}
+	device.destroyShaderModule(piplineShaderStage[1].module);
+	piplineShaderStage[1].module = fragShader;
+	piplineShaderStage[1].pSpecializationInfo = &specInfo;
+
+	vk::DescriptorSetLayoutBinding computeLayoutBindings[2] = {
+		{ 0, vk::DescriptorType::eCombinedImageSampler,1,vk::ShaderStageFlagBits::eCompute },
+		{ 1, vk::DescriptorType::eStorageImage,1,vk::ShaderStageFlagBits::eCompute },
+	};
+	descLayoutInfo.bindingCount = 2;
+	descLayoutInfo.pBindings = computeLayoutBindings;
+	computeDescSetLayout_ = device.createDescriptorSetLayout(descLayoutInfo);
+
+	vk::PushConstantRange computePushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(BlurParams));
+	piplineLayoutInfo.pSetLayouts = &computeDescSetLayout_;
+	piplineLayoutInfo.pPushConstantRanges = &computePushConstant;
+	computePiplineLayout_ = device.createPipelineLayout(piplineLayoutInfo);
+
+	// 存储图像的格式须与模糊目标一致：HDR场景目标下为rgba16f，否则为rgba8
+	auto computeShaderCode = readFile(hdr ? "./gaussblur_comp_hdr.spv" : "./gaussblur_comp.spv");
+	shaderInfo.codeSize = computeShaderCode.size();
+	shaderInfo.pCode = reinterpret_cast<uint32_t*>(computeShaderCode.data());
+	vk::ShaderModule computeShader = device.createShaderModule(shaderInfo);
+
+	vk::ComputePipelineCreateInfo computePiplineInfo;
+	computePiplineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+	computePiplineInfo.stage.module = computeShader;
+	computePiplineInfo.stage.pName = "main";
+	computePiplineInfo.stage.pSpecializationInfo = &blurSpecInfo;
+	computePiplineInfo.layout = computePiplineLayout_;
+	blurSpecData.direction = 1;
+	hBlurComputePipline_ = device.createComputePipeline(piplineCache_, computePiplineInfo).value;
+	blurSpecData.direction = 0;
+	vBlurComputePipline_ = device.createComputePipeline(piplineCache_, computePiplineInfo).value;
+	device.destroyShaderModule(computeShader);
+
+	if (window_->physicalDeviceProperties()->limits.timestampComputeAndGraphics) {
+		vk::QueryPoolCreateInfo queryPoolInfo;
+		queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+		queryPoolInfo.queryCount = 2 * QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT;
+		blurQueryPool_ = device.createQueryPool(queryPoolInfo);
+	}
+	blurQueryValid_.fill(false);
+
+	// 缩小模糊目标时以线性过滤的blit复制场景，HDR场景目标的rgba16f必然支持，交换链格式需要检查
+	const vk::FormatFeatureFlags blitFeatures = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+	vk::PhysicalDevice physicalDevice = window_->physicalDevice();
+	vk::FormatProperties formatProps = physicalDevice.getFormatProperties(vk::Format(window_->colorFormat()));
+	swapChainBlitSupported_ = (formatProps.optimalTilingFeatures & blitFeatures) == blitFeatures;
+
+	samplerInfo.magFilter = vk::Filter::eLinear;			//降采样与升采样都依赖双线性过滤
+	samplerInfo.minFilter = vk::Filter::eLinear;
+	linearSampler_ = device.createSampler(samplerInfo);
+
+	// 泛光链的各级始终处于eShaderReadOnlyOptimal，升采样需要保留降采样的结果，因此使用eLoad
+	attachmentDesc.format = vk::Format::eR16G16B16A16Sfloat;
+	attachmentDesc.loadOp = vk::AttachmentLoadOp::eLoad;
+	attachmentDesc.initialLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	attachmentDesc.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	attachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
+
+	vk::SubpassDependency bloomDependencies[2];
+	bloomDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	bloomDependencies[0].dstSubpass = 0;
+	bloomDependencies[0].srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eFragmentShader;
+	bloomDependencies[0].dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eFragmentShader;
+	bloomDependencies[0].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	bloomDependencies[0].dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eShaderRead;
+	bloomDependencies[1].srcSubpass = 0;
+	bloomDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	bloomDependencies[1].srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	bloomDependencies[1].dstStageMask = vk::PipelineStageFlagBits::eFragmentShader;
+	bloomDependencies[1].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	bloomDependencies[1].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	renderPassInfo.dependencyCount = 2;
+	renderPassInfo.pDependencies = bloomDependencies;
+	bloomRenderPass_ = device.createRenderPass(renderPassInfo);
+
+	vk::DescriptorSetLayoutBinding bloomLayoutBindings[2] = {
+		{ 0, vk::DescriptorType::eCombinedImageSampler,1,vk::ShaderStageFlagBits::eFragment },
+		{ 1, vk::DescriptorType::eCombinedImageSampler,1,vk::ShaderStageFlagBits::eFragment },		//仅合成时使用
+	};
+	descLayoutInfo.bindingCount = 2;
+	descLayoutInfo.pBindings = bloomLayoutBindings;
+	bloomDescSetLayout_ = device.createDescriptorSetLayout(descLayoutInfo);
+
+	vk::PushConstantRange bloomPushConstant(vk::ShaderStageFlagBits::eFragment, 0, sizeof(BloomParams));
+	piplineLayoutInfo.pSetLayouts = &bloomDescSetLayout_;
+	piplineLayoutInfo.pPushConstantRanges = &bloomPushConstant;
+	bloomPiplineLayout_ = device.createPipelineLayout(piplineLayoutInfo);
+	piplineInfo.layout = bloomPiplineLayout_;
+	piplineInfo.renderPass = bloomRenderPass_;
+
+	auto createBloomPipline = [&](const std::string& filename) {
+		auto code = readFile(filename);
+		shaderInfo.codeSize = code.size();
+		shaderInfo.pCode = reinterpret_cast<uint32_t*>(code.data());
+		piplineShaderStage[1].module = device.createShaderModule(shaderInfo);
+		vk::Pipeline pipline = device.createGraphicsPipeline(piplineCache_, piplineInfo).value;
+		device.destroyShaderModule(piplineShaderStage[1].module);
+		return pipline;
+	};
+
+	piplineShaderStage[1].pSpecializationInfo = &specInfo;
+	specData = 1;
+	prefilterPipline_ = createBloomPipline("./bloom_downsample_frag.spv");
+	specData = 0;
+	downsamplePipline_ = createBloomPipline("./bloom_downsample_frag.spv");
+	piplineShaderStage[1].pSpecializationInfo = nullptr;
+
+	colorBlendAttachmentState.blendEnable = true;			//升采样的结果以加法叠加到上一级
+	colorBlendAttachmentState.srcColorBlendFactor = vk::BlendFactor::eOne;
+	colorBlendAttachmentState.dstColorBlendFactor = vk::BlendFactor::eOne;
+	upsamplePipline_ = createBloomPipline("./bloom_upsample_frag.spv");
+
+	colorBlendAttachmentState.blendEnable = false;
+	piplineInfo.renderPass = window_->defaultRenderPass();		//合成直接输出到交换链
+	piplineShaderStage[1].pSpecializationInfo = &specInfo;
+	specData = hdr ? 1 : 0;
+	compositePipline_ = createBloomPipline("./bloom_composite_frag.spv");
+
 	device.destroyShaderModule(vertShader);
 	device.destroyShaderModule(fragShader);
 
@@ -232,18 +473,47 @@ void BloomRenderer::initResources()
 
 void BloomRenderer::initSwapChainResources() {
 	vk::Device device = window_->device();
+
+	// 首次创建时没有在途帧，布局转换单独提交并等待完成
+	vk::CommandBufferAllocateInfo cmdBufferAlllocInfo;
+	cmdBufferAlllocInfo.level = vk::CommandBufferLevel::ePrimary;
+	cmdBufferAlllocInfo.commandPool = window_->graphicsCommandPool();
+	cmdBufferAlllocInfo.commandBufferCount = 1;
+	vk::CommandBuffer cmdBuffer = device.allocateCommandBuffers(cmdBufferAlllocInfo).front();
+	vk::CommandBufferBeginInfo cmdBufferBeginInfo;
+	cmdBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	cmdBuffer.begin(cmdBufferBeginInfo);
+	createScaledTargets(cmdBuffer);
+	cmdBuffer.end();
+
+	vk::Queue graphicsQueue = window_->graphicsQueue();
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmdBuffer;
+	graphicsQueue.submit(submitInfo);
+	graphicsQueue.waitIdle();
+	device.freeCommandBuffers(window_->graphicsCommandPool(), cmdBuffer);
+}
+
+void BloomRenderer::createScaledTargets(vk::CommandBuffer cmdBuffer)
+{
+	vk::Device device = window_->device();
+	const bool hdr = window_->hdrSceneTarget();
+	blurExtent_ = blurTargetExtent();
+	bloomExtent_ = bloomTargetExtent();
+
 	vk::ImageCreateInfo imageInfo;
 	imageInfo.imageType = vk::ImageType::e2D;
-	imageInfo.extent.width = window_->swapChainImageSize().width();
-	imageInfo.extent.height = window_->swapChainImageSize().height();
+	imageInfo.extent.width = blurExtent_.width;
+	imageInfo.extent.height = blurExtent_.height;
 	imageInfo.extent.depth = 1;
 	imageInfo.arrayLayers = 1;
 	imageInfo.mipLevels = 1;
 	imageInfo.samples = vk::SampleCountFlagBits::e1;
-	imageInfo.format = vk::Format::eR8G8B8A8Unorm;
-	imageInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eColorAttachment;
+	imageInfo.format = hdr ? vk::Format::eR16G16B16A16Sfloat : vk::Format::eR8G8B8A8Unorm;
+	imageInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eStorage;
 	imageInfo.tiling = vk::ImageTiling::eOptimal;
-	imageInfo.initialLayout = vk::ImageLayout::ePreinitialized;
+	imageInfo.initialLayout = vk::ImageLayout::eUndefined;
 	frameBuffer_[0].image = device.createImage(imageInfo);
 	frameBuffer_[1].image = device.createImage(imageInfo);
 	vk::MemoryRequirements memReq = device.getImageMemoryRequirements(frameBuffer_[0].image);
@@ -270,80 +540,234 @@ void BloomRenderer::initSwapChainResources() {
 	framebufferInfo.renderPass = renderPass_;
 	framebufferInfo.attachmentCount = 1;
 	framebufferInfo.pAttachments = &frameBuffer_[0].imageView;
-	framebufferInfo.width = window_->swapChainImageSize().width();
-	framebufferInfo.height = window_->swapChainImageSize().height();
+	framebufferInfo.width = blurExtent_.width;
+	framebufferInfo.height = blurExtent_.height;
 	framebufferInfo.layers = 1;
 	frameBuffer_[0].framebuffer = device.createFramebuffer(framebufferInfo);
 
 	framebufferInfo.pAttachments = &frameBuffer_[1].imageView;
 	frameBuffer_[1].framebuffer = device.createFramebuffer(framebufferInfo);
 
-	vk::ImageMemoryBarrier barrier;
-	barrier.srcAccessMask = vk::AccessFlagBits::eHostWrite;
-	barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-	barrier.oldLayout = vk::ImageLayout::ePreinitialized;
-	barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-	barrier.image = frameBuffer_[0].image;
-	barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
+	// 泛光链从bloomExtent_开始，逐级减半直到短边只剩几个像素
+	uint32_t bloomMipCount = 1;
+	while (bloomMipCount < BLOOM_MAX_MIPS && (std::min(bloomExtent_.width, bloomExtent_.height) >> bloomMipCount) >= 2)
+		bloomMipCount++;
+
+	imageInfo.extent.width = bloomExtent_.width;
+	imageInfo.extent.height = bloomExtent_.height;
+	imageInfo.mipLevels = bloomMipCount;
+	imageInfo.format = vk::Format::eR16G16B16A16Sfloat;
+	imageInfo.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eColorAttachment;
+	bloomImage_ = device.createImage(imageInfo);
+	memReq = device.getImageMemoryRequirements(bloomImage_);
+	memAllocInfo = vk::MemoryAllocateInfo(memReq.size, window_->deviceLocalMemoryIndex());
+	bloomImageMemory_ = device.allocateMemory(memAllocInfo);
+	device.bindImageMemory(bloomImage_, bloomImageMemory_, 0);
 
-	vk::CommandBufferAllocateInfo cmdBufferAlllocInfo;
-	cmdBufferAlllocInfo.level = vk::CommandBufferLevel::ePrimary;
-	cmdBufferAlllocInfo.commandPool = window_->graphicsCommandPool();
-	cmdBufferAlllocInfo.commandBufferCount = 1;
-	vk::CommandBuffer cmdBuffer = device.allocateCommandBuffers(cmdBufferAlllocInfo).front();
-	vk::CommandBufferBeginInfo cmdBufferBeginInfo;
-	cmdBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue;
-	cmdBuffer.begin(cmdBufferBeginInfo);
-	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eHost, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-	barrier.image = frameBuffer_[1].image;
-	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eHost, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-	cmdBuffer.end();
-
-	vk::Queue graphicsQueue = window_->graphicsQueue();
-	vk::SubmitInfo submitInfo;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmdBuffer;
-	graphicsQueue.submit(submitInfo);
-	graphicsQueue.waitIdle();
-	device.freeCommandBuffers(window_->graphicsCommandPool(), cmdBuffer);
+	imageViewInfo.format = imageInfo.format;
+	imageViewInfo.image = bloomImage_;
+
+	framebufferInfo.renderPass = bloomRenderPass_;
+
+	bloomMips_.resize(bloomMipCount);
+	for (uint32_t i = 0; i < bloomMipCount; i++) {
+		BloomMip& mip = bloomMips_[i];
+		mip.extent = vk::Extent2D(std::max(bloomExtent_.width >> i, 1u), std::max(bloomExtent_.height >> i, 1u));
+		imageViewInfo.subresourceRange.baseMipLevel = i;
+		mip.imageView = device.createImageView(imageViewInfo);
+		framebufferInfo.pAttachments = &mip.imageView;
+		framebufferInfo.width = mip.extent.width;
+		framebufferInfo.height = mip.extent.height;
+		mip.framebuffer = device.createFramebuffer(framebufferInfo);
+	}
 
+	// 模糊目标与泛光链在录制之后的命令前都处于eShaderReadOnlyOptimal
+	vk::ImageMemoryBarrier barriers[3];
+	for (vk::ImageMemoryBarrier& barrier : barriers) {
+		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		barrier.oldLayout = vk::ImageLayout::eUndefined;
+		barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+		barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.subresourceRange.levelCount = 1;
+	}
+	barriers[0].image = frameBuffer_[0].image;
+	barriers[1].image = frameBuffer_[1].image;
+	barriers[2].image = bloomImage_;
+	barriers[2].subresourceRange.levelCount = bloomMipCount;
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+		vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader,
+		{}, {}, {}, barriers);
+
+	// descSet_、linearDescSet_、computeDescSet_各2个，泛光链每级2个，两种合成各1个
+	const uint32_t setCount = 6 + BLOOM_MAX_MIPS * 2 + 2;
+	vk::DescriptorPoolSize descPoolSizes[2] = {
+		vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, setCount * 2),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, 2),
+	};
+	vk::DescriptorPoolCreateInfo descPoolInfo;
+	descPoolInfo.maxSets = setCount;
+	descPoolInfo.poolSizeCount = 2;
+	descPoolInfo.pPoolSizes = descPoolSizes;
+	targetDescPool_ = device.createDescriptorPool(descPoolInfo);
+
+	vk::DescriptorSetAllocateInfo descSetAllocInfo(targetDescPool_, 1, &descSetLayout_);
+	vk::DescriptorSetAllocateInfo computeSetAllocInfo(targetDescPool_, 1, &computeDescSetLayout_);
+	vk::DescriptorSetAllocateInfo bloomSetAllocInfo(targetDescPool_, 1, &bloomDescSetLayout_);
 	for (int i = 0; i < 2; ++i) {
-		vk::WriteDescriptorSet descWrite;
-		vk::DescriptorImageInfo descImageInfo(sampler_, frameBuffer_[i].imageView, vk::ImageLayout::eShaderReadOnlyOptimal);
-		descWrite.dstSet = descSet_[i];
-		descWrite.dstBinding = 0;
-		descWrite.descriptorCount = 1;
-		descWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
-		descWrite.pImageInfo = &descImageInfo;
-		device.updateDescriptorSets(1, &descWrite, 0, nullptr);
+		descSet_[i] = device.allocateDescriptorSets(descSetAllocInfo).front();
+		linearDescSet_[i] = device.allocateDescriptorSets(descSetAllocInfo).front();
+		computeDescSet_[i] = device.allocateDescriptorSets(computeSetAllocInfo).front();
+	}
+	for (int i = 0; i < BLOOM_MAX_MIPS; ++i) {
+		bloomDownDescSet_[i] = device.allocateDescriptorSets(bloomSetAllocInfo).front();
+		bloomUpDescSet_[i] = device.allocateDescriptorSets(bloomSetAllocInfo).front();
+	}
+	compositeDescSet_ = device.allocateDescriptorSets(bloomSetAllocInfo).front();
+	gaussCompositeDescSet_ = device.allocateDescriptorSets(bloomSetAllocInfo).front();
+
+	// 模糊的输入始终与模糊目标同尺寸：HDR场景目标未缩小时直接读取场景，否则读取recordSceneCopy缩放到frameBuffer_[0]的副本
+	// 泛光链与合成读取全分辨率的场景：HDR场景目标下为场景本身，否则为frameBuffer_[0]（泛光链模式下与交换链同尺寸）
+	const vk::Extent2D swapChainExtent(window_->swapChainImageSize().width(), window_->swapChainImageSize().height());
+	const vk::ImageView sceneView = hdr ? window_->sceneImageView() : frameBuffer_[0].imageView;
+	const vk::ImageView blurSourceView = hdr && blurExtent_ == swapChainExtent ? sceneView : frameBuffer_[0].imageView;
+	for (int i = 0; i < 2; ++i) {
+		writeImageDescriptor(descSet_[i], 0, sampler_, i == 0 ? blurSourceView : frameBuffer_[i].imageView);
+		writeImageDescriptor(linearDescSet_[i], 0, linearSampler_, i == 0 ? blurSourceView : frameBuffer_[i].imageView);
+	}
+	for (int i = 0; i < 2; ++i) {
+		vk::DescriptorImageInfo descImageInfo[2] = {
+			vk::DescriptorImageInfo(sampler_, i == 0 ? blurSourceView : frameBuffer_[i].imageView, vk::ImageLayout::eShaderReadOnlyOptimal),
+			vk::DescriptorImageInfo({}, frameBuffer_[1 - i].imageView, vk::ImageLayout::eGeneral),
+		};
+		vk::WriteDescriptorSet descWrite[2];
+		for (int binding = 0; binding < 2; binding++) {
+			descWrite[binding].dstSet = computeDescSet_[i];
+			descWrite[binding].dstBinding = binding;
+			descWrite[binding].descriptorCount = 1;
+			descWrite[binding].pImageInfo = &descImageInfo[binding];
+		}
+		descWrite[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+		descWrite[1].descriptorType = vk::DescriptorType::eStorageImage;
+		device.updateDescriptorSets(2, descWrite, 0, nullptr);
+	}
+
+	writeImageDescriptor(bloomDownDescSet_[0], 0, linearSampler_, sceneView);
+	for (uint32_t i = 0; i < bloomMipCount; i++) {
+		if (i > 0)
+			writeImageDescriptor(bloomDownDescSet_[i], 0, linearSampler_, bloomMips_[i - 1].imageView);
+		writeImageDescriptor(bloomUpDescSet_[i], 0, linearSampler_, bloomMips_[i].imageView);
 	}
+	writeImageDescriptor(compositeDescSet_, 0, linearSampler_, sceneView);
+	writeImageDescriptor(compositeDescSet_, 1, linearSampler_, bloomMips_[0].imageView);
+	writeImageDescriptor(gaussCompositeDescSet_, 0, linearSampler_, sceneView);
+	writeImageDescriptor(gaussCompositeDescSet_, 1, linearSampler_, frameBuffer_[0].imageView);		//模糊目标缩小时在合成中双线性放大
+
 	textureRenderer.updateImage(frameBuffer_[0].imageView);
 }
 
-void BloomRenderer::releaseSwapChainResources()
+void BloomRenderer::retireScaledTargets()
 {
+	ScaledTargets targets;
+	std::copy(std::begin(frameBuffer_), std::end(frameBuffer_), targets.frameBuffer);
+	targets.bloomImage = bloomImage_;
+	targets.bloomImageMemory = bloomImageMemory_;
+	targets.bloomMips = std::move(bloomMips_);
+	targets.descPool = targetDescPool_;
+	targets.frames = window_->concurrentFrameCount();
+	retiredTargets_.push_back(std::move(targets));
+	bloomMips_.clear();
+}
+
+void BloomRenderer::destroyRetiredTargets(bool all)
+{
+	// 每帧开始时该帧槽位concurrentFrameCount()帧之前的提交已经完成
 	vk::Device device = window_->device();
-	for (int i = 0; i < std::size(frameBuffer_); i++) {
-		device.freeMemory(frameBuffer_[i].imageMemory);
-		device.destroyImageView(frameBuffer_[i].imageView);
-		device.destroyImage(frameBuffer_[i].image);
-		device.destroyFramebuffer(frameBuffer_[i].framebuffer);
+	for (auto it = retiredTargets_.begin(); it != retiredTargets_.end();) {
+		if (!all && --it->frames > 0) {
+			++it;
+			continue;
+		}
+		for (FrameBuffer& frameBuffer : it->frameBuffer) {
+			device.destroyFramebuffer(frameBuffer.framebuffer);
+			device.destroyImageView(frameBuffer.imageView);
+			device.destroyImage(frameBuffer.image);
+			device.freeMemory(frameBuffer.imageMemory);
+		}
+		for (auto& mip : it->bloomMips) {
+			device.destroyFramebuffer(mip.framebuffer);
+			device.destroyImageView(mip.imageView);
+		}
+		device.destroyImage(it->bloomImage);
+		device.freeMemory(it->bloomImageMemory);
+		device.destroyDescriptorPool(it->descPool);
+		it = retiredTargets_.erase(it);
 	}
 }
 
+vk::Extent2D BloomRenderer::blurTargetExtent() const
+{
+	// 非HDR的泛光链模式下frameBuffer_[0]是合成使用的场景副本，交换链格式不支持blit时只能原样复制，这两种情况下尺寸须与交换链一致
+	const bool fullSize = !window_->hdrSceneTarget() && (bloomMode_ == BloomMode::MipChain || !swapChainBlitSupported_);
+	const float scale = fullSize ? 1.0f : blurResolutionScale_;
+	return vk::Extent2D(std::max(uint32_t(window_->swapChainImageSize().width() * scale), 1u),
+		std::max(uint32_t(window_->swapChainImageSize().height() * scale), 1u));
+}
+
+vk::Extent2D BloomRenderer::bloomTargetExtent() const
+{
+	// 泛光链从缩放后的半分辨率开始
+	const float scale = blurResolutionScale_ * 0.5f;
+	return vk::Extent2D(std::max(uint32_t(window_->swapChainImageSize().width() * scale), 1u),
+		std::max(uint32_t(window_->swapChainImageSize().height() * scale), 1u));
+}
+
+void BloomRenderer::writeImageDescriptor(vk::DescriptorSet descSet, uint32_t binding, vk::Sampler sampler, vk::ImageView imageView)
+{
+	vk::WriteDescriptorSet descWrite;
+	vk::DescriptorImageInfo descImageInfo(sampler, imageView, vk::ImageLayout::eShaderReadOnlyOptimal);
+	descWrite.dstSet = descSet;
+	descWrite.dstBinding = binding;
+	descWrite.descriptorCount = 1;
+	descWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+	descWrite.pImageInfo = &descImageInfo;
+	vk::Device(window_->device()).updateDescriptorSets(1, &descWrite, 0, nullptr);
+}
+
+void BloomRenderer::releaseSwapChainResources()
+{
+	// 交换链重建前设备已经空闲，当前的与尚未销毁的旧资源都可以立即释放
+	retireScaledTargets();
+	destroyRetiredTargets(true);
+}
+
 void BloomRenderer::releaseResources()
 {
 	vk::Device device = window_->device();
 	device.destroySampler(sampler_);
 	device.destroyRenderPass(renderPass_);
-	device.destroyDescriptorPool(descPool_);
 	device.destroyDescriptorSetLayout(descSetLayout_);
 	device.destroyPipeline(hBlurPipline_);
 	device.destroyPipeline(vBlurPipline_);
+	for (int i = 0; i < LINEAR_BLUR_KERNEL_COUNT; i++) {
+		device.destroyPipeline(linearHBlurPipline_[i]);
+		device.destroyPipeline(linearVBlurPipline_[i]);
+	}
 	device.destroyPipelineCache(piplineCache_);
 	device.destroyPipelineLayout(piplineLayout_);
+	device.destroySampler(linearSampler_);
+	device.destroyRenderPass(bloomRenderPass_);
+	device.destroyDescriptorSetLayout(bloomDescSetLayout_);
+	device.destroyPipeline(prefilterPipline_);
+	device.destroyPipeline(downsamplePipline_);
+	device.destroyPipeline(upsamplePipline_);
+	device.destroyPipeline(compositePipline_);
+	device.destroyPipelineLayout(bloomPiplineLayout_);
+	device.destroyDescriptorSetLayout(computeDescSetLayout_);
+	device.destroyPipeline(hBlurComputePipline_);
+	device.destroyPipeline(vBlurComputePipline_);
+	device.destroyPipelineLayout(computePiplineLayout_);
+	device.destroyQueryPool(blurQueryPool_);
 	textureRenderer.releaseResources();
 }
 
@@ -351,85 +775,391 @@ void BloomRenderer::startNextFrame()
 {
 	vk::Device device = window_->device();
 	vk::CommandBuffer cmdBuffer = window_->currentCommandBuffer();
-	vk::Image currentImage = window_->swapChainImage(window_->currentSwapChainImageIndex());
-	vk::ImageMemoryBarrier barrier;
-	barrier.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
-	barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
-	barrier.oldLayout = vk::ImageLayout::ePresentSrcKHR;
-	barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
-	barrier.image = currentImage;
-	barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
-	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+	// 缩放比例或模式变化后在本帧的命令缓冲中重建模糊目标与泛光链，被替换的资源等引用它们的在途帧结束后再销毁，不必等待设备空闲
+	// 上一批旧资源销毁之前不再重建，保证TextureRenderer轮流使用的两个描述符集不会被在途帧占用
+	destroyRetiredTargets(false);
+	if (retiredTargets_.empty() && (blurTargetExtent() != blurExtent_ || bloomTargetExtent() != bloomExtent_)) {
+		retireScaledTargets();
+		createScaledTargets(cmdBuffer);
+	}
 
-	barrier.oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-	barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
-	barrier.image = frameBuffer_[0].image;
-	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+	recordSceneCopy(cmdBuffer);
+
+	// 读取该帧槽位上一次提交的耗时，结果未就绪时不等待；耗时对应该槽位上一次实际录制的路径
+	// 泛光链模式下计时覆盖降采样与升采样，同样用于自动缩放
+	const int frame = window_->currentFrame();
+	const BlurPath timedPath = blurPathTaken_[frame];
+	bool timeValid = false;
+	double timeMs = 0;
+	if (blurQueryPool_) {
+		uint64_t time[2];
+		if (blurQueryValid_[frame] && device.getQueryPoolResults(blurQueryPool_, frame * 2, 2, sizeof(time), time, sizeof(uint64_t), vk::QueryResultFlagBits::e64) == vk::Result::eSuccess) {
+			timeMs = (time[1] - time[0]) * window_->physicalDeviceProperties()->limits.timestampPeriod / 1e6;
+			blurTimeMs_ = timeMs;
+			timeValid = true;
+		}
+		cmdBuffer.resetQueryPool(blurQueryPool_, frame * 2, 2);
+		cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, blurQueryPool_, frame * 2);
+	}
 
-	vk::ImageCopy imageCopy;
-	imageCopy.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-	imageCopy.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-	imageCopy.srcSubresource.layerCount = 1;
-	imageCopy.dstSubresource.layerCount = 1;
+	if (bloomMode_ == BloomMode::MipChain)
+		recordMipChain(cmdBuffer);
+	else {
+		const BlurPath path = effectiveBlurPath();
+		if (path == BlurPath::Compute)
+			recordComputeBlur(cmdBuffer);
+		else if (path == BlurPath::Linear)
+			recordFragmentBlur(cmdBuffer, linearHBlurPipline_[blurParams_.size - 1], linearVBlurPipline_[blurParams_.size - 1], linearDescSet_);
+		else
+			recordFragmentBlur(cmdBuffer, hBlurPipline_, vBlurPipline_, descSet_);
+		blurPathTaken_[frame] = path;
+	}
 
-	imageCopy.extent.width = window_->swapChainImageSize().width();
-	imageCopy.extent.height = window_->swapChainImageSize().height();
-	imageCopy.extent.depth = 1;
-	cmdBuffer.copyImage(currentImage, vk::ImageLayout::eTransferSrcOptimal, frameBuffer_[0].image, vk::ImageLayout::eTransferDstOptimal, imageCopy);
+	if (blurQueryPool_) {
+		cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, blurQueryPool_, frame * 2 + 1);
+		blurQueryValid_[frame] = true;
+	}
+	if (bloomMode_ == BloomMode::Gaussian)
+		updateBlurBenchmark(timeValid, timeMs, timedPath);
+	updateBlurAutoScale(timeValid, timeMs);
+
+	vk::Extent2D swapChainExtent(window_->swapChainImageSize().width(), window_->swapChainImageSize().height());
+	if (bloomMode_ == BloomMode::MipChain)
+		recordBloomPass(cmdBuffer, window_->defaultRenderPass(), window_->currentFramebuffer(), swapChainExtent, compositePipline_, compositeDescSet_);
+	else if (window_->hdrSceneTarget())
+		recordBloomPass(cmdBuffer, window_->defaultRenderPass(), window_->currentFramebuffer(), swapChainExtent, compositePipline_, gaussCompositeDescSet_);
+	else
+		textureRenderer.startNextFrame();
+}
+
+BloomRenderer::BlurPath BloomRenderer::effectiveBlurPath() const
+{
+	// 偏移超出共享内存apron时计算着色器路径退回片段着色器路径；偏移被缩放后相邻样本不再相邻，线性采样无法合并，同样退回
+	if (blurPath_ == BlurPath::Compute && (blurParams_.size - 1) * blurParams_.scale > BLUR_APRON)
+		return BlurPath::Fragment;
+	if (blurPath_ == BlurPath::Linear && blurParams_.scale != 1.0f)
+		return BlurPath::Fragment;
+	return blurPath_;
+}
+
+void BloomRenderer::recordSceneCopy(vk::CommandBuffer cmdBuffer)
+{
+	// 非HDR时场景只存在于交换链，总是复制到frameBuffer_[0]；HDR场景目标下只有高斯模糊的目标缩小时才需要缩小的副本
+	const bool hdr = window_->hdrSceneTarget();
+	const vk::Extent2D swapChainExtent(window_->swapChainImageSize().width(), window_->swapChainImageSize().height());
+	if (hdr && (bloomMode_ == BloomMode::MipChain || blurExtent_ == swapChainExtent))
+		return;
 
+	const vk::Image sceneImage = hdr ? window_->sceneImage() : vk::Image(window_->swapChainImage(window_->currentSwapChainImageIndex()));
+	const vk::ImageLayout sceneLayout = hdr ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::ePresentSrcKHR;
+	vk::ImageMemoryBarrier barriers[2];
+	for (vk::ImageMemoryBarrier& barrier : barriers) {
+		barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.subresourceRange.levelCount = 1;
+	}
+	barriers[0].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	barriers[0].dstAccessMask = vk::AccessFlagBits::eTransferRead;
+	barriers[0].oldLayout = sceneLayout;
+	barriers[0].newLayout = vk::ImageLayout::eTransferSrcOptimal;
+	barriers[0].image = sceneImage;
+	barriers[1].dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barriers[1].oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	barriers[1].newLayout = vk::ImageLayout::eTransferDstOptimal;
+	barriers[1].image = frameBuffer_[0].image;
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barriers);
+
+	// blit按目标尺寸双线性缩小，同时完成交换链BGRA到RGBA的通道转换
+	if (hdr || swapChainBlitSupported_) {
+		vk::ImageBlit imageBlit;
+		imageBlit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		imageBlit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		imageBlit.srcSubresource.layerCount = 1;
+		imageBlit.dstSubresource.layerCount = 1;
+		imageBlit.srcOffsets[1] = vk::Offset3D(swapChainExtent.width, swapChainExtent.height, 1);
+		imageBlit.dstOffsets[1] = vk::Offset3D(blurExtent_.width, blurExtent_.height, 1);
+		cmdBuffer.blitImage(sceneImage, vk::ImageLayout::eTransferSrcOptimal, frameBuffer_[0].image, vk::ImageLayout::eTransferDstOptimal, imageBlit, vk::Filter::eLinear);
+	}
+	else {
+		vk::ImageCopy imageCopy;
+		imageCopy.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		imageCopy.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		imageCopy.srcSubresource.layerCount = 1;
+		imageCopy.dstSubresource.layerCount = 1;
+		imageCopy.extent = vk::Extent3D(swapChainExtent, 1);
+		cmdBuffer.copyImage(sceneImage, vk::ImageLayout::eTransferSrcOptimal, frameBuffer_[0].image, vk::ImageLayout::eTransferDstOptimal, imageCopy);
+	}
+
+	// 场景副本随后由片段着色器或计算着色器读取
+	barriers[1].srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barriers[1].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	barriers[1].oldLayout = vk::ImageLayout::eTransferDstOptimal;
+	barriers[1].newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, barriers[1]);
+
+	// 交换链随后作为合成的附件，HDR场景则在合成中被采样
+	barriers[0].srcAccessMask = vk::AccessFlagBits::eTransferRead;
+	barriers[0].dstAccessMask = hdr ? vk::AccessFlagBits::eShaderRead : vk::AccessFlagBits::eColorAttachmentWrite;
+	barriers[0].oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+	barriers[0].newLayout = sceneLayout;
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, hdr ? vk::PipelineStageFlagBits::eFragmentShader : vk::PipelineStageFlagBits::eColorAttachmentOutput, {}, {}, {}, barriers[0]);
+}
+
+void BloomRenderer::recordFragmentBlur(vk::CommandBuffer cmdBuffer, vk::Pipeline hBlurPipline, vk::Pipeline vBlurPipline, const vk::DescriptorSet* descSets)
+{
 	vk::ClearValue clearValues[3] = {
 		vk::ClearColorValue(std::array<float,4>{1.0f,0.0f,0.0f,1.0f }),
 		vk::ClearDepthStencilValue(1.0f,0),
 	};
 
-	barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-	barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-	barrier.image = frameBuffer_[0].image;
-	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+	vk::ImageMemoryBarrier barrier;
+	barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.subresourceRange.levelCount = 1;
 
 	vk::RenderPassBeginInfo beginInfo;
 	beginInfo.renderPass = renderPass_;
 	beginInfo.framebuffer = frameBuffer_[1].framebuffer;
-	beginInfo.renderArea.extent.width = window_->swapChainImageSize().width();
-	beginInfo.renderArea.extent.height = window_->swapChainImageSize().height();
+	beginInfo.renderArea.extent = blurExtent_;
 	beginInfo.clearValueCount = 2;
 	beginInfo.pClearValues = clearValues;
+
+	vk::Viewport viewport;
+	viewport.x = viewport.y = 0;
+	viewport.width = beginInfo.renderArea.extent.width;
+	viewport.height = beginInfo.renderArea.extent.height;
+	viewport.minDepth = 0;
+	viewport.maxDepth = 1;
+
 	cmdBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
-	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, hBlurPipline_);
-	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, piplineLayout_, 0, 1, &descSet_[0], 0, nullptr);
+	cmdBuffer.setViewport(0, viewport);
+	cmdBuffer.setScissor(0, beginInfo.renderArea);
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, hBlurPipline);
+	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, piplineLayout_, 0, 1, &descSets[0], 0, nullptr);
 	cmdBuffer.pushConstants<BlurParams>(piplineLayout_, pushConstant_.stageFlags, 0, blurParams_);
 	cmdBuffer.draw(4, 1, 0, 0);
 	cmdBuffer.endRenderPass();
 
+	barrier.srcAccessMask = vk::AccessFlagBits::eShaderRead;
+	barrier.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
 	barrier.oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
 	barrier.newLayout = vk::ImageLayout::eColorAttachmentOptimal;
 	barrier.image = frameBuffer_[0].image;
-	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eColorAttachmentOutput, {}, {}, {}, barrier);
 
+	barrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 	barrier.oldLayout = vk::ImageLayout::eColorAttachmentOptimal;
 	barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
 	barrier.image = frameBuffer_[1].image;
-	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier);
 
 	beginInfo.framebuffer = frameBuffer_[0].framebuffer;
 	cmdBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
-	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, vBlurPipline_);
-	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, piplineLayout_, 0, 1, &descSet_[1], 0, nullptr);
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, vBlurPipline);
+	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, piplineLayout_, 0, 1, &descSets[1], 0, nullptr);
 	cmdBuffer.pushConstants<BlurParams>(piplineLayout_, pushConstant_.stageFlags, 0, blurParams_);
 	cmdBuffer.draw(4, 1, 0, 0);
 	cmdBuffer.endRenderPass();
 
-	barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
-	barrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
-	barrier.image = currentImage;
-	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-
+	barrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 	barrier.oldLayout = vk::ImageLayout::eColorAttachmentOptimal;
 	barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
 	barrier.image = frameBuffer_[0].image;
-	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier);
+}
+
+void BloomRenderer::recordComputeBlur(vk::CommandBuffer cmdBuffer)
+{
+	const uint32_t width = blurExtent_.width;
+	const uint32_t height = blurExtent_.height;
+
+	vk::ImageMemoryBarrier barrier;
+	barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.subresourceRange.levelCount = 1;
+
+	// 水平：frameBuffer_[0] -> frameBuffer_[1]
+	barrier.srcAccessMask = vk::AccessFlagBits::eShaderRead;
+	barrier.dstAccessMask = vk::AccessFlagBits::eShaderWrite;
+	barrier.oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	barrier.newLayout = vk::ImageLayout::eGeneral;
+	barrier.image = frameBuffer_[1].image;
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, barrier);
+
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, hBlurComputePipline_);
+	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computePiplineLayout_, 0, 1, &computeDescSet_[0], 0, nullptr);
+	cmdBuffer.pushConstants<BlurParams>(computePiplineLayout_, vk::ShaderStageFlagBits::eCompute, 0, blurParams_);
+	cmdBuffer.dispatch((width + 255) / 256, height, 1);
+
+	// 竖直：frameBuffer_[1] -> frameBuffer_[0]
+	vk::ImageMemoryBarrier barriers[2] = { barrier, barrier };
+	barriers[0].srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+	barriers[0].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	barriers[0].oldLayout = vk::ImageLayout::eGeneral;
+	barriers[0].newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	barriers[0].image = frameBuffer_[1].image;
+	barriers[1].srcAccessMask = vk::AccessFlagBits::eShaderRead;
+	barriers[1].dstAccessMask = vk::AccessFlagBits::eShaderWrite;
+	barriers[1].oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	barriers[1].newLayout = vk::ImageLayout::eGeneral;
+	barriers[1].image = frameBuffer_[0].image;
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, barriers);
+
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, vBlurComputePipline_);
+	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computePiplineLayout_, 0, 1, &computeDescSet_[1], 0, nullptr);
+	cmdBuffer.dispatch((height + 255) / 256, width, 1);
+
+	barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	barrier.oldLayout = vk::ImageLayout::eGeneral;
+	barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	barrier.image = frameBuffer_[0].image;
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier);
+}
+
+void BloomRenderer::startBlurBenchmark(const std::vector<QSize>& resolutions, const std::vector<int>& sizes, int frames)
+{
+	if (resolutions.empty() || sizes.empty() || frames <= 0)
+		return;
+	blurBenchmark_.running = true;
+	blurBenchmark_.resolutions = resolutions;
+	blurBenchmark_.sizes = sizes;
+	blurBenchmark_.frames = frames;
+	blurBenchmark_.config = 0;
+	blurBenchmark_.skipFrames = QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT;
+	blurBenchmark_.sampleCount = 0;
+	blurBenchmark_.totalMs = 0;
+	blurBenchmark_.lastPath = blurPath_;
+	blurBenchmark_.lastSize = blurParams_.size;
+	setBlurPath(BlurPath::Fragment);
+	setBlurSize(sizes.front());
+	QSize resolution = resolutions.front() / window_->devicePixelRatio();
+	QMetaObject::invokeMethod(window_, [window = window_, resolution]() { window->resize(resolution); }, Qt::QueuedConnection);
+}
+
+void BloomRenderer::updateBlurBenchmark(bool timeValid, double timeMs, BlurPath timedPath)
+{
+	BlurBenchmark& bench = blurBenchmark_;
+	if (!bench.running)
+		return;
+	if (bench.skipFrames > 0) {
+		bench.skipFrames--;
+		return;
+	}
+	if (!timeValid || timedPath != blurPath_)			//只统计按当前配置的路径实际录制的帧
+		return;
+	bench.totalMs += timeMs;
+	if (++bench.sampleCount < bench.frames)
+		return;
+
+	qDebug() << "blur resolution:" << window_->swapChainImageSize()
+		<< "size:" << blurParams_.size
+		<< "path:" << blurPathNames[(int)timedPath]
+		<< "avg:" << bench.totalMs / bench.sampleCount << "ms";
+	nextBlurBenchmarkConfig();
+}
 
-	textureRenderer.startNextFrame();
+void BloomRenderer::nextBlurBenchmarkConfig()
+{
+	// 每个分辨率下依次测量各半径的所有路径，会退回其他路径的配置直接跳过
+	BlurBenchmark& bench = blurBenchmark_;
+	const size_t configsPerResolution = bench.sizes.size() * BLUR_PATH_COUNT;
+	const size_t resolutionIndex = bench.config / configsPerResolution;
+	for (;;) {
+		if (++bench.config >= bench.resolutions.size() * configsPerResolution) {
+			bench.running = false;
+			setBlurPath(bench.lastPath);
+			setBlurSize(bench.lastSize);
+			return;
+		}
+		setBlurPath(BlurPath(bench.config % BLUR_PATH_COUNT));
+		setBlurSize(bench.sizes[bench.config / BLUR_PATH_COUNT % bench.sizes.size()]);
+		if (effectiveBlurPath() == blurPath_)
+			break;
+		qDebug() << "blur size:" << blurParams_.size << "path:" << blurPathNames[(int)blurPath_]
+			<< "falls back to" << blurPathNames[(int)effectiveBlurPath()] << ", skipped";
+	}
+	bench.skipFrames = QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT;
+	bench.sampleCount = 0;
+	bench.totalMs = 0;
+	if (bench.config / configsPerResolution != resolutionIndex) {
+		bench.skipFrames += 10;			//等待交换链按新尺寸重建
+		QSize resolution = bench.resolutions[bench.config / configsPerResolution] / window_->devicePixelRatio();
+		QMetaObject::invokeMethod(window_, [window = window_, resolution]() { window->resize(resolution); }, Qt::QueuedConnection);
+	}
+}
+
+void BloomRenderer::updateBlurAutoScale(bool timeValid, double timeMs)
+{
+	BlurAutoScale& autoScale = blurAutoScale_;
+	if (!autoScale.enabled || blurBenchmark_.running)
+		return;
+	if (autoScale.skipFrames > 0) {
+		autoScale.skipFrames--;
+		return;
+	}
+	if (!timeValid)
+		return;
+	autoScale.totalMs += timeMs;
+	if (++autoScale.sampleCount < BLUR_AUTO_SCALE_FRAMES)
+		return;
+
+	// 像素数随比例的平方变化：超出预算时减半，放大一级后预计仍低于预算的一半时才加倍，避免来回切换
+	const double avgMs = autoScale.totalMs / autoScale.sampleCount;
+	float scale = blurResolutionScale_;
+	if (avgMs > autoScale.budgetMs)
+		scale = std::max(scale * 0.5f, BLUR_MIN_RESOLUTION_SCALE);
+	else if (avgMs * 4 < autoScale.budgetMs * 0.5)
+		scale = std::min(scale * 2.0f, 1.0f);
+	autoScale.sampleCount = 0;
+	autoScale.totalMs = 0;
+	if (scale != blurResolutionScale_) {
+		qDebug() << "blur avg:" << avgMs << "ms budget:" << autoScale.budgetMs << "ms, resolution scale:" << blurResolutionScale_ << "->" << scale;
+		setBlurResolutionScale(scale);
+		autoScale.skipFrames = QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT;
+	}
+}
+
+void BloomRenderer::recordMipChain(vk::CommandBuffer cmdBuffer)
+{
+	for (size_t i = 0; i < bloomMips_.size(); i++)
+		recordBloomPass(cmdBuffer, bloomRenderPass_, bloomMips_[i].framebuffer, bloomMips_[i].extent, i == 0 ? prefilterPipline_ : downsamplePipline_, bloomDownDescSet_[i]);
+	for (size_t i = bloomMips_.size() - 1; i > 0; i--)
+		recordBloomPass(cmdBuffer, bloomRenderPass_, bloomMips_[i - 1].framebuffer, bloomMips_[i - 1].extent, upsamplePipline_, bloomUpDescSet_[i]);
+}
+
+void BloomRenderer::recordBloomPass(vk::CommandBuffer cmdBuffer, vk::RenderPass renderPass, vk::Framebuffer framebuffer, vk::Extent2D extent, vk::Pipeline pipline, vk::DescriptorSet descSet)
+{
+	vk::ClearValue clearValues[3] = {
+		vk::ClearColorValue(std::array<float,4>{0.0f,0.0f,0.0f,1.0f }),
+		vk::ClearDepthStencilValue(1.0f,0),
+		vk::ClearColorValue(std::array<float,4>{ 0.0f,0.0f,0.0f,1.0f }),
+	};
+
+	vk::RenderPassBeginInfo beginInfo;
+	beginInfo.renderPass = renderPass;
+	beginInfo.framebuffer = framebuffer;
+	beginInfo.renderArea.extent = extent;
+	if (renderPass == window_->defaultRenderPass()) {
+		beginInfo.clearValueCount = window_->sampleCountFlagBits() > VK_SAMPLE_COUNT_1_BIT ? 3 : 2;
+		beginInfo.pClearValues = clearValues;
+	}
+	cmdBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
+
+	vk::Viewport viewport;
+	viewport.x = viewport.y = 0;
+	viewport.width = extent.width;
+	viewport.height = extent.height;
+	viewport.minDepth = 0;
+	viewport.maxDepth = 1;
+	cmdBuffer.setViewport(0, viewport);
+	cmdBuffer.setScissor(0, vk::Rect2D({ 0, 0 }, extent));
+
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipline);
+	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, bloomPiplineLayout_, 0, 1, &descSet, 0, nullptr);
+	cmdBuffer.pushConstants<BloomParams>(bloomPiplineLayout_, vk::ShaderStageFlagBits::eFragment, 0, bloomParams_);
+	cmdBuffer.draw(3, 1, 0, 0);
+	cmdBuffer.endRenderPass();
 }
\ No newline at end of file
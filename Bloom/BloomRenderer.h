@@ -3,19 +3,64 @@
 #include "TextureRenderer.h"
 #include "QVKWindow.h"
 
+#define BLOOM_MAX_MIPS 6
+#define LINEAR_BLUR_KERNEL_COUNT 39		//线性采样模糊的核个数，对应setBlurSize的1~39
+#define BLUR_MIN_RESOLUTION_SCALE 0.25f		//模糊目标最多缩小到交换链的1/4
+#define BLUR_AUTO_SCALE_FRAMES 30				//自动缩放每次统计的帧数
+#define BLUR_APRON 64			//计算着色器模糊在共享内存两侧额外加载的像素数，与gaussblur_comp.glsl一致
+
 class BloomRenderer : public QVkRenderer
 {
 public:
+	enum class BloomMode {
+		Gaussian,		//全分辨率的两次可分离高斯模糊
+		MipChain		//高亮提取后逐级降采样，再以tent滤波逐级升采样叠加
+	};
+
+	enum class BlurPath {
+		Fragment,		//每个像素每个方向 2*size-1 次纹理采样
+		Compute,		//每个工作组将一段像素和两侧的apron载入共享内存后再卷积，HDR场景目标下写rgba16f
+		Linear			//双线性过滤一次采样两个纹素，偏移和权重在编译期由setBlurSize的权重两两合并并作为特化常量
+	};
+
 	BloomRenderer();
 	void setBlurSize(int size);
 	void setBlurStrength(float strength);
 	void setBlurScale(float scale);
+	float blurResolutionScale() const { return blurResolutionScale_; }
+	void setBlurResolutionScale(float scale);			//模糊目标与泛光链相对交换链的边长比例
+	void setBlurAutoScale(bool enabled, float budgetMs);	//根据测得的模糊耗时在1~1/4之间调整比例
+	BloomMode bloomMode() const { return bloomMode_; }
+	void setBloomMode(BloomMode mode);
+	void setBloomThreshold(float threshold, float knee);
+	void setBloomIntensity(float intensity);
+	void setExposure(float exposure);			//仅在HDR场景目标下使用
+	BlurPath blurPath() const { return blurPath_; }
+	void setBlurPath(BlurPath path);
+	double blurTimeMs() const { return blurTimeMs_; }
+	void startBlurBenchmark(const std::vector<QSize>& resolutions, const std::vector<int>& sizes, int frames);
 
 	void initResources() override;
 	void initSwapChainResources() override;
 	void releaseSwapChainResources() override;
 	void releaseResources() override;
 	void startNextFrame() override;
+private:
+	void createScaledTargets(vk::CommandBuffer cmdBuffer);
+	void retireScaledTargets();
+	void destroyRetiredTargets(bool all);
+	vk::Extent2D blurTargetExtent() const;
+	vk::Extent2D bloomTargetExtent() const;
+	void writeImageDescriptor(vk::DescriptorSet descSet, uint32_t binding, vk::Sampler sampler, vk::ImageView imageView);
+	void updateBlurAutoScale(bool timeValid, double timeMs);
+	void recordSceneCopy(vk::CommandBuffer cmdBuffer);
+	void recordMipChain(vk::CommandBuffer cmdBuffer);
+	void recordBloomPass(vk::CommandBuffer cmdBuffer, vk::RenderPass renderPass, vk::Framebuffer framebuffer, vk::Extent2D extent, vk::Pipeline pipline, vk::DescriptorSet descSet);
+	void recordFragmentBlur(vk::CommandBuffer cmdBuffer, vk::Pipeline hBlurPipline, vk::Pipeline vBlurPipline, const vk::DescriptorSet* descSets);
+	void recordComputeBlur(vk::CommandBuffer cmdBuffer);
+	BlurPath effectiveBlurPath() const;			//实际录制的路径，当前参数不支持blurPath_时退回Fragment
+	void updateBlurBenchmark(bool timeValid, double timeMs, BlurPath timedPath);
+	void nextBlurBenchmarkConfig();
 private:
 	struct FrameBuffer {
 		vk::Framebuffer framebuffer;
@@ -23,10 +68,21 @@ private:
 		vk::DeviceMemory imageMemory;
 		vk::ImageView imageView;
 	}frameBuffer_[2];
+	vk::Extent2D blurExtent_;
+	vk::Extent2D bloomExtent_;
+	bool swapChainBlitSupported_ = false;			//交换链格式支持线性过滤的blit时才能缩小非HDR的模糊目标
+	float blurResolutionScale_ = 1.0f;
+	struct BlurAutoScale {
+		bool enabled = false;
+		float budgetMs = 1.0f;
+		int skipFrames = 0;			//切换比例后丢弃在途帧
+		int sampleCount = 0;
+		double totalMs = 0;
+	}blurAutoScale_;
 
 	vk::Sampler sampler_;
 	vk::RenderPass renderPass_;
-	vk::DescriptorPool descPool_;
+	vk::DescriptorPool targetDescPool_;			//引用模糊目标与泛光链的描述符集都从这里分配，随它们一起重建
 	vk::DescriptorSetLayout descSetLayout_;
 	vk::DescriptorSet descSet_[2];
 	vk::PipelineCache piplineCache_;
@@ -42,6 +98,75 @@ private:
 		float weight[40] = { 0.227027f,0.1945946f,0.1216216f,0.054054f , 0.016216f };
 	}blurParams_;
 
+	BlurPath blurPath_ = BlurPath::Fragment;
+	vk::DescriptorSet linearDescSet_[2];			//与descSet_相同，但使用线性过滤的采样器
+	vk::Pipeline linearHBlurPipline_[LINEAR_BLUR_KERNEL_COUNT];		//第size-1项对应setBlurSize(size)
+	vk::Pipeline linearVBlurPipline_[LINEAR_BLUR_KERNEL_COUNT];
+	vk::DescriptorSetLayout computeDescSetLayout_;
+	vk::DescriptorSet computeDescSet_[2];			//与descSet_相同的读取方向，写入另一张图像
+	vk::PipelineLayout computePiplineLayout_;
+	vk::Pipeline hBlurComputePipline_;
+	vk::Pipeline vBlurComputePipline_;
+
+	vk::QueryPool blurQueryPool_;
+	std::array<bool, QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT> blurQueryValid_ = {};
+	std::array<BlurPath, QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT> blurPathTaken_ = {};		//各帧槽位上一次实际录制的模糊路径
+	double blurTimeMs_ = 0;
+	struct BlurBenchmark {
+		bool running = false;
+		std::vector<QSize> resolutions;
+		std::vector<int> sizes;
+		int frames = 0;
+		size_t config = 0;			//按 分辨率 x 半径 x 路径 展开后的序号
+		int skipFrames = 0;			//切换配置后丢弃在途帧以及等待交换链重建的帧
+		int sampleCount = 0;
+		double totalMs = 0;
+		BlurPath lastPath;
+		int lastSize;
+	}blurBenchmark_;
+
+	BloomMode bloomMode_ = BloomMode::Gaussian;
+	vk::Sampler linearSampler_;
+	vk::RenderPass bloomRenderPass_;
+	vk::DescriptorSetLayout bloomDescSetLayout_;
+	vk::DescriptorSet bloomDownDescSet_[BLOOM_MAX_MIPS];		//第i级降采样读取场景或第i-1级
+	vk::DescriptorSet bloomUpDescSet_[BLOOM_MAX_MIPS];			//升采样读取第i级，叠加到第i-1级
+	vk::DescriptorSet compositeDescSet_;
+	vk::DescriptorSet gaussCompositeDescSet_;				//HDR场景目标下合成场景与高斯模糊的结果
+	vk::PipelineLayout bloomPiplineLayout_;
+	vk::Pipeline prefilterPipline_;
+	vk::Pipeline downsamplePipline_;
+	vk::Pipeline upsamplePipline_;
+	vk::Pipeline compositePipline_;
+
+	vk::Image bloomImage_;
+	vk::DeviceMemory bloomImageMemory_;
+	struct BloomMip {
+		vk::ImageView imageView;
+		vk::Framebuffer framebuffer;
+		vk::Extent2D extent;
+	};
+	std::vector<BloomMip> bloomMips_;
+
+	// 缩放比例或模式变化时被替换的资源，保留到引用它们的在途帧全部结束后再销毁
+	struct ScaledTargets {
+		FrameBuffer frameBuffer[2];
+		vk::Image bloomImage;
+		vk::DeviceMemory bloomImageMemory;
+		std::vector<BloomMip> bloomMips;
+		vk::DescriptorPool descPool;
+		int frames = 0;			//剩余帧数，归零时销毁
+	};
+	std::vector<ScaledTargets> retiredTargets_;
+
+	struct BloomParams {
+		float threshold = 0.8f;
+		float knee = 0.4f;
+		float radius = 1.0f;
+		float intensity = 0.6f;
+		float exposure = 1.0f;
+	}bloomParams_;
+
 	TextureRenderer textureRenderer;
 };
 
@@ -19,6 +19,59 @@ void QVkScene::removeRenderer(std::shared_ptr<QVkRenderer> renderer)
 
 void QVkScene::initResources()
 {
+	if (hdrSceneTarget_) {
+		vk::Device device = window_->device();
+		vk::AttachmentDescription attachmentDesc[2];
+		attachmentDesc[0].format = vk::Format::eR16G16B16A16Sfloat;
+		attachmentDesc[0].samples = vk::SampleCountFlagBits::e1;
+		attachmentDesc[0].loadOp = vk::AttachmentLoadOp::eClear;
+		attachmentDesc[0].storeOp = vk::AttachmentStoreOp::eStore;
+		attachmentDesc[0].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+		attachmentDesc[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+		attachmentDesc[0].initialLayout = vk::ImageLayout::eUndefined;
+		attachmentDesc[0].finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;		//结束后直接供后处理采样
+
+		attachmentDesc[1].format = vk::Format(window_->depthStencilFormat());
+		attachmentDesc[1].samples = vk::SampleCountFlagBits::e1;
+		attachmentDesc[1].loadOp = vk::AttachmentLoadOp::eClear;
+		attachmentDesc[1].storeOp = vk::AttachmentStoreOp::eDontCare;
+		attachmentDesc[1].stencilLoadOp = vk::AttachmentLoadOp::eClear;
+		attachmentDesc[1].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+		attachmentDesc[1].initialLayout = vk::ImageLayout::eUndefined;
+		attachmentDesc[1].finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+		vk::AttachmentReference colorRef(0, vk::ImageLayout::eColorAttachmentOptimal);
+		vk::AttachmentReference depthRef(1, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+		vk::SubpassDescription subpassDesc;
+		subpassDesc.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+		subpassDesc.colorAttachmentCount = 1;
+		subpassDesc.pColorAttachments = &colorRef;
+		subpassDesc.pDepthStencilAttachment = &depthRef;
+
+		// 上一帧的后处理读完（含缩小模糊目标时的blit）之后才能清除，本帧写完之后后处理才能读取
+		vk::SubpassDependency dependencies[2];
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eLateFragmentTests;
+		dependencies[0].dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests;
+		dependencies[0].srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+		dependencies[0].dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+		dependencies[1].dstStageMask = vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader;
+		dependencies[1].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+		dependencies[1].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+		vk::RenderPassCreateInfo renderPassInfo;
+		renderPassInfo.attachmentCount = 2;
+		renderPassInfo.pAttachments = attachmentDesc;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpassDesc;
+		renderPassInfo.dependencyCount = 2;
+		renderPassInfo.pDependencies = dependencies;
+		sceneRenderPass_ = device.createRenderPass(renderPassInfo);
+	}
 	for (auto& renderer : rendererList_)
 	{
 		renderer->initResources();
@@ -31,10 +84,56 @@ void QVkScene::releaseResources()
 	{
 		renderer->releaseResources();
 	}
+	if (sceneRenderPass_) {
+		vk::Device(window_->device()).destroyRenderPass(sceneRenderPass_);
+		sceneRenderPass_ = nullptr;
+	}
 }
 
 void QVkScene::initSwapChainResources()
 {
+	if (hdrSceneTarget_) {
+		vk::Device device = window_->device();
+		auto createSceneImage = [&](SceneImage& sceneImage, vk::Format format, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect) {
+			vk::ImageCreateInfo imageInfo;
+			imageInfo.imageType = vk::ImageType::e2D;
+			imageInfo.extent.width = window_->swapChainImageSize().width();
+			imageInfo.extent.height = window_->swapChainImageSize().height();
+			imageInfo.extent.depth = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.mipLevels = 1;
+			imageInfo.samples = vk::SampleCountFlagBits::e1;
+			imageInfo.format = format;
+			imageInfo.usage = usage;
+			imageInfo.tiling = vk::ImageTiling::eOptimal;
+			imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+			sceneImage.image = device.createImage(imageInfo);
+			vk::MemoryRequirements memReq = device.getImageMemoryRequirements(sceneImage.image);
+			vk::MemoryAllocateInfo memAllocInfo(memReq.size, window_->deviceLocalMemoryIndex());
+			sceneImage.imageMemory = device.allocateMemory(memAllocInfo);
+			device.bindImageMemory(sceneImage.image, sceneImage.imageMemory, 0);
+
+			vk::ImageViewCreateInfo imageViewInfo;
+			imageViewInfo.viewType = vk::ImageViewType::e2D;
+			imageViewInfo.format = format;
+			imageViewInfo.image = sceneImage.image;
+			imageViewInfo.subresourceRange.aspectMask = aspect;
+			imageViewInfo.subresourceRange.layerCount = imageViewInfo.subresourceRange.levelCount = 1;
+			sceneImage.imageView = device.createImageView(imageViewInfo);
+		};
+		createSceneImage(sceneColor_, vk::Format::eR16G16B16A16Sfloat, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc, vk::ImageAspectFlagBits::eColor);
+		createSceneImage(sceneDepth_, vk::Format(window_->depthStencilFormat()), vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil);
+
+		vk::ImageView attachments[2] = { sceneColor_.imageView, sceneDepth_.imageView };
+		vk::FramebufferCreateInfo framebufferInfo;
+		framebufferInfo.renderPass = sceneRenderPass_;
+		framebufferInfo.attachmentCount = 2;
+		framebufferInfo.pAttachments = attachments;
+		framebufferInfo.width = window_->swapChainImageSize().width();
+		framebufferInfo.height = window_->swapChainImageSize().height();
+		framebufferInfo.layers = 1;
+		sceneFramebuffer_ = device.createFramebuffer(framebufferInfo);
+	}
 	for (auto& renderer : rendererList_)
 	{
 		renderer->initSwapChainResources();
@@ -46,6 +145,17 @@ void QVkScene::releaseSwapChainResources()
 	for (auto& renderer : rendererList_) {
 		renderer->releaseSwapChainResources();
 	}
+	if (sceneFramebuffer_) {
+		vk::Device device = window_->device();
+		device.destroyFramebuffer(sceneFramebuffer_);
+		sceneFramebuffer_ = nullptr;
+		for (SceneImage* sceneImage : { &sceneColor_, &sceneDepth_ }) {
+			device.destroyImageView(sceneImage->imageView);
+			device.destroyImage(sceneImage->image);
+			device.freeMemory(sceneImage->imageMemory);
+			*sceneImage = SceneImage();
+		}
+	}
 }
 
 void QVkScene::startNextFrame()
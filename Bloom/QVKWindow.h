@@ -39,9 +39,26 @@ public:
 	void initSwapChainResources() override;
 	void releaseSwapChainResources() override;
 	void startNextFrame() override;
+
+	// 开启后场景渲染器绘制到共享的R16G16B16A16Sfloat目标，由后处理负责输出到交换链，需在窗口显示前设置
+	void setHdrSceneTarget(bool enabled) { hdrSceneTarget_ = enabled; }
+	bool hdrSceneTarget() const { return hdrSceneTarget_; }
+	vk::RenderPass sceneRenderPass() const { return sceneRenderPass_; }
+	vk::Framebuffer sceneFramebuffer() const { return sceneFramebuffer_; }
+	vk::ImageView sceneImageView() const { return sceneColor_.imageView; }
+	vk::Image sceneImage() const { return sceneColor_.image; }
 protected:
 	QVkWindow* window_ = nullptr;
 	std::list<std::shared_ptr<QVkRenderer>> rendererList_;
+
+	bool hdrSceneTarget_ = false;
+	vk::RenderPass sceneRenderPass_;
+	vk::Framebuffer sceneFramebuffer_;
+	struct SceneImage {
+		vk::Image image;
+		vk::DeviceMemory imageMemory;
+		vk::ImageView imageView;
+	}sceneColor_, sceneDepth_;
 };
 
 class QVkWindow : public QVulkanWindow {
@@ -55,6 +72,29 @@ public:
 	void removeRenderer(std::shared_ptr<QVkRenderer> renderer) {
 		rendererGroup_->removeRenderer(renderer);
 	}
+	void setHdrSceneTarget(bool enabled) {
+		rendererGroup_->setHdrSceneTarget(enabled);
+	}
+	bool hdrSceneTarget() const {
+		return rendererGroup_->hdrSceneTarget();
+	}
+
+	// 场景渲染器应使用以下接口而不是默认渲染通道，关闭HDR目标时与默认渲染通道一致
+	vk::RenderPass sceneRenderPass() const {
+		return hdrSceneTarget() ? rendererGroup_->sceneRenderPass() : vk::RenderPass(defaultRenderPass());
+	}
+	vk::Framebuffer sceneFramebuffer() const {
+		return hdrSceneTarget() ? rendererGroup_->sceneFramebuffer() : vk::Framebuffer(currentFramebuffer());
+	}
+	VkSampleCountFlagBits sceneSampleCountFlagBits() const {
+		return hdrSceneTarget() ? VK_SAMPLE_COUNT_1_BIT : sampleCountFlagBits();
+	}
+	vk::ImageView sceneImageView() const {
+		return rendererGroup_->sceneImageView();
+	}
+	vk::Image sceneImage() const {
+		return rendererGroup_->sceneImage();
+	}
 	QFpsCamera camera_;
 private:
 	QVulkanWindowRenderer* createRenderer() override {
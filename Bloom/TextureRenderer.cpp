@@ -26,18 +26,18 @@ void TextureRenderer::initResources()
 {
 	vk::Device device = window_->device();
 	vk::SamplerCreateInfo samplerInfo;
-	samplerInfo.magFilter = vk::Filter::eNearest;
-	samplerInfo.minFilter = vk::Filter::eNearest;
+	samplerInfo.magFilter = vk::Filter::eLinear;			//图像可能小于交换链，显示时双线性放大
+	samplerInfo.minFilter = vk::Filter::eLinear;
 	samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
 	samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
 	samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
 	samplerInfo.maxAnisotropy = 1.0f;
 	sampler_ = device.createSampler(samplerInfo);
 
-	vk::DescriptorPoolSize descPoolSize(vk::DescriptorType::eCombinedImageSampler, 1);
+	vk::DescriptorPoolSize descPoolSize(vk::DescriptorType::eCombinedImageSampler, 2);
 
 	vk::DescriptorPoolCreateInfo descPoolInfo;
-	descPoolInfo.maxSets = 1;
+	descPoolInfo.maxSets = 2;
 	descPoolInfo.poolSizeCount = 1;
 	descPoolInfo.pPoolSizes = &descPoolSize;
 	descPool_ = device.createDescriptorPool(descPoolInfo);
@@ -52,8 +52,10 @@ void TextureRenderer::initResources()
 
 	descSetLayout_ = device.createDescriptorSetLayout(descLayoutInfo);
 
-	vk::DescriptorSetAllocateInfo descSetAllocInfo(descPool_, 1, &descSetLayout_);
-	descSet_ = device.allocateDescriptorSets(descSetAllocInfo).front();
+	for (int i = 0; i < 2; ++i) {
+		vk::DescriptorSetAllocateInfo descSetAllocInfo(descPool_, 1, &descSetLayout_);
+		descSet_[i] = device.allocateDescriptorSets(descSetAllocInfo).front();
+	}
 
 	vk::GraphicsPipelineCreateInfo piplineInfo;
 	piplineInfo.stageCount = 2;
@@ -188,7 +190,7 @@ void TextureRenderer::startNextFrame()
 	cmdBuffer.setScissor(0, scissor);
 
 	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipline_);
-	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, piplineLayout_, 0, 1, &descSet_, 0, nullptr);
+	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, piplineLayout_, 0, 1, &descSet_[currentDescSet_], 0, nullptr);
 	cmdBuffer.draw(4, 1, 0, 0);
 
 	cmdBuffer.endRenderPass();
@@ -196,10 +198,12 @@ void TextureRenderer::startNextFrame()
 
 void TextureRenderer::updateImage(vk::ImageView image)
 {
+	// 写入在途帧未使用的描述符集，调用方需保证距上一次更新已经过concurrentFrameCount()帧
 	vk::Device device = window_->device();
+	currentDescSet_ = 1 - currentDescSet_;
 	vk::DescriptorImageInfo descImageInfo(sampler_, image, vk::ImageLayout::eShaderReadOnlyOptimal);
 	vk::WriteDescriptorSet descWrite;
-	descWrite.dstSet = descSet_;
+	descWrite.dstSet = descSet_[currentDescSet_];
 	descWrite.dstBinding = 0;
 	descWrite.descriptorCount = 1;
 	descWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
@@ -16,7 +16,8 @@ protected:
 
 	vk::DescriptorPool descPool_;
 	vk::DescriptorSetLayout descSetLayout_;
-	vk::DescriptorSet descSet_;
+	vk::DescriptorSet descSet_[2];			//updateImage轮流写入，在途帧仍在使用另一个
+	int currentDescSet_ = 0;
 
 	vk::PipelineCache piplineCache_;
 	vk::PipelineLayout piplineLayout_;
@@ -92,7 +92,7 @@ void TriangleRenderer::initResources()
 	piplineInfo.pRasterizationState = &rasterizationState;
 
 	vk::PipelineMultisampleStateCreateInfo MSState;
-	MSState.rasterizationSamples = (VULKAN_HPP_NAMESPACE::SampleCountFlagBits)window_->sampleCountFlagBits();
+	MSState.rasterizationSamples = (VULKAN_HPP_NAMESPACE::SampleCountFlagBits)window_->sceneSampleCountFlagBits();
 	piplineInfo.pMultisampleState = &MSState;
 
 	vk::PipelineDepthStencilStateCreateInfo DSState;
@@ -118,7 +118,7 @@ void TriangleRenderer::initResources()
 	piplineLayout_ = device.createPipelineLayout(piplineLayoutInfo);
 	piplineInfo.layout = piplineLayout_;
 
-	piplineInfo.renderPass = window_->defaultRenderPass();
+	piplineInfo.renderPass = window_->sceneRenderPass();
 
 	piplineCache_ = device.createPipelineCache(vk::PipelineCacheCreateInfo());
 	pipline_ = device.createGraphicsPipeline(piplineCache_, piplineInfo).value;
@@ -153,11 +153,11 @@ void TriangleRenderer::startNextFrame()
 	cmdBeginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue;
 
 	vk::RenderPassBeginInfo beginInfo;
-	beginInfo.renderPass = window_->defaultRenderPass();
-	beginInfo.framebuffer = window_->currentFramebuffer();
+	beginInfo.renderPass = window_->sceneRenderPass();
+	beginInfo.framebuffer = window_->sceneFramebuffer();
 	beginInfo.renderArea.extent.width = window_->width();
 	beginInfo.renderArea.extent.height = window_->height();
-	beginInfo.clearValueCount = window_->sampleCountFlagBits() > VK_SAMPLE_COUNT_1_BIT ? 3 : 2;
+	beginInfo.clearValueCount = window_->sceneSampleCountFlagBits() > VK_SAMPLE_COUNT_1_BIT ? 3 : 2;
 	beginInfo.pClearValues = clearValues;
 
 	cmdBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
@@ -29,8 +29,25 @@ int main(int argc, char* argv[]) {
 	QVkWindow vkWindow;
 	vkWindow.setVulkanInstance(&instance);
 	vkWindow.resize(1024, 768);
+	if (app.arguments().contains("--hdr"))
+		vkWindow.setHdrSceneTarget(true);			//场景绘制到R16G16B16A16Sfloat目标，省去交换链复制
 	vkWindow.addRenderer(std::make_shared<TriangleRenderer>());
-	vkWindow.addRenderer(std::make_shared<BloomRenderer>());
+	auto bloomRenderer = std::make_shared<BloomRenderer>();
+	if (app.arguments().contains("--mip-bloom"))
+		bloomRenderer->setBloomMode(BloomRenderer::BloomMode::MipChain);
+	if (app.arguments().contains("--blur-compute"))
+		bloomRenderer->setBlurPath(BloomRenderer::BlurPath::Compute);
+	else if (app.arguments().contains("--blur-linear"))
+		bloomRenderer->setBlurPath(BloomRenderer::BlurPath::Linear);
+	if (app.arguments().contains("--blur-half"))
+		bloomRenderer->setBlurResolutionScale(0.5f);
+	else if (app.arguments().contains("--blur-quarter"))
+		bloomRenderer->setBlurResolutionScale(0.25f);
+	if (app.arguments().contains("--blur-auto-scale"))
+		bloomRenderer->setBlurAutoScale(true, 1.0f);			//模糊耗时预算1ms
+	vkWindow.addRenderer(bloomRenderer);
 	vkWindow.show();
+	if (app.arguments().contains("--blur-benchmark"))
+		bloomRenderer->startBlurBenchmark({ QSize(1280, 720), QSize(1920, 1080), QSize(2560, 1440) }, { 5, 10, 20, 39 }, 100);
 	return app.exec();
 }
\ No newline at end of file
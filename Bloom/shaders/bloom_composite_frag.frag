@@ -0,0 +1,30 @@
+#version 450
+
+layout (binding = 0) uniform sampler2D samplerColor;
+layout (binding = 1) uniform sampler2D samplerBloom;
+
+layout(push_constant) uniform BloomParams{
+	float threshold;
+	float knee;
+	float radius;
+	float intensity;
+	float exposure;
+}bloomParams;
+
+layout (constant_id = 0) const int tonemap = 0;		// 1: 场景为HDR目标，合成时做曝光色调映射与gamma校正
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main() 
+{
+	vec3 scene = texture(samplerColor, inUV).rgb;
+	vec3 bloom = texture(samplerBloom, inUV).rgb;		// 泛光链的第0级为半分辨率，双线性放大
+	vec3 color = scene + bloom * bloomParams.intensity;
+	if (tonemap == 1) {
+		color = vec3(1.0) - exp(-color * bloomParams.exposure);
+		color = pow(color, vec3(1.0 / 2.2));
+	}
+	outFragColor = vec4(color, 1.0);
+}
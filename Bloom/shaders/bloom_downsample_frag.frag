@@ -0,0 +1,55 @@
+#version 450
+
+layout (binding = 0) uniform sampler2D samplerColor;
+
+layout(push_constant) uniform BloomParams{
+	float threshold;
+	float knee;
+	float radius;
+	float intensity;
+	float exposure;
+}bloomParams;
+
+layout (constant_id = 0) const int prefilter = 0;		// 1: 第一级降采样时提取高亮部分
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+vec3 brightPass(vec3 color)
+{
+	float brightness = max(color.r, max(color.g, color.b));
+	float soft = clamp(brightness - bloomParams.threshold + bloomParams.knee, 0.0, 2.0 * bloomParams.knee);	// 阈值附近的软过渡
+	soft = soft * soft / (4.0 * bloomParams.knee + 1e-4);
+	return color * max(soft, brightness - bloomParams.threshold) / max(brightness, 1e-4);
+}
+
+void main() 
+{
+	vec2 texel = 1.0 / textureSize(samplerColor, 0);		// 上一级的纹素大小
+
+	// 13次双线性采样，中心4个样本权重0.5，四角的4个2x2块各0.125，抑制降采样时的闪烁
+	vec3 a = texture(samplerColor, inUV + texel * vec2(-2, -2)).rgb;
+	vec3 b = texture(samplerColor, inUV + texel * vec2( 0, -2)).rgb;
+	vec3 c = texture(samplerColor, inUV + texel * vec2( 2, -2)).rgb;
+	vec3 d = texture(samplerColor, inUV + texel * vec2(-1, -1)).rgb;
+	vec3 e = texture(samplerColor, inUV + texel * vec2( 1, -1)).rgb;
+	vec3 f = texture(samplerColor, inUV + texel * vec2(-2,  0)).rgb;
+	vec3 g = texture(samplerColor, inUV).rgb;
+	vec3 h = texture(samplerColor, inUV + texel * vec2( 2,  0)).rgb;
+	vec3 i = texture(samplerColor, inUV + texel * vec2(-1,  1)).rgb;
+	vec3 j = texture(samplerColor, inUV + texel * vec2( 1,  1)).rgb;
+	vec3 k = texture(samplerColor, inUV + texel * vec2(-2,  2)).rgb;
+	vec3 l = texture(samplerColor, inUV + texel * vec2( 0,  2)).rgb;
+	vec3 m = texture(samplerColor, inUV + texel * vec2( 2,  2)).rgb;
+
+	vec3 color = (d + e + i + j) * 0.125;
+	color += (a + b + f + g) * 0.03125;
+	color += (b + c + g + h) * 0.03125;
+	color += (f + g + k + l) * 0.03125;
+	color += (g + h + l + m) * 0.03125;
+
+	if (prefilter == 1)
+		color = brightPass(color);
+	outFragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,33 @@
+#version 450
+
+layout (binding = 0) uniform sampler2D samplerColor;
+
+layout(push_constant) uniform BloomParams{
+	float threshold;
+	float knee;
+	float radius;
+	float intensity;
+	float exposure;
+}bloomParams;
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main() 
+{
+	vec2 texel = bloomParams.radius / textureSize(samplerColor, 0);		// 下一级（较小）的纹素大小
+
+	// 3x3 tent滤波，结果以加法混合叠加到上一级
+	vec3 color = texture(samplerColor, inUV).rgb * 4.0;
+	color += texture(samplerColor, inUV + vec2(-texel.x, 0)).rgb * 2.0;
+	color += texture(samplerColor, inUV + vec2( texel.x, 0)).rgb * 2.0;
+	color += texture(samplerColor, inUV + vec2(0, -texel.y)).rgb * 2.0;
+	color += texture(samplerColor, inUV + vec2(0,  texel.y)).rgb * 2.0;
+	color += texture(samplerColor, inUV + vec2(-texel.x, -texel.y)).rgb;
+	color += texture(samplerColor, inUV + vec2( texel.x, -texel.y)).rgb;
+	color += texture(samplerColor, inUV + vec2(-texel.x,  texel.y)).rgb;
+	color += texture(samplerColor, inUV + vec2( texel.x,  texel.y)).rgb;
+
+	outFragColor = vec4(color / 16.0, 1.0);
+}
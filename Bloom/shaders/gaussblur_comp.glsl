@@ -0,0 +1,65 @@
+// gaussblur_comp.comp与gaussblur_comp_hdr.comp共用，包含前需定义OUTPUT_FORMAT
+
+#define LOCAL_SIZE 256
+#define BLUR_APRON 64			// 共享内存两侧额外加载的像素数，即最大采样偏移
+
+layout (local_size_x = LOCAL_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+layout (binding = 0) uniform sampler2D samplerColor;
+layout (binding = 1, OUTPUT_FORMAT) uniform writeonly image2D outputImage;
+
+layout(push_constant) uniform BlurParams{
+	float scale;
+	float strength ;
+	int size;
+	float weight[40];
+}blurParams;
+
+layout (constant_id = 0) const int blurdirection = 0;
+layout (constant_id = 1) const int tonemap = 1;		// 与gaussblur_frag.frag一致，HDR场景目标下只做模糊
+
+shared vec4 tile[LOCAL_SIZE + 2 * BLUR_APRON];
+
+void main() 
+{
+	// 每个工作组处理一行（H）或一列（V）上连续的LOCAL_SIZE个像素，gl_WorkGroupID.y为行/列号
+	// 坐标按输出图像计算，输入为更大的场景图像时在输出纹素中心处双线性采样
+	const ivec2 outputSize = imageSize(outputImage);
+	const vec2 texelSize = 1.0 / vec2(outputSize);
+	const int lineLength = blurdirection == 1 ? outputSize.x : outputSize.y;
+	const int line = int(gl_WorkGroupID.y);
+	const int tileStart = int(gl_WorkGroupID.x) * LOCAL_SIZE - BLUR_APRON;
+
+	// 每个像素只从显存读取一次，超出边缘的部分按clamp-to-edge处理
+	for (int i = int(gl_LocalInvocationID.x); i < LOCAL_SIZE + 2 * BLUR_APRON; i += LOCAL_SIZE) {
+		const int pos = clamp(tileStart + i, 0, lineLength - 1);
+		const vec2 coord = blurdirection == 1 ? vec2(pos, line) : vec2(line, pos);
+		tile[i] = textureLod(samplerColor, (coord + 0.5) * texelSize, 0);
+	}
+	barrier();
+
+	const int pos = int(gl_GlobalInvocationID.x);
+	if (pos >= lineLength)
+		return;
+
+	// 与gaussblur_frag.frag一致：最近点采样下第i个样本的偏移为round(i * scale)
+	const int center = int(gl_LocalInvocationID.x) + BLUR_APRON;
+	vec4 raw = tile[center];
+	vec4 result = raw * blurParams.weight[0];
+	for (int i = 1; i < blurParams.size; ++i) {
+		const int offset = min(int(i * blurParams.scale + 0.5), BLUR_APRON);
+		result += (tile[center + offset] + tile[center - offset]) * blurParams.weight[i];
+	}
+	const ivec2 outputCoord = blurdirection == 1 ? ivec2(pos, line) : ivec2(line, pos);
+	if (tonemap == 0) {
+		imageStore(outputImage, outputCoord, result);
+		return;
+	}
+	vec3 hdrColor = result.rgb;
+	vec3 mapped = vec3(1.0) - exp(-(hdrColor * blurParams.strength));
+	mapped = pow(mapped, vec3(1.0 / blurParams.scale));
+
+	float alpha = exp(-result.a * blurParams.strength);
+
+	imageStore(outputImage, outputCoord, vec4(mix(mapped, raw.rgb * blurParams.strength, raw.a), alpha));
+}
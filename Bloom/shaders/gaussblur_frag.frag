@@ -6,10 +6,11 @@ layout(push_constant) uniform BlurParams{
 	float scale;
 	float strength ;
 	int size;
-	float weight[10];
+	float weight[40];
 }blurParams;
 
 layout (constant_id = 0) const int blurdirection = 0;
+layout (constant_id = 1) const int tonemap = 1;		// 0: HDR场景目标下只做模糊，色调映射在合成时进行
 
 layout (location = 0) in vec2 inUV;
 
@@ -17,7 +18,9 @@ layout (location = 0) out vec4 outFragColor;
 
 void main() 
 {
-	vec2 tex_offset = 1.0 / textureSize(samplerColor,0) * blurParams.scale;	// 获取单个纹理大小
+	// 按渲染目标而非输入纹理取单个纹素大小：模糊目标缩小时水平方向读全分辨率场景、垂直方向读缩小后的中间结果，
+	// 两次的步长需一致
+	vec2 tex_offset = vec2(abs(dFdx(inUV.x)), abs(dFdy(inUV.y))) * blurParams.scale;
 	vec4 raw = texture(samplerColor,inUV);
 	vec4 result = raw * blurParams.weight[0];	// 当前片段分布
 	for(int i = 1;i < blurParams.size;++i)
@@ -35,6 +38,10 @@ void main()
 			result += texture(samplerColor, inUV - vec2(0.0, tex_offset.y * i)) * blurParams.weight[i];
 		}
 	}
+	if (tonemap == 0) {
+		outFragColor = result;
+		return;
+	}
 	vec3 hdrColor = result.rgb;
     vec3 mapped =vec3(1.0) - exp(-(hdrColor * blurParams.strength));
 	mapped = pow(mapped, vec3(1.0 / blurParams.scale));
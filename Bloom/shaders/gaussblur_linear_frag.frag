@@ -0,0 +1,91 @@
+#version 450 
+
+#define MAX_LINEAR_TAPS 20
+
+layout (binding = 0) uniform sampler2D samplerColor;	// 需要双线性过滤，一次采样得到相邻两个纹素的加权和
+
+layout(push_constant) uniform BlurParams{
+	float scale;
+	float strength ;
+	int size;
+	float weight[40];
+}blurParams;
+
+// 偏移与权重由BloomRenderer.cpp中的constexpr函数按setBlurSize的权重生成，每个size对应一组管线，循环次数在编译管线时确定
+// 偏移以模糊步长（渲染目标的一个纹素）为单位
+layout (constant_id = 0) const int blurdirection = 0;
+layout (constant_id = 1) const int tapCount = 0;
+layout (constant_id = 2) const float centerWeight = 1.0;
+layout (constant_id = 3) const float offset0 = 0.0;
+layout (constant_id = 4) const float offset1 = 0.0;
+layout (constant_id = 5) const float offset2 = 0.0;
+layout (constant_id = 6) const float offset3 = 0.0;
+layout (constant_id = 7) const float offset4 = 0.0;
+layout (constant_id = 8) const float offset5 = 0.0;
+layout (constant_id = 9) const float offset6 = 0.0;
+layout (constant_id = 10) const float offset7 = 0.0;
+layout (constant_id = 11) const float offset8 = 0.0;
+layout (constant_id = 12) const float offset9 = 0.0;
+layout (constant_id = 13) const float offset10 = 0.0;
+layout (constant_id = 14) const float offset11 = 0.0;
+layout (constant_id = 15) const float offset12 = 0.0;
+layout (constant_id = 16) const float offset13 = 0.0;
+layout (constant_id = 17) const float offset14 = 0.0;
+layout (constant_id = 18) const float offset15 = 0.0;
+layout (constant_id = 19) const float offset16 = 0.0;
+layout (constant_id = 20) const float offset17 = 0.0;
+layout (constant_id = 21) const float offset18 = 0.0;
+layout (constant_id = 22) const float offset19 = 0.0;
+layout (constant_id = 23) const float weight0 = 0.0;
+layout (constant_id = 24) const float weight1 = 0.0;
+layout (constant_id = 25) const float weight2 = 0.0;
+layout (constant_id = 26) const float weight3 = 0.0;
+layout (constant_id = 27) const float weight4 = 0.0;
+layout (constant_id = 28) const float weight5 = 0.0;
+layout (constant_id = 29) const float weight6 = 0.0;
+layout (constant_id = 30) const float weight7 = 0.0;
+layout (constant_id = 31) const float weight8 = 0.0;
+layout (constant_id = 32) const float weight9 = 0.0;
+layout (constant_id = 33) const float weight10 = 0.0;
+layout (constant_id = 34) const float weight11 = 0.0;
+layout (constant_id = 35) const float weight12 = 0.0;
+layout (constant_id = 36) const float weight13 = 0.0;
+layout (constant_id = 37) const float weight14 = 0.0;
+layout (constant_id = 38) const float weight15 = 0.0;
+layout (constant_id = 39) const float weight16 = 0.0;
+layout (constant_id = 40) const float weight17 = 0.0;
+layout (constant_id = 41) const float weight18 = 0.0;
+layout (constant_id = 42) const float weight19 = 0.0;
+layout (constant_id = 43) const int tonemap = 1;		// 与gaussblur_frag.frag一致
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main() 
+{
+	// 步长取渲染目标的纹素大小，与gaussblur_frag.frag一致；blurParams.scale不为1时不使用此着色器
+	vec2 tex_offset = vec2(abs(dFdx(inUV.x)), abs(dFdy(inUV.y)));
+	vec2 axis = blurdirection == 1 ? vec2(tex_offset.x, 0.0) : vec2(0.0, tex_offset.y);
+	// 特化常量不能作为全局常量数组的初始值，在函数内组装，特化后由驱动折叠为常量
+	float offsets[MAX_LINEAR_TAPS] = float[](offset0, offset1, offset2, offset3, offset4, offset5, offset6, offset7, offset8, offset9, offset10, offset11, offset12, offset13, offset14, offset15, offset16, offset17, offset18, offset19);
+	float weights[MAX_LINEAR_TAPS] = float[](weight0, weight1, weight2, weight3, weight4, weight5, weight6, weight7, weight8, weight9, weight10, weight11, weight12, weight13, weight14, weight15, weight16, weight17, weight18, weight19);
+	vec4 raw = texture(samplerColor,inUV);
+	vec4 result = raw * centerWeight;
+	for(int i = 0;i < tapCount;++i)
+	{
+		result += texture(samplerColor, inUV + axis * offsets[i]) * weights[i];
+		result += texture(samplerColor, inUV - axis * offsets[i]) * weights[i];
+	}
+	if (tonemap == 0) {
+		outFragColor = result;
+		return;
+	}
+	vec3 hdrColor = result.rgb;
+    vec3 mapped =vec3(1.0) - exp(-(hdrColor * blurParams.strength));
+	mapped = pow(mapped, vec3(1.0 / blurParams.scale));
+
+	float alpha = exp(-result.a * blurParams.strength);
+
+    outFragColor = vec4(mix(mapped,raw.rgb * blurParams.strength , raw.a), alpha);
+}
\ No newline at end of file
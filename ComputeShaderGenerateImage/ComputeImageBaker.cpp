@@ -0,0 +1,329 @@
+#include "ComputeImageBaker.h"
+#include <QDebug>
+#include <algorithm>
+#include <fstream>
+
+static std::vector<char> readFile(const std::string& filename) {
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open file!");
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+
+	file.close();
+
+	return buffer;
+}
+
+ComputeImageBaker::ComputeImageBaker(QVkContext* context, const QString& shaderPath, vk::Format format, uint32_t localSize)
+	:context_(context)
+	, format_(format)
+	, localSize_(std::max(localSize, 1u))
+{
+	vk::Device device = context_->device();
+	if (bytesPerPixel() == 0) {
+		qWarning() << "ComputeImageBaker: unsupported output format" << int(format) << ", using eR8G8B8A8Unorm";
+		format_ = vk::Format::eR8G8B8A8Unorm;
+	}
+
+	vk::DescriptorSetLayoutBinding descSetLayoutBingding;
+	descSetLayoutBingding.binding = 0;
+	descSetLayoutBingding.descriptorType = vk::DescriptorType::eStorageImage;
+	descSetLayoutBingding.descriptorCount = 1;
+	descSetLayoutBingding.stageFlags = vk::ShaderStageFlagBits::eCompute;
+
+	vk::DescriptorSetLayoutCreateInfo descSetLayoutInfo;
+	descSetLayoutInfo.bindingCount = 1;
+	descSetLayoutInfo.pBindings = &descSetLayoutBingding;
+	descSetLayout_ = device.createDescriptorSetLayout(descSetLayoutInfo);
+
+	// 每个池中的图像持有一个描述符集，淘汰图像时归还
+	vk::DescriptorPoolSize descPoolSize(vk::DescriptorType::eStorageImage, BAKER_MAX_POOLED_IMAGES);
+	vk::DescriptorPoolCreateInfo descPoolInfo;
+	descPoolInfo.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
+	descPoolInfo.maxSets = BAKER_MAX_POOLED_IMAGES;
+	descPoolInfo.poolSizeCount = 1;
+	descPoolInfo.pPoolSizes = &descPoolSize;
+	descPool_ = device.createDescriptorPool(descPoolInfo);
+
+	vk::PushConstantRange pushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(QVector4D));
+	vk::PipelineLayoutCreateInfo piplineLayoutInfo;
+	piplineLayoutInfo.setLayoutCount = 1;
+	piplineLayoutInfo.pSetLayouts = &descSetLayout_;
+	piplineLayoutInfo.pushConstantRangeCount = 1;
+	piplineLayoutInfo.pPushConstantRanges = &pushConstant;
+	piplineLayout_ = device.createPipelineLayout(piplineLayoutInfo);
+
+	auto shaderCode = readFile(shaderPath.toStdString());
+	vk::ShaderModuleCreateInfo shaderInfo;
+	shaderInfo.codeSize = shaderCode.size();
+	shaderInfo.pCode = reinterpret_cast<uint32_t*>(shaderCode.data());
+	vk::ShaderModule computeShaderModule = device.createShaderModule(shaderInfo);
+
+	vk::ComputePipelineCreateInfo computePiplineInfo;
+	computePiplineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+	computePiplineInfo.stage.module = computeShaderModule;
+	computePiplineInfo.stage.pName = "main";
+	computePiplineInfo.layout = piplineLayout_;
+	computePipline_ = device.createComputePipeline(nullptr, computePiplineInfo).value;
+	device.destroyShaderModule(computeShaderModule);
+
+	fence_ = device.createFence(vk::FenceCreateInfo());
+}
+
+ComputeImageBaker::~ComputeImageBaker()
+{
+	vk::Device device = context_->device();
+	for (auto& image : images_)
+		destroyImage(image);
+	if (stagingPtr_)
+		device.unmapMemory(stagingMemory_);
+	device.destroyBuffer(stagingBuffer_);
+	device.freeMemory(stagingMemory_);
+	device.destroyFence(fence_);
+	device.destroyPipeline(computePipline_);
+	device.destroyPipelineLayout(piplineLayout_);
+	device.destroyDescriptorPool(descPool_);
+	device.destroyDescriptorSetLayout(descSetLayout_);
+}
+
+void ComputeImageBaker::setBatchSize(int batchSize)
+{
+	batchSize_ = qBound(1, batchSize, BAKER_MAX_POOLED_IMAGES);
+}
+
+void ComputeImageBaker::bake(const QVector<Job>& jobs, const Callback& callback)
+{
+	for (int first = 0; first < jobs.size(); first += batchSize_)
+		bakeBatch(jobs.data() + first, std::min<int>(batchSize_, jobs.size() - first), first, callback);
+}
+
+QVector<QImage> ComputeImageBaker::bake(const QVector<Job>& jobs)
+{
+	QVector<QImage> images(jobs.size());
+	bake(jobs, [&images](int jobIndex, const QImage& image) {
+		images[jobIndex] = image;
+	});
+	return images;
+}
+
+int ComputeImageBaker::acquireImage(QSize size)
+{
+	for (int i = 0; i < int(images_.size()); i++) {
+		if (!images_[i].inUse && images_[i].size == size) {
+			images_[i].inUse = true;
+			return i;
+		}
+	}
+
+	vk::Device device = context_->device();
+	// 池满时淘汰一个空闲图像，批大小不超过池容量，因此一定能找到
+	int slot = images_.size();
+	if (images_.size() >= BAKER_MAX_POOLED_IMAGES) {
+		slot = std::find_if(images_.begin(), images_.end(), [](const PooledImage& image) { return !image.inUse; }) - images_.begin();
+		destroyImage(images_[slot]);
+	}
+	else {
+		images_.emplace_back();
+	}
+	PooledImage& pooled = images_[slot];
+	pooled.size = size;
+	pooled.inUse = true;
+
+	vk::ImageCreateInfo imageInfo;
+	imageInfo.imageType = vk::ImageType::e2D;
+	imageInfo.format = format_;
+	imageInfo.extent = vk::Extent3D(size.width(), size.height(), 1);
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = vk::SampleCountFlagBits::e1;
+	imageInfo.tiling = vk::ImageTiling::eOptimal;
+	imageInfo.usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc;
+	imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+	pooled.image = device.createImage(imageInfo);
+
+	vk::MemoryRequirements memReq = device.getImageMemoryRequirements(pooled.image);
+	vk::MemoryAllocateInfo memAllocInfo(memReq.size, context_->deviceLocalMemoryIndex());
+	pooled.memory = device.allocateMemory(memAllocInfo);
+	device.bindImageMemory(pooled.image, pooled.memory, 0);
+
+	vk::ImageViewCreateInfo imageViewInfo;
+	imageViewInfo.components = { vk::ComponentSwizzle::eR,vk::ComponentSwizzle::eG ,vk::ComponentSwizzle::eB ,vk::ComponentSwizzle::eA };
+	imageViewInfo.format = format_;
+	imageViewInfo.image = pooled.image;
+	imageViewInfo.viewType = vk::ImageViewType::e2D;
+	imageViewInfo.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	pooled.imageView = device.createImageView(imageViewInfo);
+
+	vk::DescriptorSetAllocateInfo descSetAllocInfo;
+	descSetAllocInfo.descriptorPool = descPool_;
+	descSetAllocInfo.descriptorSetCount = 1;
+	descSetAllocInfo.pSetLayouts = &descSetLayout_;
+	pooled.descSet = device.allocateDescriptorSets(descSetAllocInfo).front();
+
+	vk::DescriptorImageInfo descImageInfo(nullptr, pooled.imageView, vk::ImageLayout::eGeneral);
+	vk::WriteDescriptorSet writeDescSet;
+	writeDescSet.dstSet = pooled.descSet;
+	writeDescSet.dstBinding = 0;
+	writeDescSet.descriptorCount = 1;
+	writeDescSet.descriptorType = vk::DescriptorType::eStorageImage;
+	writeDescSet.pImageInfo = &descImageInfo;
+	device.updateDescriptorSets(writeDescSet, {});
+	return slot;
+}
+
+void ComputeImageBaker::destroyImage(PooledImage& image)
+{
+	vk::Device device = context_->device();
+	device.freeDescriptorSets(descPool_, image.descSet);
+	device.destroyImageView(image.imageView);
+	device.destroyImage(image.image);
+	device.freeMemory(image.memory);
+	image = PooledImage();
+}
+
+void ComputeImageBaker::bakeBatch(const Job* jobs, int jobCount, int firstIndex, const Callback& callback)
+{
+	vk::Device device = context_->device();
+
+	// 空尺寸的任务不派发，回调得到空图像
+	QVector<int> imageSlots;
+	QVector<int> jobIndices;
+	QVector<vk::DeviceSize> offsets;
+	vk::DeviceSize totalSize = 0;
+	for (int i = 0; i < jobCount; i++) {
+		if (jobs[i].size.isEmpty())
+			continue;
+		imageSlots.push_back(acquireImage(jobs[i].size));
+		jobIndices.push_back(i);
+		offsets.push_back(totalSize);
+		totalSize += (vk::DeviceSize(jobs[i].size.width()) * jobs[i].size.height() * bytesPerPixel() + 15) & ~vk::DeviceSize(15);
+	}
+	if (imageSlots.isEmpty()) {
+		for (int i = 0; callback && i < jobCount; i++)
+			callback(firstIndex + i, QImage());
+		return;
+	}
+
+	if (totalSize > stagingSize_) {
+		if (stagingPtr_)
+			device.unmapMemory(stagingMemory_);
+		device.destroyBuffer(stagingBuffer_);
+		device.freeMemory(stagingMemory_);
+		vk::BufferCreateInfo bufferInfo;
+		bufferInfo.size = totalSize;
+		bufferInfo.usage = vk::BufferUsageFlagBits::eTransferDst;
+		stagingBuffer_ = device.createBuffer(bufferInfo);
+		vk::MemoryRequirements memReq = device.getBufferMemoryRequirements(stagingBuffer_);
+		vk::MemoryAllocateInfo memAllocInfo(memReq.size, context_->hostVisibleMemoryIndex());
+		stagingMemory_ = device.allocateMemory(memAllocInfo);
+		device.bindBufferMemory(stagingBuffer_, stagingMemory_, 0);
+		stagingPtr_ = (uint8_t*)device.mapMemory(stagingMemory_, 0, VK_WHOLE_SIZE);
+		stagingSize_ = totalSize;
+	}
+
+	vk::CommandBufferAllocateInfo cmdBufferAlllocInfo;
+	cmdBufferAlllocInfo.level = vk::CommandBufferLevel::ePrimary;
+	cmdBufferAlllocInfo.commandPool = context_->graphicsCommandPool();
+	cmdBufferAlllocInfo.commandBufferCount = 1;
+	vk::CommandBuffer cmdBuffer = device.allocateCommandBuffers(cmdBufferAlllocInfo).front();
+	vk::CommandBufferBeginInfo cmdBeginInfo;
+	cmdBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	cmdBuffer.begin(cmdBeginInfo);
+
+	// 所有任务的布局转换合并为一次屏障，各次派发之间互不依赖
+	QVector<vk::ImageMemoryBarrier> barriers(imageSlots.size());
+	for (int i = 0; i < imageSlots.size(); i++) {
+		barriers[i].oldLayout = vk::ImageLayout::eUndefined;
+		barriers[i].newLayout = vk::ImageLayout::eGeneral;
+		barriers[i].srcAccessMask = {};
+		barriers[i].dstAccessMask = vk::AccessFlagBits::eShaderWrite;
+		barriers[i].srcQueueFamilyIndex = barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+		barriers[i].image = images_[imageSlots[i]].image;
+	}
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe | vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, barriers);
+
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, computePipline_);
+	for (int i = 0; i < imageSlots.size(); i++) {
+		const Job& job = jobs[jobIndices[i]];
+		cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, piplineLayout_, 0, images_[imageSlots[i]].descSet, {});
+		cmdBuffer.pushConstants(piplineLayout_, vk::ShaderStageFlagBits::eCompute, 0, sizeof(QVector4D), &job.params);
+		// 向上取整，边缘工作组中越界的调用由着色器丢弃
+		cmdBuffer.dispatch((job.size.width() + localSize_ - 1) / localSize_, (job.size.height() + localSize_ - 1) / localSize_, 1);
+	}
+
+	for (int i = 0; i < imageSlots.size(); i++) {
+		barriers[i].oldLayout = vk::ImageLayout::eGeneral;
+		barriers[i].newLayout = vk::ImageLayout::eTransferSrcOptimal;
+		barriers[i].srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+		barriers[i].dstAccessMask = vk::AccessFlagBits::eTransferRead;
+	}
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barriers);
+
+	for (int i = 0; i < imageSlots.size(); i++) {
+		const QSize size = jobs[jobIndices[i]].size;
+		vk::BufferImageCopy region;
+		region.bufferOffset = offsets[i];
+		region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = vk::Extent3D(size.width(), size.height(), 1);
+		cmdBuffer.copyImageToBuffer(images_[imageSlots[i]].image, vk::ImageLayout::eTransferSrcOptimal, stagingBuffer_, region);
+	}
+
+	vk::BufferMemoryBarrier hostBarrier;
+	hostBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	hostBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+	hostBarrier.srcQueueFamilyIndex = hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = stagingBuffer_;
+	hostBarrier.size = VK_WHOLE_SIZE;
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, {}, hostBarrier, {});
+	cmdBuffer.end();
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmdBuffer;
+	vk::Queue(context_->graphicsQueue()).submit(submitInfo, fence_);
+	if (device.waitForFences(fence_, true, UINT64_MAX) != vk::Result::eSuccess)
+		qWarning("ComputeImageBaker: Failed to wait for bake fence");
+	device.resetFences(fence_);
+	device.freeCommandBuffers(context_->graphicsCommandPool(), cmdBuffer);
+
+	for (int slot : imageSlots)
+		images_[slot].inUse = false;
+	for (int i = 0, baked = 0; callback && i < jobCount; i++) {
+		if (baked < jobIndices.size() && jobIndices[baked] == i && stagingPtr_) {
+			const QSize size = jobs[i].size;
+			callback(firstIndex + i, QImage(stagingPtr_ + offsets[baked], size.width(), size.height(), size.width() * bytesPerPixel(), imageFormat()).copy());
+			baked++;
+		}
+		else {
+			callback(firstIndex + i, QImage());
+		}
+	}
+}
+
+int ComputeImageBaker::bytesPerPixel() const
+{
+	switch (format_) {
+	case vk::Format::eR8G8B8A8Unorm: return 4;
+	case vk::Format::eR16G16B16A16Sfloat: return 8;
+	case vk::Format::eR32G32B32A32Sfloat: return 16;
+	default: return 0;
+	}
+}
+
+QImage::Format ComputeImageBaker::imageFormat() const
+{
+	switch (format_) {
+	case vk::Format::eR16G16B16A16Sfloat: return QImage::Format_RGBA16FPx4;
+	case vk::Format::eR32G32B32A32Sfloat: return QImage::Format_RGBA32FPx4;
+	default: return QImage::Format_RGBA8888;
+	}
+}
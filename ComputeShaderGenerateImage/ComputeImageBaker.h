@@ -0,0 +1,67 @@
+#ifndef ComputeImageBaker_h__
+#define ComputeImageBaker_h__
+
+#include <QImage>
+#include <QVector4D>
+#include <functional>
+#include <vulkan\vulkan.hpp>
+#include "QVkContext.h"
+
+#define BAKER_MAX_POOLED_IMAGES 64			//同时也是单次提交的最大任务数
+
+// 用计算着色器批量生成图像（程序化纹理烘焙）：
+//   着色器约定：binding 0 为输出的storage image，push constant 为一个vec4参数，
+//   工作组大小为 localSize x localSize，着色器内须用 imageSize 做越界检查
+//   派发数量按向上取整计算，任意尺寸都能完整覆盖；多个任务合并到一次提交、一个fence中，
+//   输出图像及其描述符集按尺寸回收复用
+class ComputeImageBaker {
+public:
+	struct Job {
+		QSize size;
+		QVector4D params;
+	};
+	using Callback = std::function<void(int jobIndex, const QImage& image)>;
+
+	// format 须与着色器中声明的图像格式一致，支持 eR8G8B8A8Unorm、eR16G16B16A16Sfloat、eR32G32B32A32Sfloat
+	ComputeImageBaker(QVkContext* context, const QString& shaderPath, vk::Format format = vk::Format::eR8G8B8A8Unorm, uint32_t localSize = 20);
+	~ComputeImageBaker();
+	ComputeImageBaker(const ComputeImageBaker&) = delete;
+	ComputeImageBaker& operator=(const ComputeImageBaker&) = delete;
+
+	void setBatchSize(int batchSize);		//每次提交的任务数，不超过BAKER_MAX_POOLED_IMAGES
+	int batchSize() const { return batchSize_; }
+	void bake(const QVector<Job>& jobs, const Callback& callback);		//回调按任务顺序执行
+	QVector<QImage> bake(const QVector<Job>& jobs);
+	int pooledImageCount() const { return images_.size(); }
+private:
+	struct PooledImage {
+		QSize size;
+		vk::Image image;
+		vk::DeviceMemory memory;
+		vk::ImageView imageView;
+		vk::DescriptorSet descSet;
+		bool inUse = false;
+	};
+	int acquireImage(QSize size);
+	void destroyImage(PooledImage& image);
+	void bakeBatch(const Job* jobs, int jobCount, int firstIndex, const Callback& callback);
+	int bytesPerPixel() const;
+	QImage::Format imageFormat() const;
+private:
+	QVkContext* context_ = nullptr;
+	vk::Format format_;
+	uint32_t localSize_;
+	int batchSize_ = 16;
+	vk::DescriptorSetLayout descSetLayout_;
+	vk::DescriptorPool descPool_;
+	vk::PipelineLayout piplineLayout_;
+	vk::Pipeline computePipline_;
+	vk::Fence fence_;
+	vk::Buffer stagingBuffer_;
+	vk::DeviceMemory stagingMemory_;
+	vk::DeviceSize stagingSize_ = 0;
+	uint8_t* stagingPtr_ = nullptr;
+	std::vector<PooledImage> images_;
+};
+
+#endif // ComputeImageBaker_h__
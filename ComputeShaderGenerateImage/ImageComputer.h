@@ -3,19 +3,26 @@
 
 #include <QVulkanWindowRenderer>
 #include <vulkan\vulkan.hpp>
+#include "QVkContext.h"
+#include "ImageEncoderPool.h"
+#include "ComputeImageBaker.h"
 
 class ImageComputer : public QVulkanWindowRenderer {
 public:
 	ImageComputer(QVulkanWindow* window);
+	ImageComputer(QVkContext* context);		//无窗口运行，直接调用generateImage
 	void initResources() override;
 	void initSwapChainResources() override;
 	void releaseSwapChainResources() override;
 	void releaseResources() override;
 	void startNextFrame() override;
-private:
-	QImage generateImage(QSize size);
+	QImage generateImage(QSize size);			//任意尺寸，由ComputeImageBaker派发
 private:
 	QVulkanWindow* window_ = nullptr;
+	std::unique_ptr<QVkWindowContext> windowContext_;
+	QVkContext* context_ = nullptr;
+	std::unique_ptr<ImageEncoderPool> encoder_;
+	std::unique_ptr<ComputeImageBaker> baker_;
 };
 
 #endif // ImageComputer_h__
\ No newline at end of file
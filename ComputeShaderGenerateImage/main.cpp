@@ -1,7 +1,12 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QGuiApplication>
 #include <QLoggingCategory>
 #include <QVulkanInstance>
 #include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <cstring>
 #include "ImageComputer.h"
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
@@ -14,12 +19,57 @@ public:
 };
 
 int main(int argc, char* argv[]) {
-	QGuiApplication app(argc, argv);
-
 	static vk::DynamicLoader  dynamicLoader;
 	PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dynamicLoader.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
 	VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
 
+	// --headless：不创建窗口，也不需要显示服务器，可用于批处理与CI容器（例如配合lavapipe）
+	if (std::find_if(argv + 1, argv + argc, [](const char* arg) { return strcmp(arg, "--headless") == 0; }) != argv + argc) {
+		QCoreApplication app(argc, argv);
+		QVkHeadlessContext context;
+		context.setLayers({ "VK_LAYER_KHRONOS_validation" });
+		if (!context.create())
+			qFatal("Failed to create headless Vulkan context");
+		// --bake N [--batch B]：烘焙N张尺寸各异的程序化纹理（每次提交B个任务），以QOI写到baked目录并统计吞吐量
+		int bakeCount = 0;
+		int batchSize = 16;
+		for (int i = 1; i + 1 < argc; i++) {
+			if (strcmp(argv[i], "--bake") == 0)
+				bakeCount = QByteArray(argv[i + 1]).toInt();
+			else if (strcmp(argv[i], "--batch") == 0)
+				batchSize = QByteArray(argv[i + 1]).toInt();
+		}
+		ImageEncoderPool encoder;
+		if (bakeCount > 0) {
+			ComputeImageBaker baker(&context, "./image_comp.spv");
+			baker.setBatchSize(batchSize);
+			QVector<ComputeImageBaker::Job> jobs(bakeCount);
+			for (int i = 0; i < bakeCount; i++)
+				jobs[i] = { QSize(64 + (i * 37) % 961, 64 + (i * 53) % 577), QVector4D(float(i) / bakeCount, 0, 0, 0) };		//有意使用非工作组整数倍的尺寸
+			QDir().mkpath("baked");
+			qint64 pixels = 0;
+			QElapsedTimer timer;
+			timer.start();
+			baker.bake(jobs, [&](int jobIndex, const QImage& image) {
+				pixels += qint64(image.width()) * image.height();
+				encoder.encode(image, QString("baked/texture_%1.qoi").arg(jobIndex, 4, 10, QChar('0')));
+			});
+			const double bakeSeconds = timer.nsecsElapsed() / 1e9;
+			encoder.waitForDone();
+			qDebug("%d textures (batch %d, %d pooled images) in %.3f s: %.1f textures/s, %.1f MPix/s; encoded after %.3f s",
+				bakeCount, baker.batchSize(), baker.pooledImageCount(), bakeSeconds, bakeCount / bakeSeconds, pixels / bakeSeconds / 1e6, timer.nsecsElapsed() / 1e9);
+			return encoder.failedCount() == 0 ? 0 : 1;
+		}
+		ImageComputer computer(&context);
+		encoder.encode(computer.generateImage({ 800,600 }), "compute.png");
+		encoder.waitForDone();
+		if (encoder.failedCount() > 0)
+			qFatal("Failed to save compute.png");
+		return 0;
+	}
+
+	QGuiApplication app(argc, argv);
+
 	QVulkanInstance instance;
 	instance.setLayers({ "VK_LAYER_KHRONOS_validation" });
 	if (!instance.create())
@@ -10,7 +10,7 @@ for shader_file in glob.glob(os.path.join(shader_dir, '*.vert')) + glob.glob(os.
     base_name = os.path.splitext(os.path.basename(shader_file))[0]
 
     # 构建glslangValidator命令
-    command = ['glslangValidator', '-V', shader_file, '-o', f'{base_name}.spv']
+    command = ['glslangValidator', '-V', '--target-env', 'vulkan1.1', shader_file, '-o', f'{base_name}.spv']
 
     # 执行命令
     subprocess.run(command, check=True)
\ No newline at end of file
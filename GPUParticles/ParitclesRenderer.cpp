@@ -1,8 +1,8 @@
 #include "ParitclesRenderer.h"
+#include <QCoreApplication>
 
-ParticlesRenderer::ParticlesRenderer(QVulkanWindow* window)
+ParticlesRenderer::ParticlesRenderer()
 	: particleSystem_(this)
-	, window_(window)
 {
 }
 
@@ -10,7 +10,32 @@ void ParticlesRenderer::initResources()
 {
 	vk::Device device = window_->device();
 	piplineCache_ = device.createPipelineCache(vk::PipelineCacheCreateInfo());
+	const QStringList args = QCoreApplication::arguments();
+	if (args.contains("--soa"))
+		particleSystem_.setStorageMode(ParticleSystem::StorageMode::SoA);
+	else if (args.contains("--soa-half"))
+		particleSystem_.setStorageMode(ParticleSystem::StorageMode::SoAHalf);
+	particleSystem_.setSortEnabled(args.contains("--sorted"));
+	particleSystem_.setNeighbourEnabled(args.contains("--boids"));
+	if (args.contains("--cpu"))
+		particleSystem_.setRunnerMode(ParticleSystem::RunnerMode::Cpu);
 	particleSystem_.initResource();
+
+	ParticleEmitter emitter;
+	emitter.shape = ParticleEmitter::Point;
+	emitter.direction = QVector3D(0, -1, 0);
+	emitter.coneAngle = M_PI / 4;
+	emitter.rate = 6000;
+	emitter.speedRange[0] = 0.006f;
+	emitter.speedRange[1] = 0.008f;
+	emitter.lifeRange[0] = 4.0f;
+	emitter.lifeRange[1] = 5.0f;
+	particleSystem_.addEmitter(emitter);
+
+	if (args.contains("--validate"))
+		particleSystem_.validate(100000, 800);
+	if (args.contains("--benchmark"))
+		particleSystem_.benchmark({ 100000, 1000000, 4000000, 10000000 }, 20);
 }
 
 void ParticlesRenderer::initSwapChainResources()
@@ -30,9 +55,6 @@ void ParticlesRenderer::releaseResources()
 
 void ParticlesRenderer::startNextFrame()
 {
-	particleSystem_.create(100);
 	particleSystem_.run();
 	particleSystem_.render();
-	window_->frameReady();
-	window_->requestUpdate();
 }
@@ -1,17 +1,17 @@
-#include <QVulkanWindowRenderer>
 #include <vulkan\vulkan.hpp>
 #include "ParticlesSystem.h"
+#include "QVKWindow.h"
 
-class ParticlesRenderer : public QVulkanWindowRenderer {
+class ParticlesRenderer : public QVkRenderer {
+	friend class ParticleSystem;
 public:
-	ParticlesRenderer(QVulkanWindow* window);
+	ParticlesRenderer();
 	void initResources() override;
 	void initSwapChainResources() override;
 	void releaseSwapChainResources() override;
 	void releaseResources() override;
 	void startNextFrame() override;
 public:
-	QVulkanWindow* window_ = nullptr;
 	vk::PipelineCache piplineCache_;
 	ParticleSystem particleSystem_;
 };
@@ -0,0 +1,258 @@
+#include "ParticleCpuRunner.h"
+#include <QtCore/qfloat16.h>
+#include <cstring>
+#include <numeric>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#define DEAD_TIME 5.0f				//与particle_runner.comp保持一致
+#define LIFE_STEP 0.01f
+#define GRAVITY 0.00003f
+
+#define HEADER_SIZE 16				//ParticlesBuffer中的counter与padding
+#define MIN_CHUNK_SIZE 16384		//每个线程最少处理的粒子数，取8的倍数使SIMD批次不跨块
+
+using StorageMode = ParticleSystem::StorageMode;
+
+namespace {
+
+struct ParticleView					//与 particle_storage.glsl 中的布局保持一致（以float为单位）
+{
+	float* data;
+	uint32_t capacity;
+	StorageMode mode;
+
+	float* position(uint32_t i) const { return mode == StorageMode::AoS ? data + size_t(i) * 8 : data + size_t(i) * 3; }
+	float* velocity(uint32_t i) const { return mode == StorageMode::AoS ? data + size_t(i) * 8 + 4 : data + size_t(capacity) * 3 + size_t(i) * 3; }
+	float* life(uint32_t i) const { return mode == StorageMode::AoS ? data + size_t(i) * 8 + 3 : data + size_t(capacity) * 6 + i; }
+	qfloat16* velocityLife(uint32_t i) const { return (qfloat16*)(data + size_t(capacity) * 3) + size_t(i) * 4; }
+	float lifeOf(uint32_t i) const { return mode == StorageMode::SoAHalf ? float(velocityLife(i)[3]) : *life(i); }
+};
+
+}
+
+static inline bool alive(float life)
+{
+	return !(life > DEAD_TIME);		//与着色器一样，NaN视为存活
+}
+
+static void stepParticle(const ParticleView& in, uint32_t src, const ParticleView& out, uint32_t dst)
+{
+	float position[3], velocity[3], life;
+	memcpy(position, in.position(src), sizeof(position));
+	if (in.mode == StorageMode::SoAHalf) {
+		const qfloat16* velocityLife = in.velocityLife(src);
+		for (int k = 0; k < 3; k++)
+			velocity[k] = velocityLife[k];
+		life = velocityLife[3];
+	}
+	else {
+		memcpy(velocity, in.velocity(src), sizeof(velocity));
+		life = *in.life(src);
+	}
+
+	life += LIFE_STEP;
+	for (int k = 0; k < 3; k++)
+		position[k] += velocity[k];
+	velocity[1] += GRAVITY;
+
+	memcpy(out.position(dst), position, sizeof(position));
+	if (out.mode == StorageMode::SoAHalf) {
+		qfloat16* velocityLife = out.velocityLife(dst);
+		for (int k = 0; k < 3; k++)
+			velocityLife[k] = qfloat16(velocity[k]);
+		velocityLife[3] = qfloat16(life);
+	}
+	else {
+		memcpy(out.velocity(dst), velocity, sizeof(velocity));
+		*out.life(dst) = life;
+	}
+}
+
+static uint32_t countAlive(const ParticleView& in, uint32_t begin, uint32_t end)
+{
+	uint32_t count = 0;
+	uint32_t i = begin;
+#ifdef __AVX2__
+	if (in.mode == StorageMode::SoA) {
+		const __m256 deadTime = _mm256_set1_ps(DEAD_TIME);
+		for (; i + 8 <= end; i += 8) {
+			__m256 life = _mm256_loadu_ps(in.life(i));
+			count += _mm_popcnt_u32(_mm256_movemask_ps(_mm256_cmp_ps(life, deadTime, _CMP_NGT_UQ)));
+		}
+	}
+#endif
+	for (; i < end; i++)
+		count += alive(in.lifeOf(i));
+	return count;
+}
+
+// 更新[begin, end)内的粒子，并将存活的粒子依次写到输出的dst处
+static void stepRange(const ParticleView& in, const ParticleView& out, uint32_t begin, uint32_t end, uint32_t dst)
+{
+	uint32_t i = begin;
+#ifdef __AVX2__
+	if (in.mode == StorageMode::AoS) {
+		// 一个粒子正好是8个float：position | life | velocity | padding
+		const __m256 lifeStep = _mm256_setr_ps(0, 0, 0, LIFE_STEP, 0, 0, 0, 0);
+		const __m256 gravity = _mm256_setr_ps(0, 0, 0, 0, 0, GRAVITY, 0, 0);
+		for (; i < end; i++) {
+			const float* src = in.position(i);
+			if (!alive(src[3]))
+				continue;
+			__m256 particle = _mm256_loadu_ps(src);
+			__m256 delta = _mm256_permute2f128_ps(particle, particle, 0x81);		//速度移到低128位，高128位清零
+			delta = _mm256_blend_ps(delta, lifeStep, 0x08);
+			particle = _mm256_add_ps(_mm256_add_ps(particle, delta), gravity);
+			_mm256_storeu_ps(out.position(dst++), particle);
+		}
+		return;
+	}
+	if (in.mode == StorageMode::SoA) {
+		// 每批8个粒子：位置与速度各为3个向量（xyz交错），生命为1个向量
+		const __m256 gravity[3] = {
+			_mm256_setr_ps(0, GRAVITY, 0, 0, GRAVITY, 0, 0, GRAVITY),
+			_mm256_setr_ps(0, 0, GRAVITY, 0, 0, GRAVITY, 0, 0),
+			_mm256_setr_ps(GRAVITY, 0, 0, GRAVITY, 0, 0, GRAVITY, 0),
+		};
+		const __m256 lifeStep = _mm256_set1_ps(LIFE_STEP);
+		const __m256 deadTime = _mm256_set1_ps(DEAD_TIME);
+		for (; i + 8 <= end; i += 8) {
+			__m256 life = _mm256_loadu_ps(in.life(i));
+			const int mask = _mm256_movemask_ps(_mm256_cmp_ps(life, deadTime, _CMP_NGT_UQ));
+			if (mask == 0)
+				continue;
+			__m256 position[3], velocity[3];
+			for (int k = 0; k < 3; k++) {
+				position[k] = _mm256_loadu_ps(in.position(i) + k * 8);
+				velocity[k] = _mm256_loadu_ps(in.velocity(i) + k * 8);
+			}
+			life = _mm256_add_ps(life, lifeStep);
+			for (int k = 0; k < 3; k++) {
+				position[k] = _mm256_add_ps(position[k], velocity[k]);
+				velocity[k] = _mm256_add_ps(velocity[k], gravity[k]);
+			}
+			if (mask == 0xFF) {
+				for (int k = 0; k < 3; k++) {
+					_mm256_storeu_ps(out.position(dst) + k * 8, position[k]);
+					_mm256_storeu_ps(out.velocity(dst) + k * 8, velocity[k]);
+				}
+				_mm256_storeu_ps(out.life(dst), life);
+				dst += 8;
+				continue;
+			}
+			alignas(32) float positions[24], velocities[24], lifes[8];
+			for (int k = 0; k < 3; k++) {
+				_mm256_store_ps(positions + k * 8, position[k]);
+				_mm256_store_ps(velocities + k * 8, velocity[k]);
+			}
+			_mm256_store_ps(lifes, life);
+			for (int j = 0; j < 8; j++) {
+				if (!(mask & (1 << j)))
+					continue;
+				memcpy(out.position(dst), positions + j * 3, 3 * sizeof(float));
+				memcpy(out.velocity(dst), velocities + j * 3, 3 * sizeof(float));
+				*out.life(dst) = lifes[j];
+				dst++;
+			}
+		}
+	}
+#endif
+	for (; i < end; i++) {
+		if (alive(in.lifeOf(i)))
+			stepParticle(in, i, out, dst++);
+	}
+}
+
+ParticleCpuRunner::ParticleCpuRunner(int threadCount)
+	: threadCount_(threadCount > 0 ? threadCount : std::max<int>(std::thread::hardware_concurrency(), 1))
+{
+	for (int t = 1; t < threadCount_; t++)
+		workers_.emplace_back(&ParticleCpuRunner::workerLoop, this, t);
+}
+
+ParticleCpuRunner::~ParticleCpuRunner()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	jobAvailable_.notify_all();
+	for (auto& worker : workers_)
+		worker.join();
+}
+
+void ParticleCpuRunner::parallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+{
+	const uint32_t workerCount = std::min<uint32_t>(threadCount_, count);
+	if (workerCount <= 1) {
+		for (uint32_t i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		job_ = &func;
+		jobCount_ = count;
+		jobStride_ = workerCount;
+		pending_ = workerCount - 1;
+		generation_++;
+	}
+	jobAvailable_.notify_all();
+	for (uint32_t i = 0; i < count; i += workerCount)
+		func(i);
+	std::unique_lock<std::mutex> lock(mutex_);
+	jobDone_.wait(lock, [this]() { return pending_ == 0; });
+	job_ = nullptr;
+}
+
+void ParticleCpuRunner::workerLoop(uint32_t index)
+{
+	uint64_t generation = 0;
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;) {
+		jobAvailable_.wait(lock, [&]() { return quit_ || generation_ != generation; });
+		if (quit_)
+			return;
+		generation = generation_;
+		if (index >= jobStride_)			//块数少于线程数时不参与
+			continue;
+		const std::function<void(uint32_t)>& job = *job_;
+		const uint32_t count = jobCount_;
+		const uint32_t stride = jobStride_;
+		lock.unlock();
+		for (uint32_t i = index; i < count; i += stride)
+			job(i);
+		lock.lock();
+		if (--pending_ == 0)
+			jobDone_.notify_one();
+	}
+}
+
+uint32_t ParticleCpuRunner::run(const uint8_t* input, uint8_t* output, uint32_t capacity, ParticleSystem::StorageMode mode)
+{
+	int32_t counter;
+	memcpy(&counter, input, sizeof(counter));
+	const uint32_t count = std::min<uint32_t>(std::max(counter, 0), capacity);
+
+	ParticleView in{ (float*)(input + HEADER_SIZE), capacity, mode };
+	ParticleView out{ (float*)(output + HEADER_SIZE), capacity, mode };
+
+	// 先统计每块的存活数量，前缀和得到每块的写出位置，再并行更新，保证输出顺序与线程数无关
+	uint32_t chunkSize = (count + threadCount_ - 1) / threadCount_;
+	chunkSize = std::max<uint32_t>((chunkSize + 7) & ~7u, MIN_CHUNK_SIZE);
+	const uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+	std::vector<uint32_t> offsets(chunkCount + 1, 0);
+	parallelFor(chunkCount, [&](uint32_t chunk) {
+		offsets[chunk + 1] = countAlive(in, chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+	});
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+	parallelFor(chunkCount, [&](uint32_t chunk) {
+		stepRange(in, out, chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize), offsets[chunk]);
+	});
+
+	const int32_t total = offsets.back();
+	memcpy(output, &total, sizeof(total));
+	return total;
+}
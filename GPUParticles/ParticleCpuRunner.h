@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ParticlesSystem.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// particle_runner.comp 的CPU参考实现，直接读写与GPU相同布局的半块粒子缓冲区（ParticlesBuffer）
+// 存活粒子按输入顺序压缩写出，结果是确定的，可作为后备实现或用于校验GPU的结果
+class ParticleCpuRunner
+{
+public:
+	ParticleCpuRunner(int threadCount = 0);			//0表示使用全部硬件线程
+	~ParticleCpuRunner();
+	ParticleCpuRunner(const ParticleCpuRunner&) = delete;
+	ParticleCpuRunner& operator=(const ParticleCpuRunner&) = delete;
+	int threadCount() const { return threadCount_; }
+	uint32_t run(const uint8_t* input, uint8_t* output, uint32_t capacity, ParticleSystem::StorageMode mode);
+private:
+	void parallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+	void workerLoop(uint32_t index);
+private:
+	int threadCount_;
+	// 常驻的threadCount_-1个工作线程，调用线程也参与计算，避免每帧创建和回收线程
+	std::vector<std::thread> workers_;
+	std::mutex mutex_;
+	std::condition_variable jobAvailable_;
+	std::condition_variable jobDone_;
+	const std::function<void(uint32_t)>* job_ = nullptr;
+	uint32_t jobCount_ = 0;
+	uint32_t jobStride_ = 0;			//参与当前任务的线程数，第t个线程处理下标t、t+jobStride_、...
+	uint64_t generation_ = 0;			//每派发一次任务加一
+	uint32_t pending_ = 0;			//尚未完成当前任务的工作线程数
+	bool quit_ = false;
+};
@@ -1,12 +1,41 @@
 #include "ParticlesSystem.h"
 #include "ParitclesRenderer.h"
+#include "ParticleCpuRunner.h"
+#include "QVkMetricsRegistry.h"
 #include "QDateTime"
+#include "QElapsedTimer"
+#include <QtCore/qfloat16.h>
 #include <fstream>
 
 
 #define LOCAL_SIZE 32
 
-#define PARTICLE_MAX_SIZE 100000
+#define COMPACT_LOCAL_SIZE 256
+
+#define EMITTER_LOCAL_SIZE 256
+
+#define MAX_EMITTERS 8
+
+#define SORT_LOCAL_SIZE 256
+
+#define SORT_PASS_KEYS 0
+#define SORT_PASS_LOCAL_SORT 1
+#define SORT_PASS_GLOBAL_STEP 2
+#define SORT_PASS_LOCAL_MERGE 3
+
+#define BILLBOARD_SIZE 0.01f
+#define SORT_STATS_INTERVAL 120			//每隔多少帧输出一次粒子数与排序耗时
+
+#define GRID_LOCAL_SIZE 256
+#define GRID_HASH_SIZE (1 << 20)
+
+#define GRID_PASS_HASH 0
+#define GRID_PASS_SCAN 1
+#define GRID_PASS_ADD 2
+#define GRID_PASS_SCATTER 3
+#define GRID_PASS_FORCES 4
+
+#define PARTICLE_INIT_CAPACITY 100000
 
 struct Particle
 {
@@ -20,7 +49,56 @@ struct ParticlesBuffer
 {
 	int counter;
 	int32_t padding[3];
-	Particle particles[PARTICLE_MAX_SIZE];
+	Particle particles[1];			//实际长度由capacity_决定，在运行时分配
+};
+
+struct RunnerParams
+{
+	uint32_t capacity;
+	uint32_t applyForces;
+};
+
+struct SortParams
+{
+	uint32_t capacity;
+	uint32_t count;
+	uint32_t k;
+	uint32_t j;
+	uint32_t pass;
+	uint32_t padding[3];
+	float viewProjection[16];
+};
+
+struct GridParams
+{
+	uint32_t capacity;
+	uint32_t count;
+	uint32_t pass;
+	uint32_t hashSize;
+	uint32_t scanOffset;
+	uint32_t scanCount;
+	uint32_t blockSumOffset;
+	uint32_t particleCellOffset;
+	uint32_t sortedOffset;
+	float cellSize;
+	float radius;
+	uint32_t maxNeighbours;
+	float weights[4];
+};
+
+struct BillboardParams
+{
+	float viewProjection[16];
+	float billboardScale[2];
+};
+
+struct EmitterParams
+{
+	uint32_t capacity;
+	uint32_t base;
+	uint32_t seed;
+	uint32_t emitterCount;
+	uint32_t spawnEnd[MAX_EMITTERS];
 };
 
 static std::vector<char> readFile(const std::string& filename) {
@@ -46,48 +124,147 @@ static inline vk::DeviceSize aligned(vk::DeviceSize v, vk::DeviceSize byteAlign)
 	return (v + byteAlign - 1) & ~(byteAlign - 1);
 }
 
+struct GridLayout				//particle_grid.comp 中 gridData 的划分（以uint为单位）
+{
+	struct ScanLevel {
+		uint32_t offset;
+		uint32_t count;
+	};
+	std::vector<ScanLevel> scanLevels;		//第0级即单元计数，之后每级是上一级各工作组的总和
+	uint32_t dummyOffset;
+	uint32_t particleCellOffset;
+	uint32_t sortedOffset;
+	uint32_t size;
+};
+
+static GridLayout gridLayout(uint32_t capacity)
+{
+	GridLayout layout;
+	uint32_t offset = GRID_HASH_SIZE;
+	uint32_t count = GRID_HASH_SIZE;
+	layout.scanLevels.push_back({ 0, count });
+	while (count > GRID_LOCAL_SIZE) {
+		count = (count + GRID_LOCAL_SIZE - 1) / GRID_LOCAL_SIZE;
+		layout.scanLevels.push_back({ offset, count });
+		offset += count;
+	}
+	layout.dummyOffset = offset++;
+	layout.particleCellOffset = offset;
+	offset += capacity * 2;
+	layout.sortedOffset = offset;
+	offset += capacity;
+	layout.size = offset;
+	return layout;
+}
+
+static inline uint32_t nextPowerOfTwo(uint32_t v)
+{
+	uint32_t result = 1;
+	while (result < v)
+		result <<= 1;
+	return result;
+}
+
 ParticleSystem::ParticleSystem(ParticlesRenderer* window)
 	: renderer_(window)
 {
-	camera.setup(renderer_->window_);
+}
+
+struct ParticleArrays			//各属性数组相对于半块缓冲区起始处的偏移与步长（字节）
+{
+	vk::DeviceSize positionOffset;
+	vk::DeviceSize positionStride;
+	vk::DeviceSize velocityOffset;
+	vk::DeviceSize velocityStride;
+	vk::DeviceSize lifeOffset;
+	vk::DeviceSize lifeStride;
+	vk::DeviceSize size;
+};
+
+static vk::DeviceSize bytesPerParticle(ParticleSystem::StorageMode mode)
+{
+	switch (mode) {
+	case ParticleSystem::StorageMode::SoA:
+		return 3 * sizeof(float) + 3 * sizeof(float) + sizeof(float);
+	case ParticleSystem::StorageMode::SoAHalf:
+		return 3 * sizeof(float) + 4 * sizeof(qfloat16);
+	default:
+		return sizeof(Particle);
+	}
+}
+
+// 与 particle_storage.glsl 中的布局保持一致
+static ParticleArrays particleArrays(ParticleSystem::StorageMode mode, uint32_t capacity)
+{
+	const vk::DeviceSize header = offsetof(ParticlesBuffer, particles);
+	ParticleArrays arrays;
+	arrays.size = header + vk::DeviceSize(capacity) * bytesPerParticle(mode);
+	switch (mode) {
+	case ParticleSystem::StorageMode::SoA:
+		arrays.positionOffset = header;
+		arrays.positionStride = 3 * sizeof(float);
+		arrays.velocityOffset = header + vk::DeviceSize(capacity) * 3 * sizeof(float);
+		arrays.velocityStride = 3 * sizeof(float);
+		arrays.lifeOffset = header + vk::DeviceSize(capacity) * 6 * sizeof(float);
+		arrays.lifeStride = sizeof(float);
+		break;
+	case ParticleSystem::StorageMode::SoAHalf:
+		arrays.positionOffset = header;
+		arrays.positionStride = 3 * sizeof(float);
+		arrays.velocityOffset = header + vk::DeviceSize(capacity) * 3 * sizeof(float);
+		arrays.velocityStride = 4 * sizeof(qfloat16);
+		arrays.lifeOffset = arrays.velocityOffset + 3 * sizeof(qfloat16);		//life存放在速度的第四个分量
+		arrays.lifeStride = arrays.velocityStride;
+		break;
+	default:
+		arrays.positionOffset = header + offsetof(Particle, position);
+		arrays.positionStride = sizeof(Particle);
+		arrays.velocityOffset = header + offsetof(Particle, velocity);
+		arrays.velocityStride = sizeof(Particle);
+		arrays.lifeOffset = header + offsetof(Particle, life);
+		arrays.lifeStride = sizeof(Particle);
+		break;
+	}
+	return arrays;
 }
 
 void ParticleSystem::initResource()
 {
 	vk::Device device = renderer_->window_->device();
-	vk::BufferCreateInfo bufInfo;
-	vk::DeviceSize alignBufferSize = aligned(sizeof(ParticlesBuffer), renderer_->window_->physicalDeviceProperties()->limits.minStorageBufferOffsetAlignment);
-	bufInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer;
-	bufInfo.sharingMode = vk::SharingMode::eExclusive;
-	bufInfo.size = 2 * alignBufferSize;
-	buffer_ = device.createBuffer(bufInfo);
 
-	vk::MemoryRequirements memReq = device.getBufferMemoryRequirements(buffer_);
-	vk::MemoryAllocateInfo memAllocInfo(memReq.size, renderer_->window_->hostVisibleMemoryIndex());
-	bufMemory_ = device.allocateMemory(memAllocInfo);
-	device.bindBufferMemory(buffer_, bufMemory_, 0);
-
-	vk::DescriptorSetLayoutBinding descSetLayoutBinding[2];
+	vk::DescriptorSetLayoutBinding descSetLayoutBinding[6];
 	descSetLayoutBinding[0].binding = 0;
 	descSetLayoutBinding[0].descriptorCount = 1;
 	descSetLayoutBinding[0].descriptorType = vk::DescriptorType::eStorageBuffer;
-	descSetLayoutBinding[0].stageFlags = vk::ShaderStageFlagBits::eCompute;
+	descSetLayoutBinding[0].stageFlags = vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex;
 	descSetLayoutBinding[1] = descSetLayoutBinding[0];
 	descSetLayoutBinding[1].binding = 1;
+	descSetLayoutBinding[1].stageFlags = vk::ShaderStageFlagBits::eCompute;
+	descSetLayoutBinding[2] = descSetLayoutBinding[1];
+	descSetLayoutBinding[2].binding = 2;
+	descSetLayoutBinding[2].descriptorType = vk::DescriptorType::eUniformBuffer;
+	descSetLayoutBinding[3] = descSetLayoutBinding[0];
+	descSetLayoutBinding[3].binding = 3;					//排序后的粒子索引
+	descSetLayoutBinding[4] = descSetLayoutBinding[1];
+	descSetLayoutBinding[4].binding = 4;					//邻域力
+	descSetLayoutBinding[5] = descSetLayoutBinding[1];
+	descSetLayoutBinding[5].binding = 5;					//空间哈希网格
 
 	vk::DescriptorSetLayoutCreateInfo descSetLayoutInfo;
-	descSetLayoutInfo.bindingCount = 2;
+	descSetLayoutInfo.bindingCount = 6;
 	descSetLayoutInfo.pBindings = descSetLayoutBinding;
 	descSetLayout_ = device.createDescriptorSetLayout(descSetLayoutInfo);
 
-	vk::DescriptorPoolSize descPoolSize;
-	descPoolSize.descriptorCount = 4;
-	descPoolSize.type = vk::DescriptorType::eStorageBuffer;
+	vk::DescriptorPoolSize descPoolSize[2];
+	descPoolSize[0].descriptorCount = 10;
+	descPoolSize[0].type = vk::DescriptorType::eStorageBuffer;
+	descPoolSize[1].descriptorCount = 2;
+	descPoolSize[1].type = vk::DescriptorType::eUniformBuffer;
 
 	vk::DescriptorPoolCreateInfo descPoolInfo;
 	descPoolInfo.maxSets = 2;
-	descPoolInfo.poolSizeCount = 1;
-	descPoolInfo.pPoolSizes = &descPoolSize;
+	descPoolInfo.poolSizeCount = 2;
+	descPoolInfo.pPoolSizes = descPoolSize;
 	descPool_ = device.createDescriptorPool(descPoolInfo);
 
 	vk::DescriptorSetAllocateInfo descSetAllocInfo;
@@ -97,52 +274,124 @@ void ParticleSystem::initResource()
 	descSet_[0] = device.allocateDescriptorSets(descSetAllocInfo).front();
 	descSet_[1] = device.allocateDescriptorSets(descSetAllocInfo).front();
 
-	descBufInfo_[0].buffer = buffer_;
-	descBufInfo_[0].offset = 0;
-	descBufInfo_[0].range = alignBufferSize;
+	const auto& limits = renderer_->window_->physicalDeviceProperties()->limits;
+	maxCapacity_ = (limits.maxStorageBufferRange - limits.minStorageBufferOffsetAlignment - offsetof(ParticlesBuffer, particles)) / bytesPerParticle(storageMode_);
 
-	descBufInfo_[1].buffer = buffer_;
-	descBufInfo_[1].offset = alignBufferSize;
-	descBufInfo_[1].range = alignBufferSize;
+	createBuffer(std::min<uint32_t>(PARTICLE_INIT_CAPACITY, maxCapacity_));
+
+	vk::BufferCreateInfo emitterBufInfo;
+	emitterBufInfo.usage = vk::BufferUsageFlagBits::eUniformBuffer;
+	emitterBufInfo.sharingMode = vk::SharingMode::eExclusive;
+	emitterBufInfo.size = MAX_EMITTERS * sizeof(ParticleEmitter);
+	emitterBuffer_ = device.createBuffer(emitterBufInfo);
+
+	vk::MemoryRequirements emitterMemReq = device.getBufferMemoryRequirements(emitterBuffer_);
+	vk::MemoryAllocateInfo emitterMemAllocInfo(emitterMemReq.size, renderer_->window_->hostVisibleMemoryIndex());
+	emitterMemory_ = device.allocateMemory(emitterMemAllocInfo);
+	device.bindBufferMemory(emitterBuffer_, emitterMemory_, 0);
+	updateEmitterBuffer();
 
-	for (int i = 0; i < std::size(descSetLayoutBinding); i++) {
+	vk::DescriptorBufferInfo emitterDescBufInfo(emitterBuffer_, 0, emitterBufInfo.size);
+	for (auto& descSet : descSet_) {
 		vk::WriteDescriptorSet descSetWriter;
 		descSetWriter.descriptorCount = 1;
-		descSetWriter.descriptorType = vk::DescriptorType::eStorageBuffer;
-		descSetWriter.dstSet = descSet_[0];
-		descSetWriter.dstBinding = descSetLayoutBinding[i].binding;
-		descSetWriter.descriptorType = descSetLayoutBinding[i].descriptorType;
-		descSetWriter.pBufferInfo = &descBufInfo_[i];
-		device.updateDescriptorSets(1, &descSetWriter, 0, nullptr);
-
-		descSetWriter.dstSet = descSet_[1];
-		descSetWriter.pBufferInfo = &descBufInfo_[1 - i];
+		descSetWriter.descriptorType = vk::DescriptorType::eUniformBuffer;
+		descSetWriter.dstSet = descSet;
+		descSetWriter.dstBinding = 2;
+		descSetWriter.pBufferInfo = &emitterDescBufInfo;
 		device.updateDescriptorSets(1, &descSetWriter, 0, nullptr);
 	}
 
-	auto compShaderCode = readFile("./particle_runner.spv");
-
-	vk::ShaderModuleCreateInfo shaderInfo;
-	shaderInfo.codeSize = compShaderCode.size();
-	shaderInfo.pCode = reinterpret_cast<uint32_t*>(compShaderCode.data());
-	vk::ShaderModule computeShaderModule = device.createShaderModule(shaderInfo);
+	runnerPushConstant_.size = sizeof(RunnerParams);
+	runnerPushConstant_.stageFlags = vk::ShaderStageFlagBits::eCompute;
 
 	vk::PipelineLayoutCreateInfo piplineLayoutInfo;
 	piplineLayoutInfo.setLayoutCount = 1;
 	piplineLayoutInfo.pSetLayouts = &descSetLayout_;
+	piplineLayoutInfo.pushConstantRangeCount = 1;
+	piplineLayoutInfo.pPushConstantRanges = &runnerPushConstant_;
 	runnerPiplineLayout_ = device.createPipelineLayout(piplineLayoutInfo);
 
-	vk::PipelineShaderStageCreateInfo computeStageInfo;
-	computeStageInfo.stage = vk::ShaderStageFlagBits::eCompute;
-	computeStageInfo.module = computeShaderModule;
-	computeStageInfo.pName = "main";
+	auto createComputePipline = [&](const std::string& filename, vk::PipelineLayout layout) {
+		auto compShaderCode = readFile(filename);
+
+		vk::ShaderModuleCreateInfo shaderInfo;
+		shaderInfo.codeSize = compShaderCode.size();
+		shaderInfo.pCode = reinterpret_cast<uint32_t*>(compShaderCode.data());
+		vk::ShaderModule computeShaderModule = device.createShaderModule(shaderInfo);
+
+		uint32_t storageMode = (uint32_t)storageMode_;
+		vk::SpecializationMapEntry specMapEntry;
+		specMapEntry.constantID = 0;
+		specMapEntry.offset = 0;
+		specMapEntry.size = sizeof(storageMode);
+
+		vk::SpecializationInfo specInfo;
+		specInfo.mapEntryCount = 1;
+		specInfo.pMapEntries = &specMapEntry;
+		specInfo.pData = &storageMode;
+		specInfo.dataSize = sizeof(storageMode);
+
+		vk::PipelineShaderStageCreateInfo computeStageInfo;
+		computeStageInfo.stage = vk::ShaderStageFlagBits::eCompute;
+		computeStageInfo.module = computeShaderModule;
+		computeStageInfo.pName = "main";
+		computeStageInfo.pSpecializationInfo = &specInfo;
+
+		vk::ComputePipelineCreateInfo computePiplineInfo;
+		computePiplineInfo.stage = computeStageInfo;
+		computePiplineInfo.layout = layout;
+		vk::Pipeline pipline = device.createComputePipeline(renderer_->piplineCache_, computePiplineInfo).value;
+
+		device.destroyShaderModule(computeShaderModule);
+		return pipline;
+	};
+
+	runnerPipline_ = createComputePipline("./particle_runner.spv", runnerPiplineLayout_);
 
-	vk::ComputePipelineCreateInfo computePiplineInfo;
-	computePiplineInfo.stage = computeStageInfo;
-	computePiplineInfo.layout = runnerPiplineLayout_;
-	runnerPipline_ = device.createComputePipeline(renderer_->piplineCache_, computePiplineInfo).value;
+	emitterPushConstant_.size = sizeof(EmitterParams);
+	emitterPushConstant_.stageFlags = vk::ShaderStageFlagBits::eCompute;
+	piplineLayoutInfo.pPushConstantRanges = &emitterPushConstant_;
+	emitterPiplineLayout_ = device.createPipelineLayout(piplineLayoutInfo);
 
-	device.destroyShaderModule(computeShaderModule);
+	emitterPipline_ = createComputePipline("./particle_emitter.spv", emitterPiplineLayout_);
+
+	// 一维派发+子组前缀和压缩需要 Vulkan 1.1 的 subgroup ballot 支持
+	compactSupported_ = false;
+	if (renderer_->window_->physicalDeviceProperties()->apiVersion >= VK_API_VERSION_1_1) {
+		vk::PhysicalDevice physicalDevice = renderer_->window_->physicalDevice();
+		auto props = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceSubgroupProperties>();
+		const auto& subgroupProps = props.get<vk::PhysicalDeviceSubgroupProperties>();
+		compactSupported_ = (subgroupProps.supportedStages & vk::ShaderStageFlagBits::eCompute)
+			&& (subgroupProps.supportedOperations & vk::SubgroupFeatureFlagBits::eBasic)
+			&& (subgroupProps.supportedOperations & vk::SubgroupFeatureFlagBits::eBallot);
+	}
+	if (compactSupported_)
+		compactPipline_ = createComputePipline("./particle_compact.spv", runnerPiplineLayout_);
+	else
+		runnerMode_ = RunnerMode::Grid2D;
+
+	sortPushConstant_.size = sizeof(SortParams);
+	sortPushConstant_.stageFlags = vk::ShaderStageFlagBits::eCompute;
+	piplineLayoutInfo.pPushConstantRanges = &sortPushConstant_;
+	sortPiplineLayout_ = device.createPipelineLayout(piplineLayoutInfo);
+	sortPipline_ = createComputePipline("./particle_sort.spv", sortPiplineLayout_);
+
+	gridPushConstant_.size = sizeof(GridParams);
+	gridPushConstant_.stageFlags = vk::ShaderStageFlagBits::eCompute;
+	piplineLayoutInfo.pPushConstantRanges = &gridPushConstant_;
+	gridPiplineLayout_ = device.createPipelineLayout(piplineLayoutInfo);
+	gridPipline_ = createComputePipline("./particle_grid.spv", gridPiplineLayout_);
+
+	if (limits.timestampComputeAndGraphics) {
+		vk::QueryPoolCreateInfo queryPoolInfo;
+		queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+		queryPoolInfo.queryCount = 2 * QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT;
+		sortQueryPool_ = device.createQueryPool(queryPoolInfo);
+		sortQueryValid_.fill(false);
+	}
+
+	vk::ShaderModuleCreateInfo shaderInfo;
 
 	vk::GraphicsPipelineCreateInfo piplineInfo;
 	piplineInfo.stageCount = 2;
@@ -169,15 +418,17 @@ void ParticleSystem::initResource()
 
 	piplineInfo.pStages = piplineShaderStage;
 
+	ParticleArrays arrays = particleArrays(storageMode_, 0);		//SoA布局下顶点着色器只读取紧凑的位置数组
+
 	vk::VertexInputBindingDescription vertexBindingDesc;
 	vertexBindingDesc.binding = 0;
-	vertexBindingDesc.stride = sizeof(Particle);
+	vertexBindingDesc.stride = arrays.positionStride;
 	vertexBindingDesc.inputRate = vk::VertexInputRate::eVertex;
 
 	vk::VertexInputAttributeDescription vertexAttrDesc;
 	vertexAttrDesc.binding = 0;
 	vertexAttrDesc.location = 0;
-	vertexAttrDesc.offset = offsetof(ParticlesBuffer, particles);
+	vertexAttrDesc.offset = arrays.positionOffset;
 	vertexAttrDesc.format = vk::Format::eR32G32B32Sfloat;
 
 	vk::PipelineVertexInputStateCreateInfo vertexInputState({}, 1, &vertexBindingDesc, 1, &vertexAttrDesc);
@@ -236,36 +487,389 @@ void ParticleSystem::initResource()
 	device.destroyShaderModule(vertShader);
 	device.destroyShaderModule(fragShader);
 
+	// 按深度排序后的半透明公告板：顶点着色器从存储缓冲区读取位置，关闭深度写入，开启alpha混合
+	vertShaderCode = readFile("./particle_billboard_vert.spv");
+	fragShaderCode = readFile("./particle_billboard_frag.spv");
+
+	shaderInfo.codeSize = vertShaderCode.size();
+	shaderInfo.pCode = reinterpret_cast<uint32_t*>(vertShaderCode.data());
+	vertShader = device.createShaderModule(shaderInfo);
+
+	shaderInfo.codeSize = fragShaderCode.size();
+	shaderInfo.pCode = reinterpret_cast<uint32_t*>(fragShaderCode.data());
+	fragShader = device.createShaderModule(shaderInfo);
+
+	uint32_t storageMode = (uint32_t)storageMode_;
+	vk::SpecializationMapEntry specMapEntry;
+	specMapEntry.constantID = 0;
+	specMapEntry.offset = 0;
+	specMapEntry.size = sizeof(storageMode);
+
+	vk::SpecializationInfo specInfo;
+	specInfo.mapEntryCount = 1;
+	specInfo.pMapEntries = &specMapEntry;
+	specInfo.pData = &storageMode;
+	specInfo.dataSize = sizeof(storageMode);
+
+	piplineShaderStage[0].module = vertShader;
+	piplineShaderStage[0].pSpecializationInfo = &specInfo;
+	piplineShaderStage[1].module = fragShader;
+
+	vk::PipelineVertexInputStateCreateInfo emptyVertexInputState;
+	piplineInfo.pVertexInputState = &emptyVertexInputState;
+
+	vertexAssemblyState.topology = vk::PrimitiveTopology::eTriangleList;
+
+	DSState.depthWriteEnable = false;
+
+	colorBlendAttachmentState.blendEnable = true;
+	colorBlendAttachmentState.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+	colorBlendAttachmentState.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+	colorBlendAttachmentState.colorBlendOp = vk::BlendOp::eAdd;
+	colorBlendAttachmentState.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+	colorBlendAttachmentState.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+	colorBlendAttachmentState.alphaBlendOp = vk::BlendOp::eAdd;
+
+	billboardPushConstant_.size = sizeof(BillboardParams);
+	billboardPushConstant_.stageFlags = vk::ShaderStageFlagBits::eVertex;
+	renderPiplineLayoutInfo.setLayoutCount = 1;
+	renderPiplineLayoutInfo.pSetLayouts = &descSetLayout_;
+	renderPiplineLayoutInfo.pPushConstantRanges = &billboardPushConstant_;
+	billboardPiplineLayout_ = device.createPipelineLayout(renderPiplineLayoutInfo);
+	piplineInfo.layout = billboardPiplineLayout_;
+
+	billboardPipline_ = device.createGraphicsPipeline(renderer_->piplineCache_, piplineInfo).value;
+
+	device.destroyShaderModule(vertShader);
+	device.destroyShaderModule(fragShader);
+
+}
+
+void ParticleSystem::createBuffer(uint32_t capacity)
+{
+	vk::Device device = renderer_->window_->device();
+	vk::BufferCreateInfo bufInfo;
+	vk::DeviceSize alignBufferSize = aligned(particleArrays(storageMode_, capacity).size, renderer_->window_->physicalDeviceProperties()->limits.minStorageBufferOffsetAlignment);
+	bufInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+	bufInfo.sharingMode = vk::SharingMode::eExclusive;
+	bufInfo.size = 2 * alignBufferSize;
+	buffer_ = device.createBuffer(bufInfo);
+
+	vk::MemoryRequirements memReq = device.getBufferMemoryRequirements(buffer_);
+	vk::MemoryAllocateInfo memAllocInfo(memReq.size, renderer_->window_->hostVisibleMemoryIndex());
+	bufMemory_ = device.allocateMemory(memAllocInfo);
+	device.bindBufferMemory(buffer_, bufMemory_, 0);
+
+	descBufInfo_[0].buffer = buffer_;
+	descBufInfo_[0].offset = 0;
+	descBufInfo_[0].range = alignBufferSize;
+
+	descBufInfo_[1].buffer = buffer_;
+	descBufInfo_[1].offset = alignBufferSize;
+	descBufInfo_[1].range = alignBufferSize;
+
+	createStorageBuffer(nextPowerOfTwo(std::max<uint32_t>(capacity, SORT_LOCAL_SIZE)) * 2 * sizeof(uint32_t), 3, sortBuffer_, sortMemory_);
+	createStorageBuffer(vk::DeviceSize(capacity) * 4 * sizeof(float), 4, forceBuffer_, forceMemory_);
+	createStorageBuffer(vk::DeviceSize(gridLayout(capacity).size) * sizeof(uint32_t), 5, gridBuffer_, gridMemory_);
+
+	for (uint32_t binding = 0; binding < 2; binding++) {
+		vk::WriteDescriptorSet descSetWriter;
+		descSetWriter.descriptorCount = 1;
+		descSetWriter.descriptorType = vk::DescriptorType::eStorageBuffer;
+		descSetWriter.dstSet = descSet_[0];
+		descSetWriter.dstBinding = binding;
+		descSetWriter.pBufferInfo = &descBufInfo_[binding];
+		device.updateDescriptorSets(1, &descSetWriter, 0, nullptr);
+
+		descSetWriter.dstSet = descSet_[1];
+		descSetWriter.pBufferInfo = &descBufInfo_[1 - binding];
+		device.updateDescriptorSets(1, &descSetWriter, 0, nullptr);
+	}
+
+	int reset = 0;			//两块缓冲区的计数器都需要清零
+	for (auto& info : descBufInfo_) {
+		uint8_t* memPtr = (uint8_t*)device.mapMemory(bufMemory_, info.offset, sizeof(int), {});
+		memcpy(memPtr, &reset, sizeof(int));
+		device.unmapMemory(bufMemory_);
+	}
+	capacity_ = capacity;
+}
+
+void ParticleSystem::createStorageBuffer(vk::DeviceSize size, uint32_t binding, vk::Buffer& buffer, vk::DeviceMemory& memory)
+{
+	vk::Device device = renderer_->window_->device();
+	if (buffer) {
+		device.destroyBuffer(buffer);
+		device.freeMemory(memory);
+	}
+	vk::BufferCreateInfo bufInfo;
+	bufInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+	bufInfo.sharingMode = vk::SharingMode::eExclusive;
+	bufInfo.size = size;
+	buffer = device.createBuffer(bufInfo);
+
+	vk::MemoryRequirements memReq = device.getBufferMemoryRequirements(buffer);
+	vk::MemoryAllocateInfo memAllocInfo(memReq.size, renderer_->window_->deviceLocalMemoryIndex());
+	memory = device.allocateMemory(memAllocInfo);
+	device.bindBufferMemory(buffer, memory, 0);
+
+	vk::DescriptorBufferInfo descBufInfo(buffer, 0, size);
+	for (auto& descSet : descSet_) {
+		vk::WriteDescriptorSet descSetWriter;
+		descSetWriter.descriptorCount = 1;
+		descSetWriter.descriptorType = vk::DescriptorType::eStorageBuffer;
+		descSetWriter.dstSet = descSet;
+		descSetWriter.dstBinding = binding;
+		descSetWriter.pBufferInfo = &descBufInfo;
+		device.updateDescriptorSets(1, &descSetWriter, 0, nullptr);
+	}
+}
+
+void ParticleSystem::reserve(uint32_t capacity)
+{
+	capacity = std::min(capacity, maxCapacity_);
+	if (capacity <= capacity_)
+		return;
+
+	vk::Device device = renderer_->window_->device();
+	vk::Queue graphicsQueue = renderer_->window_->graphicsQueue();
+	graphicsQueue.waitIdle();			//旧缓冲区可能仍被在途的帧引用
+
+	vk::Buffer oldBuffer = buffer_;
+	vk::DeviceMemory oldMemory = bufMemory_;
+	vk::DeviceSize oldOffset = descBufInfo_[0].offset;
+	ParticleArrays oldArrays = particleArrays(storageMode_, capacity_);
+
+	createBuffer(capacity);
+
+	vk::CommandBufferAllocateInfo cmdBufferAlllocInfo;
+	cmdBufferAlllocInfo.level = vk::CommandBufferLevel::ePrimary;
+	cmdBufferAlllocInfo.commandPool = renderer_->window_->graphicsCommandPool();
+	cmdBufferAlllocInfo.commandBufferCount = 1;
+	vk::CommandBuffer cmdBuffer = device.allocateCommandBuffers(cmdBufferAlllocInfo).front();
+
+	vk::CommandBufferBeginInfo cmdBeginInfo;
+	cmdBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	cmdBuffer.begin(cmdBeginInfo);
+	// 只拷贝计数器和存活的粒子，SoA布局下各属性数组的偏移随容量变化，需要分别拷贝
+	ParticleArrays newArrays = particleArrays(storageMode_, capacity_);
+	std::vector<vk::BufferCopy> copyRegions;
+	copyRegions.emplace_back(oldOffset, descBufInfo_[0].offset, oldArrays.positionOffset + oldArrays.positionStride * currentNumOfParticles);
+	if (storageMode_ != StorageMode::AoS && currentNumOfParticles > 0) {
+		copyRegions.emplace_back(oldOffset + oldArrays.velocityOffset, descBufInfo_[0].offset + newArrays.velocityOffset, oldArrays.velocityStride * currentNumOfParticles);
+		if (storageMode_ == StorageMode::SoA)
+			copyRegions.emplace_back(oldOffset + oldArrays.lifeOffset, descBufInfo_[0].offset + newArrays.lifeOffset, oldArrays.lifeStride * currentNumOfParticles);
+	}
+	cmdBuffer.copyBuffer(oldBuffer, buffer_, copyRegions);
+	cmdBuffer.end();
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmdBuffer;
+	graphicsQueue.submit(submitInfo);
+	graphicsQueue.waitIdle();
+	device.freeCommandBuffers(renderer_->window_->graphicsCommandPool(), cmdBuffer);
+
+	device.destroyBuffer(oldBuffer);
+	device.freeMemory(oldMemory);
 }
 
 void ParticleSystem::create(int num)
 {
 	vk::Device device = renderer_->window_->device();
-	num = std::clamp(num, 0, PARTICLE_MAX_SIZE - currentNumOfParticles);
+	num = std::max(num, 0);
+	if (currentNumOfParticles + num > capacity_)
+		reserve(std::max<uint32_t>(capacity_ * 2, currentNumOfParticles + num));		//按几何级数扩容
+	if (currentNumOfParticles + num > capacity_) {
+		qWarning() << "particle capacity exceeds maxStorageBufferRange, clamp to" << capacity_;
+		num = capacity_ - currentNumOfParticles;
+	}
+	if (num == 0)
+		return;
 
-	std::vector<Particle> particles(num);
-	for (auto& particle : particles)
+	ParticleArrays arrays = particleArrays(storageMode_, capacity_);
+	uint8_t* memPtr = (uint8_t*)device.mapMemory(bufMemory_, descBufInfo_[0].offset, descBufInfo_[0].range, {});
+	for (int i = 0; i < num; i++)
 	{
-		particle.life = 0;
-		particle.position = QVector3D(0, 0, 0);
+		const vk::DeviceSize index = currentNumOfParticles + i;
+		float life = 0;
+		QVector3D position(0, 0, 0);
 		double randomAngle = rand() % 360 / 180 * M_PI;
-		particle.velocity = QVector3D(std::cos(randomAngle) / 200, -0.005, std::sin(randomAngle) / 200);
+		QVector3D velocity(std::cos(randomAngle) / 200, -0.005, std::sin(randomAngle) / 200);
+
+		memcpy(memPtr + arrays.positionOffset + index * arrays.positionStride, &position, sizeof(position));
+		if (storageMode_ == StorageMode::SoAHalf) {
+			qfloat16 velocityLife[4] = { qfloat16(velocity.x()), qfloat16(velocity.y()), qfloat16(velocity.z()), qfloat16(life) };
+			memcpy(memPtr + arrays.velocityOffset + index * arrays.velocityStride, velocityLife, sizeof(velocityLife));
+		}
+		else {
+			memcpy(memPtr + arrays.velocityOffset + index * arrays.velocityStride, &velocity, sizeof(velocity));
+			memcpy(memPtr + arrays.lifeOffset + index * arrays.lifeStride, &life, sizeof(life));
+		}
 	}
 
-	uint8_t* memPtr = (uint8_t*)device.mapMemory(bufMemory_, descBufInfo_[0].offset + offsetof(ParticlesBuffer, particles) + currentNumOfParticles * sizeof(Particle), num * sizeof(Particle), {});
-	memcpy(memPtr, particles.data(), num * sizeof(Particle));
-	device.unmapMemory(bufMemory_);
-
 	currentNumOfParticles += num;
-	memPtr = (uint8_t*)device.mapMemory(bufMemory_, descBufInfo_[0].offset, sizeof(int), {});
 	memcpy(memPtr, &currentNumOfParticles, sizeof(int));
 	device.unmapMemory(bufMemory_);
 }
 
+void ParticleSystem::setStorageMode(StorageMode mode)
+{
+	if (buffer_) {
+		qWarning() << "particle storage mode must be set before initResource";
+		return;
+	}
+	storageMode_ = mode;
+}
+
+void ParticleSystem::setRunnerMode(RunnerMode mode)
+{
+	if (mode == RunnerMode::Compact1D && !compactSupported_)
+		return;
+	runnerMode_ = mode;
+}
+
+void ParticleSystem::setNeighbourEnabled(bool enabled)
+{
+	neighbourEnabled_ = enabled;
+}
+
+void ParticleSystem::setNeighbourParams(const NeighbourParams& params)
+{
+	neighbourParams_ = params;
+}
+
+void ParticleSystem::recordNeighbours(vk::CommandBuffer cmdBuffer)
+{
+	const GridLayout layout = gridLayout(capacity_);
+	const uint32_t maxGroupCount = renderer_->window_->physicalDeviceProperties()->limits.maxComputeWorkGroupCount[0];
+
+	// 单元计数清零后，依次完成：哈希 -> 前缀和得到单元起始位置 -> 按单元写出索引 -> 邻域力
+	cmdBuffer.fillBuffer(gridBuffer_, 0, GRID_HASH_SIZE * sizeof(uint32_t), 0);
+	vk::MemoryBarrier clearBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, clearBarrier, nullptr, nullptr);
+
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, gridPipline_);
+	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, gridPiplineLayout_, 0, 1, &descSet_[0], 0, nullptr);
+
+	GridParams params = {};
+	params.capacity = capacity_;
+	params.count = currentNumOfParticles;
+	params.hashSize = GRID_HASH_SIZE;
+	params.particleCellOffset = layout.particleCellOffset;
+	params.sortedOffset = layout.sortedOffset;
+	params.cellSize = neighbourParams_.cellSize;
+	params.radius = neighbourParams_.radius;
+	params.maxNeighbours = neighbourParams_.maxNeighbours;
+	params.weights[0] = neighbourParams_.separation;
+	params.weights[1] = neighbourParams_.alignment;
+	params.weights[2] = neighbourParams_.cohesion;
+
+	vk::MemoryBarrier barrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+	auto dispatchPass = [&](uint32_t pass, uint32_t count) {
+		params.pass = pass;
+		cmdBuffer.pushConstants<GridParams>(gridPiplineLayout_, gridPushConstant_.stageFlags, 0, params);
+		uint32_t groupCount = std::max<uint32_t>((count + GRID_LOCAL_SIZE - 1) / GRID_LOCAL_SIZE, 1);
+		uint32_t groupCountX = std::min(groupCount, maxGroupCount);
+		cmdBuffer.dispatch(groupCountX, (groupCount + groupCountX - 1) / groupCountX, 1);
+		cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, barrier, nullptr, nullptr);
+	};
+
+	dispatchPass(GRID_PASS_HASH, currentNumOfParticles);
+	for (size_t level = 0; level < layout.scanLevels.size(); level++) {
+		params.scanOffset = layout.scanLevels[level].offset;
+		params.scanCount = layout.scanLevels[level].count;
+		params.blockSumOffset = level + 1 < layout.scanLevels.size() ? layout.scanLevels[level + 1].offset : layout.dummyOffset;
+		dispatchPass(GRID_PASS_SCAN, params.scanCount);
+	}
+	for (size_t level = layout.scanLevels.size() - 1; level-- > 0;) {
+		params.scanOffset = layout.scanLevels[level].offset;
+		params.scanCount = layout.scanLevels[level].count;
+		params.blockSumOffset = layout.scanLevels[level + 1].offset;
+		dispatchPass(GRID_PASS_ADD, params.scanCount);
+	}
+	dispatchPass(GRID_PASS_SCATTER, currentNumOfParticles);
+	dispatchPass(GRID_PASS_FORCES, currentNumOfParticles);
+}
+
+void ParticleSystem::recordRun(vk::CommandBuffer cmdBuffer)
+{
+	if (neighbourEnabled_ && currentNumOfParticles > 0)
+		recordNeighbours(cmdBuffer);
+
+	RunnerParams params;
+	params.capacity = capacity_;
+	params.applyForces = neighbourEnabled_;
+
+	if (runnerMode_ == RunnerMode::Compact1D) {
+		cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, compactPipline_);
+		cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, runnerPiplineLayout_, 0, 1, &descSet_[0], 0, nullptr);
+		cmdBuffer.pushConstants<RunnerParams>(runnerPiplineLayout_, runnerPushConstant_.stageFlags, 0, params);
+		uint32_t maxGroupCount = renderer_->window_->physicalDeviceProperties()->limits.maxComputeWorkGroupCount[0];
+		uint32_t groupCount = (currentNumOfParticles + COMPACT_LOCAL_SIZE - 1) / COMPACT_LOCAL_SIZE;
+		cmdBuffer.dispatch(std::clamp<uint32_t>(groupCount, 1, maxGroupCount), 1, 1);		//超出上限的部分由着色器内的循环处理
+	}
+	else {
+		cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, runnerPipline_);
+		cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, runnerPiplineLayout_, 0, 1, &descSet_[0], 0, nullptr);
+		cmdBuffer.pushConstants<RunnerParams>(runnerPiplineLayout_, runnerPushConstant_.stageFlags, 0, params);
+		int numSqrt = std::ceil(std::sqrt(currentNumOfParticles) / LOCAL_SIZE);
+		cmdBuffer.dispatch(numSqrt, numSqrt, 1);
+	}
+}
+
+int ParticleSystem::addEmitter(const ParticleEmitter& emitter)
+{
+	if (emitters_.size() >= MAX_EMITTERS) {
+		qWarning() << "particle emitter count exceeds" << MAX_EMITTERS;
+		return -1;
+	}
+	emitters_.push_back(emitter);
+	emitAccumulator_.push_back(0);
+	updateEmitterBuffer();
+	return (int)emitters_.size() - 1;
+}
+
+void ParticleSystem::setEmitter(int index, const ParticleEmitter& emitter)
+{
+	if (index < 0 || index >= emitters_.size())
+		return;
+	emitters_[index] = emitter;
+	updateEmitterBuffer();
+}
+
+void ParticleSystem::updateEmitterBuffer()
+{
+	if (!emitterMemory_ || emitters_.empty())
+		return;
+	vk::Device device = renderer_->window_->device();
+	uint8_t* memPtr = (uint8_t*)device.mapMemory(emitterMemory_, 0, emitters_.size() * sizeof(ParticleEmitter), {});
+	memcpy(memPtr, emitters_.data(), emitters_.size() * sizeof(ParticleEmitter));
+	device.unmapMemory(emitterMemory_);
+}
+
 void ParticleSystem::run()
 {
 	vk::Device device = renderer_->window_->device();
 
+	// CPU只根据发射速率计算每个发射器本帧的发射数量，粒子的初始化全部在GPU上完成
+	qint64 currentMs = QDateTime::currentMSecsSinceEpoch();
+	double deltaSec = lastEmitMs_ ? (currentMs - lastEmitMs_) / 1000.0 : 0;
+	lastEmitMs_ = currentMs;
+
+	const uint32_t maxSpawnCount = renderer_->window_->physicalDeviceProperties()->limits.maxComputeWorkGroupCount[0] * EMITTER_LOCAL_SIZE;
+	EmitterParams emitterParams = {};
+	uint32_t spawnCount = 0;
+	for (int i = 0; i < emitters_.size(); i++) {
+		emitAccumulator_[i] += emitters_[i].rate * deltaSec;
+		uint32_t num = (uint32_t)emitAccumulator_[i];
+		emitAccumulator_[i] -= num;
+		spawnCount = std::min(spawnCount + num, maxSpawnCount);
+		emitterParams.spawnEnd[i] = spawnCount;
+	}
+	if (currentNumOfParticles + spawnCount > capacity_)
+		reserve(std::max<uint32_t>(capacity_ * 2, currentNumOfParticles + spawnCount));
+
 	vk::CommandBufferAllocateInfo cmdBufferAlllocInfo;
 	cmdBufferAlllocInfo.level = vk::CommandBufferLevel::ePrimary;
 	cmdBufferAlllocInfo.commandPool = renderer_->window_->graphicsCommandPool();
@@ -276,10 +880,22 @@ void ParticleSystem::run()
 	cmdBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
 
 	cmdBuffer.begin(cmdBeginInfo);
-	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, runnerPipline_);
-	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, runnerPiplineLayout_, 0, 1, &descSet_[0], 0, nullptr);
-	int numSqrt = std::ceil(std::sqrt(currentNumOfParticles) / LOCAL_SIZE);
-	cmdBuffer.dispatch(numSqrt, numSqrt, 1);
+	if (spawnCount > 0) {
+		emitterParams.capacity = capacity_;
+		emitterParams.base = currentNumOfParticles;
+		emitterParams.seed = emitSeed_++;
+		emitterParams.emitterCount = emitters_.size();
+		cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, emitterPipline_);
+		cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, emitterPiplineLayout_, 0, 1, &descSet_[1], 0, nullptr);		//binding 1 为当前的输入缓冲区
+		cmdBuffer.pushConstants<EmitterParams>(emitterPiplineLayout_, emitterPushConstant_.stageFlags, 0, emitterParams);
+		cmdBuffer.dispatch((spawnCount + EMITTER_LOCAL_SIZE - 1) / EMITTER_LOCAL_SIZE, 1, 1);
+
+		vk::MemoryBarrier barrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+		cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, barrier, nullptr, nullptr);
+		currentNumOfParticles = std::min<uint32_t>(currentNumOfParticles + spawnCount, capacity_);
+	}
+	if (runnerMode_ != RunnerMode::Cpu)
+		recordRun(cmdBuffer);
 	cmdBuffer.end();
 
 	vk::Queue graphicsQueue = renderer_->window_->graphicsQueue();
@@ -289,7 +905,211 @@ void ParticleSystem::run()
 	graphicsQueue.submit(submitInfo);
 	graphicsQueue.waitIdle();
 	device.freeCommandBuffers(renderer_->window_->graphicsCommandPool(), cmdBuffer);
+	if (runnerMode_ == RunnerMode::Cpu)
+		runCpu();
 	swap();
+	QVkMetricsRegistry::instance().record("particles", currentNumOfParticles, frameCount_++);		//供QVkHudOverlay::addMetricPlot("particles")绘制
+}
+
+void ParticleSystem::runCpu()
+{
+	static ParticleCpuRunner cpuRunner;			//工作线程在多帧之间复用
+	vk::Device device = renderer_->window_->device();
+	uint8_t* memPtr = (uint8_t*)device.mapMemory(bufMemory_, 0, VK_WHOLE_SIZE, {});		//两块缓冲区位于同一内存上，只能映射一次
+	cpuRunner.run(memPtr + descBufInfo_[0].offset, memPtr + descBufInfo_[1].offset, capacity_, storageMode_);
+	device.unmapMemory(bufMemory_);
+}
+
+void ParticleSystem::benchmark(const std::vector<uint32_t>& sizes, int iterations)
+{
+	vk::Device device = renderer_->window_->device();
+	const auto& limits = renderer_->window_->physicalDeviceProperties()->limits;
+	if (!limits.timestampComputeAndGraphics) {
+		qWarning() << "timestamp queries are not supported, skip particle benchmark";
+		return;
+	}
+
+	vk::QueryPoolCreateInfo queryPoolInfo;
+	queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+	queryPoolInfo.queryCount = 2;
+	vk::QueryPool queryPool = device.createQueryPool(queryPoolInfo);
+
+	vk::CommandBufferAllocateInfo cmdBufferAlllocInfo;
+	cmdBufferAlllocInfo.level = vk::CommandBufferLevel::ePrimary;
+	cmdBufferAlllocInfo.commandPool = renderer_->window_->graphicsCommandPool();
+	cmdBufferAlllocInfo.commandBufferCount = 1;
+	vk::Queue graphicsQueue = renderer_->window_->graphicsQueue();
+
+	static const char* storageModeName[] = { "AoS", "SoA", "SoAHalf" };
+	static const char* runnerModeName[] = { "Grid2D", "Compact1D", "Cpu" };
+	qDebug() << "storage:" << storageModeName[(int)storageMode_]
+		<< "simulation bytes/particle:" << 2 * bytesPerParticle(storageMode_)
+		<< "render bytes/particle:" << particleArrays(storageMode_, 0).positionStride;
+
+	RunnerMode lastMode = runnerMode_;
+	bool lastNeighbourEnabled = neighbourEnabled_;
+	std::vector<std::pair<RunnerMode, bool>> modes = { { RunnerMode::Grid2D, false } };
+	if (compactSupported_)
+		modes.push_back({ RunnerMode::Compact1D, false });
+	modes.push_back({ modes.back().first, true });			//附加空间哈希网格邻域搜索
+	modes.push_back({ RunnerMode::Cpu, false });
+
+	for (uint32_t size : sizes) {
+		create(size - std::min<uint32_t>(size, currentNumOfParticles));
+		for (auto [mode, neighbours] : modes) {
+			runnerMode_ = mode;
+			neighbourEnabled_ = neighbours;
+			double totalMs = 0;
+			for (int i = 0; i < iterations && mode == RunnerMode::Cpu; i++) {
+				QElapsedTimer timer;
+				timer.start();
+				runCpu();
+				totalMs += timer.nsecsElapsed() / 1e6;
+				swap();
+			}
+			for (int i = 0; i < iterations && mode != RunnerMode::Cpu; i++) {
+				vk::CommandBuffer cmdBuffer = device.allocateCommandBuffers(cmdBufferAlllocInfo).front();
+				vk::CommandBufferBeginInfo cmdBeginInfo;
+				cmdBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+				cmdBuffer.begin(cmdBeginInfo);
+				cmdBuffer.resetQueryPool(queryPool, 0, 2);
+				cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, 0);
+				recordRun(cmdBuffer);
+				cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, 1);
+				cmdBuffer.end();
+
+				vk::SubmitInfo submitInfo;
+				submitInfo.commandBufferCount = 1;
+				submitInfo.pCommandBuffers = &cmdBuffer;
+				graphicsQueue.submit(submitInfo);
+				graphicsQueue.waitIdle();
+				device.freeCommandBuffers(renderer_->window_->graphicsCommandPool(), cmdBuffer);
+
+				uint64_t time[2];
+				(void)device.getQueryPoolResults(queryPool, 0, 2, sizeof(time), time, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+				totalMs += (time[1] - time[0]) * limits.timestampPeriod / 1e6;
+				swap();
+			}
+			double avgMs = totalMs / iterations;
+			vk::DeviceSize bytes = 2 * bytesPerParticle(storageMode_) * currentNumOfParticles;		//每个存活粒子读写各一次
+			qDebug() << "particles:" << currentNumOfParticles
+				<< "mode:" << runnerModeName[(int)mode]
+				<< "neighbours:" << neighbours
+				<< "storage:" << storageModeName[(int)storageMode_]
+				<< "avg:" << avgMs << "ms"
+				<< "throughput:" << currentNumOfParticles / avgMs / 1e3 << "Mparticles/s"
+				<< "bandwidth:" << bytes / avgMs / 1e6 << "GB/s";
+		}
+	}
+
+	device.destroyQueryPool(queryPool);
+	runnerMode_ = lastMode;
+	neighbourEnabled_ = lastNeighbourEnabled;
+
+	currentNumOfParticles = 0;
+	int reset = 0;
+	uint8_t* memPtr = (uint8_t*)device.mapMemory(bufMemory_, descBufInfo_[0].offset, sizeof(int), {});
+	memcpy(memPtr, &reset, sizeof(int));
+	device.unmapMemory(bufMemory_);
+}
+
+static std::vector<std::array<float, 7>> readParticles(const uint8_t* memPtr, ParticleSystem::StorageMode mode, uint32_t capacity)
+{
+	ParticleArrays arrays = particleArrays(mode, capacity);
+	int count;
+	memcpy(&count, memPtr, sizeof(int));
+	std::vector<std::array<float, 7>> particles(count);
+	for (int i = 0; i < count; i++) {
+		auto& particle = particles[i];
+		memcpy(particle.data(), memPtr + arrays.positionOffset + i * arrays.positionStride, 3 * sizeof(float));
+		if (mode == ParticleSystem::StorageMode::SoAHalf) {
+			qfloat16 velocityLife[4];
+			memcpy(velocityLife, memPtr + arrays.velocityOffset + i * arrays.velocityStride, sizeof(velocityLife));
+			for (int k = 0; k < 4; k++)
+				particle[3 + k] = velocityLife[k];
+		}
+		else {
+			memcpy(particle.data() + 3, memPtr + arrays.velocityOffset + i * arrays.velocityStride, 3 * sizeof(float));
+			memcpy(particle.data() + 6, memPtr + arrays.lifeOffset + i * arrays.lifeStride, sizeof(float));
+		}
+	}
+	std::sort(particles.begin(), particles.end());			//GPU上的压缩顺序不确定，排序后再逐个比较
+	return particles;
+}
+
+bool ParticleSystem::validate(uint32_t count, int steps)
+{
+	vk::Device device = renderer_->window_->device();
+	vk::Queue graphicsQueue = renderer_->window_->graphicsQueue();
+	RunnerMode lastMode = runnerMode_;
+	bool lastNeighbourEnabled = neighbourEnabled_;
+	if (runnerMode_ == RunnerMode::Cpu)
+		runnerMode_ = compactSupported_ ? RunnerMode::Compact1D : RunnerMode::Grid2D;
+	neighbourEnabled_ = false;
+
+	vk::CommandBufferAllocateInfo cmdBufferAlllocInfo;
+	cmdBufferAlllocInfo.level = vk::CommandBufferLevel::ePrimary;
+	cmdBufferAlllocInfo.commandPool = renderer_->window_->graphicsCommandPool();
+	cmdBufferAlllocInfo.commandBufferCount = 1;
+
+	ParticleCpuRunner cpuRunner;
+	const float tolerance = storageMode_ == StorageMode::SoAHalf ? 1e-3f : 1e-6f;
+	const int batches = 4;			//分批加入粒子，使后续的压缩中既有存活也有死亡的粒子
+	float maxError = 0;
+	bool passed = true;
+	for (int batch = 0; batch < batches && passed; batch++) {
+		create(count / batches);
+		ParticleArrays arrays = particleArrays(storageMode_, capacity_);
+		std::vector<uint8_t> cpuBuffer[2] = { std::vector<uint8_t>(arrays.size), std::vector<uint8_t>(arrays.size) };
+		uint8_t* memPtr = (uint8_t*)device.mapMemory(bufMemory_, descBufInfo_[0].offset, arrays.size, {});
+		memcpy(cpuBuffer[0].data(), memPtr, arrays.size);
+		device.unmapMemory(bufMemory_);
+
+		for (int i = 0; i < steps / batches; i++) {
+			vk::CommandBuffer cmdBuffer = device.allocateCommandBuffers(cmdBufferAlllocInfo).front();
+			vk::CommandBufferBeginInfo cmdBeginInfo;
+			cmdBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+			cmdBuffer.begin(cmdBeginInfo);
+			recordRun(cmdBuffer);
+			cmdBuffer.end();
+
+			vk::SubmitInfo submitInfo;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &cmdBuffer;
+			graphicsQueue.submit(submitInfo);
+			graphicsQueue.waitIdle();
+			device.freeCommandBuffers(renderer_->window_->graphicsCommandPool(), cmdBuffer);
+			swap();
+
+			cpuRunner.run(cpuBuffer[0].data(), cpuBuffer[1].data(), capacity_, storageMode_);
+			std::swap(cpuBuffer[0], cpuBuffer[1]);
+		}
+
+		memPtr = (uint8_t*)device.mapMemory(bufMemory_, descBufInfo_[0].offset, arrays.size, {});
+		std::vector<std::array<float, 7>> gpuParticles = readParticles(memPtr, storageMode_, capacity_);
+		device.unmapMemory(bufMemory_);
+		std::vector<std::array<float, 7>> cpuParticles = readParticles(cpuBuffer[0].data(), storageMode_, capacity_);
+
+		if (gpuParticles.size() != cpuParticles.size()) {
+			qWarning() << "particle validation: GPU count" << gpuParticles.size() << "!= CPU count" << cpuParticles.size();
+			passed = false;
+			break;
+		}
+		for (size_t i = 0; i < gpuParticles.size(); i++) {
+			for (int k = 0; k < 7; k++)
+				maxError = std::max(maxError, std::abs(gpuParticles[i][k] - cpuParticles[i][k]));
+		}
+		passed = maxError <= tolerance;
+	}
+
+	runnerMode_ = lastMode;
+	neighbourEnabled_ = lastNeighbourEnabled;
+	static const char* storageModeName[] = { "AoS", "SoA", "SoAHalf" };
+	if (passed)
+		qDebug() << "particle validation passed, storage:" << storageModeName[(int)storageMode_] << "steps:" << steps << "max error:" << maxError;
+	else
+		qWarning() << "particle validation failed, storage:" << storageModeName[(int)storageMode_] << "max error:" << maxError << "tolerance:" << tolerance;
+	return passed;
 }
 
 void ParticleSystem::swap()
@@ -308,12 +1128,79 @@ void ParticleSystem::swap()
 	std::swap(descSet_[0], descSet_[1]);
 }
 
+void ParticleSystem::setSortEnabled(bool enabled)
+{
+	sortEnabled_ = enabled;
+}
+
+void ParticleSystem::recordSort(vk::CommandBuffer cmdBuffer, const QMatrix4x4& viewProjection)
+{
+	vk::Device device = renderer_->window_->device();
+	const auto& limits = renderer_->window_->physicalDeviceProperties()->limits;
+	const int frame = renderer_->window_->currentFrame();
+
+	// 读取上一次使用该帧槽位时写入的时间戳，QVulkanWindow在此之前已等待过该槽位的栅栏，因此不会阻塞
+	if (sortQueryPool_) {
+		uint64_t time[2];
+		if (sortQueryValid_[frame] && device.getQueryPoolResults(sortQueryPool_, frame * 2, 2, sizeof(time), time, sizeof(uint64_t), vk::QueryResultFlagBits::e64) == vk::Result::eSuccess)
+			sortTimeMs_ = (time[1] - time[0]) * limits.timestampPeriod / 1e6;
+		cmdBuffer.resetQueryPool(sortQueryPool_, frame * 2, 2);
+		cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, sortQueryPool_, frame * 2);
+	}
+
+	const uint32_t paddedCount = nextPowerOfTwo(std::max<uint32_t>(currentNumOfParticles, SORT_LOCAL_SIZE));
+	const uint32_t groupCount = paddedCount / SORT_LOCAL_SIZE;
+	const uint32_t groupCountX = std::min<uint32_t>(groupCount, 32768);		//2的幂，保证二维派发恰好覆盖所有元素
+	const uint32_t groupCountY = groupCount / groupCountX;
+
+	SortParams params = {};
+	params.capacity = capacity_;
+	params.count = currentNumOfParticles;
+	memcpy(params.viewProjection, viewProjection.constData(), sizeof(params.viewProjection));
+
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, sortPipline_);
+	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, sortPiplineLayout_, 0, 1, &descSet_[0], 0, nullptr);
+
+	vk::MemoryBarrier barrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+	auto dispatchPass = [&](uint32_t pass, uint32_t k, uint32_t j) {
+		params.pass = pass;
+		params.k = k;
+		params.j = j;
+		cmdBuffer.pushConstants<SortParams>(sortPiplineLayout_, sortPushConstant_.stageFlags, 0, params);
+		cmdBuffer.dispatch(groupCountX, groupCountY, 1);
+		cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, barrier, nullptr, nullptr);
+	};
+
+	// 双调排序：工作组内的步骤在共享内存中完成，只有跨工作组的步骤需要单独派发
+	dispatchPass(SORT_PASS_KEYS, 0, 0);
+	dispatchPass(SORT_PASS_LOCAL_SORT, 0, 0);
+	for (uint32_t k = SORT_LOCAL_SIZE * 2; k <= paddedCount; k <<= 1) {
+		for (uint32_t j = k >> 1; j >= SORT_LOCAL_SIZE; j >>= 1)
+			dispatchPass(SORT_PASS_GLOBAL_STEP, k, j);
+		dispatchPass(SORT_PASS_LOCAL_MERGE, k, 0);
+	}
+
+	if (sortQueryPool_) {
+		cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, sortQueryPool_, frame * 2 + 1);
+		sortQueryValid_[frame] = true;
+	}
+
+	vk::MemoryBarrier vertexBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead);
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eVertexShader, {}, vertexBarrier, nullptr, nullptr);
+}
+
 void ParticleSystem::render()
 {
 	vk::Device device = renderer_->window_->device();
 	vk::CommandBuffer cmdBuffer = renderer_->window_->currentCommandBuffer();
 	const QSize size = renderer_->window_->swapChainImageSize();
 
+	QMatrix4x4 view;
+	view *= renderer_->window_->camera_.getMatrix();
+
+	if (sortEnabled_ && currentNumOfParticles > 0)
+		recordSort(cmdBuffer, view);
+
 	vk::ClearValue clearValues[3] = {
 		vk::ClearColorValue(std::array<float,4>{0.0f,0.5f,0.9f,1.0f }),
 		vk::ClearDepthStencilValue(1.0f,0),
@@ -346,16 +1233,33 @@ void ParticleSystem::render()
 	scissor.extent.height = size.height();
 	cmdBuffer.setScissor(0, scissor);
 
-	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, renderPipline_);
+	if (sortEnabled_) {
+		cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, billboardPipline_);
+		cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, billboardPiplineLayout_, 0, 1, &descSet_[0], 0, nullptr);
+
+		BillboardParams params;
+		memcpy(params.viewProjection, view.constData(), sizeof(params.viewProjection));
+		const QMatrix4x4 projection = renderer_->window_->camera_.getProjection();
+		params.billboardScale[0] = BILLBOARD_SIZE * projection(0, 0);
+		params.billboardScale[1] = BILLBOARD_SIZE * projection(1, 1);
+		cmdBuffer.pushConstants<BillboardParams>(billboardPiplineLayout_, billboardPushConstant_.stageFlags, 0, params);
+
+		cmdBuffer.draw(6, currentNumOfParticles, 0, 0);
+		if (++sortStatsFrames_ >= SORT_STATS_INTERVAL) {
+			qDebug() << currentNumOfParticles << "sort:" << sortTimeMs_ << "ms";
+			sortStatsFrames_ = 0;
+		}
+	}
+	else {
+		cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, renderPipline_);
 
-	cmdBuffer.bindVertexBuffers(0, buffer_, { descBufInfo_[0].offset });
+		cmdBuffer.bindVertexBuffers(0, buffer_, { descBufInfo_[0].offset });
 
-	QMatrix4x4 view;
-	view *= camera.getMatrix();
-	cmdBuffer.pushConstants<QMatrix4x4>(renderPiplineLayout_, pushConstant_.stageFlags, 0, view);
+		cmdBuffer.pushConstants<QMatrix4x4>(renderPiplineLayout_, pushConstant_.stageFlags, 0, view);
 
-	cmdBuffer.draw(currentNumOfParticles, 1, 0, 0);
-	qDebug() << currentNumOfParticles;
+		cmdBuffer.draw(currentNumOfParticles, 1, 0, 0);
+		qDebug() << currentNumOfParticles;
+	}
 	cmdBuffer.endRenderPass();
 }
 
@@ -366,8 +1270,28 @@ void ParticleSystem::releaseResource()
 	device.freeMemory(bufMemory_);
 	device.destroyDescriptorSetLayout(descSetLayout_);
 	device.destroyDescriptorPool(descPool_);
+	device.destroyBuffer(emitterBuffer_);
+	device.freeMemory(emitterMemory_);
+	device.destroyPipeline(emitterPipline_);
+	device.destroyPipelineLayout(emitterPiplineLayout_);
 	device.destroyPipeline(runnerPipline_);
+	if (compactPipline_)
+		device.destroyPipeline(compactPipline_);
 	device.destroyPipelineLayout(runnerPiplineLayout_);
 	device.destroyPipeline(renderPipline_);
 	device.destroyPipelineLayout(renderPiplineLayout_);
+	device.destroyBuffer(sortBuffer_);
+	device.freeMemory(sortMemory_);
+	device.destroyBuffer(forceBuffer_);
+	device.freeMemory(forceMemory_);
+	device.destroyBuffer(gridBuffer_);
+	device.freeMemory(gridMemory_);
+	device.destroyPipeline(gridPipline_);
+	device.destroyPipelineLayout(gridPiplineLayout_);
+	device.destroyPipeline(sortPipline_);
+	device.destroyPipelineLayout(sortPiplineLayout_);
+	device.destroyPipeline(billboardPipline_);
+	device.destroyPipelineLayout(billboardPiplineLayout_);
+	if (sortQueryPool_)
+		device.destroyQueryPool(sortQueryPool_);
 }
@@ -6,17 +6,81 @@
 
 class ParticlesRenderer;
 
+struct ParticleEmitter				//与particle_emitter.comp中的Emitter保持std140布局一致
+{
+	enum Shape : uint32_t {
+		Point = 0,
+		Sphere = 1,
+		Box = 2
+	};
+	QVector3D position;
+	uint32_t shape = Point;
+	QVector3D extent;				//球体半径取x，盒子取半边长
+	float coneAngle = 0;			//速度方向的圆锥半角（弧度）
+	QVector3D direction = QVector3D(0, 1, 0);
+	float rate = 0;					//每秒发射数量
+	float speedRange[2] = { 0, 0 };
+	float lifeRange[2] = { 0, 0 };
+};
+
+struct NeighbourParams				//空间哈希网格上的boids参数
+{
+	float cellSize = 0.05f;
+	float radius = 0.05f;			//不大于cellSize时只需遍历相邻的27个单元
+	uint32_t maxNeighbours = 32;	//限制每个粒子处理的邻居数，保证开销与粒子数成线性关系
+	float separation = 1e-6f;
+	float alignment = 0.05f;
+	float cohesion = 0.001f;
+};
 
 class ParticleSystem
 {
 public:
+	enum class RunnerMode {
+		Grid2D,			//二维工作组网格，全局原子计数
+		Compact1D,		//一维派发，子组ballot前缀和压缩
+		Cpu				//ParticleCpuRunner，发射器仍在GPU上运行，不支持邻域力
+	};
+
+	enum class StorageMode {
+		AoS,			//Particle结构体数组，每个粒子32字节
+		SoA,			//位置、速度、生命分别存放在独立数组中
+		SoAHalf			//位置为fp32，速度与生命打包为4个f16
+	};
+
 	ParticleSystem(ParticlesRenderer* window);
 	void initResource();
+	StorageMode storageMode() const { return storageMode_; }
+	void setStorageMode(StorageMode mode);
 	void create(int num);
+	void reserve(uint32_t capacity);
+	uint32_t capacity() const { return capacity_; }
+	int addEmitter(const ParticleEmitter& emitter);
+	void setEmitter(int index, const ParticleEmitter& emitter);
+	int emitterCount() const { return (int)emitters_.size(); }
 	void run();
+	void benchmark(const std::vector<uint32_t>& sizes, int iterations);
+	bool validate(uint32_t count, int steps);
+	RunnerMode runnerMode() const { return runnerMode_; }
+	void setRunnerMode(RunnerMode mode);
+	bool neighbourEnabled() const { return neighbourEnabled_; }
+	void setNeighbourEnabled(bool enabled);
+	const NeighbourParams& neighbourParams() const { return neighbourParams_; }
+	void setNeighbourParams(const NeighbourParams& params);
 	void swap();
 	void render();
+	bool sortEnabled() const { return sortEnabled_; }
+	void setSortEnabled(bool enabled);
+	double sortTimeMs() const { return sortTimeMs_; }
 	void releaseResource();
+private:
+	void createBuffer(uint32_t capacity);
+	void createStorageBuffer(vk::DeviceSize size, uint32_t binding, vk::Buffer& buffer, vk::DeviceMemory& memory);
+	void recordNeighbours(vk::CommandBuffer cmdBuffer);
+	void recordRun(vk::CommandBuffer cmdBuffer);
+	void runCpu();
+	void updateEmitterBuffer();
+	void recordSort(vk::CommandBuffer cmdBuffer, const QMatrix4x4& viewProjection);
 private:
 	ParticlesRenderer* renderer_;
 	vk::Buffer buffer_;
@@ -29,13 +93,53 @@ private:
 
 	vk::PipelineLayout runnerPiplineLayout_;
 	vk::Pipeline runnerPipline_;
+	vk::PushConstantRange runnerPushConstant_;
+	vk::Pipeline compactPipline_;
+	bool compactSupported_ = false;
+	RunnerMode runnerMode_ = RunnerMode::Compact1D;
+
+	vk::Buffer forceBuffer_;
+	vk::DeviceMemory forceMemory_;
+	vk::Buffer gridBuffer_;
+	vk::DeviceMemory gridMemory_;
+	vk::PipelineLayout gridPiplineLayout_;
+	vk::Pipeline gridPipline_;
+	vk::PushConstantRange gridPushConstant_;
+	NeighbourParams neighbourParams_;
+	bool neighbourEnabled_ = false;
+
+	vk::Buffer emitterBuffer_;
+	vk::DeviceMemory emitterMemory_;
+	vk::PipelineLayout emitterPiplineLayout_;
+	vk::Pipeline emitterPipline_;
+	vk::PushConstantRange emitterPushConstant_;
+	std::vector<ParticleEmitter> emitters_;
+	std::vector<double> emitAccumulator_;		//每个发射器未满一个粒子的发射量
+	qint64 lastEmitMs_ = 0;
+	uint32_t emitSeed_ = 0;
 
 	vk::PipelineLayout renderPiplineLayout_;
 	vk::Pipeline renderPipline_;
 	vk::PushConstantRange pushConstant_;
 
-	int currentNumOfParticles = 0;
+	vk::Buffer sortBuffer_;
+	vk::DeviceMemory sortMemory_;
+	vk::PipelineLayout sortPiplineLayout_;
+	vk::Pipeline sortPipline_;
+	vk::PushConstantRange sortPushConstant_;
+	vk::PipelineLayout billboardPiplineLayout_;
+	vk::Pipeline billboardPipline_;
+	vk::PushConstantRange billboardPushConstant_;
+	vk::QueryPool sortQueryPool_;
+	std::array<bool, QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT> sortQueryValid_;
+	bool sortEnabled_ = false;
+	double sortTimeMs_ = 0;
+	int sortStatsFrames_ = 0;
 
-	QFpsCamera camera;
+	StorageMode storageMode_ = StorageMode::AoS;
+	int currentNumOfParticles = 0;
+	uint32_t capacity_ = 0;
+	uint32_t maxCapacity_ = 0;
+	uint64_t frameCount_ = 0;
 };
 
@@ -13,6 +13,7 @@ public:
 	~QFpsCamera();
 	void setup(QVulkanWindow* window);
 	QMatrix4x4 getMatrix() const;
+	QMatrix4x4 getProjection() const { return projection_; }
 	float getMoveSpeed() const { return moveSpeed_; }
 	void setMoveSpeed(float val) { moveSpeed_ = val; }
 	float getRotationSensitivity() const { return rotationSensitivity_; }
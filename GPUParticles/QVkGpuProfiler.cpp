@@ -0,0 +1,262 @@
+#include "QVkGpuProfiler.h"
+#include <QDebug>
+#include <algorithm>
+#include "QVkTraceRecorder.h"
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+#define CALIBRATION_PROPERTY "qvkCalibratedTimestamps"
+#define DEVICE_EXTENSIONS_PROPERTY "qvkDeviceExtensions"		//QVulkanWindow无法读回设备扩展列表，已请求的扩展记录在窗口属性中
+#define CALIBRATION_INTERVAL_NS 1000000000ll			//每秒重新校准一次，抵消GPU与CPU时钟的漂移
+
+double QVkGpuProfiler::FrameResult::scopeMs(const QByteArray& name) const
+{
+	double ms = 0.0;
+	for (const ScopeResult& scope : scopes) {
+		if (scope.name == name)
+			ms += scope.durationMs;
+	}
+	return ms;
+}
+
+QVkGpuProfiler::Scope::Scope(QVkGpuProfiler* profiler, vk::CommandBuffer cmdBuffer, const char* name)
+	: profiler_(profiler)
+	, cmdBuffer_(cmdBuffer)
+	, scope_(profiler ? profiler->beginScope(cmdBuffer, name) : -1)
+{
+}
+
+QVkGpuProfiler::Scope::~Scope()
+{
+	if (profiler_)
+		profiler_->endScope(cmdBuffer_, scope_);
+}
+
+void QVkGpuProfiler::enableCalibratedTimestamps(QVulkanWindow* window)
+{
+	// 设备支持时追加到已请求的设备扩展之后，不覆盖其他扩展
+	if (!window->supportedDeviceExtensions().contains(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME))
+		return;
+	QByteArrayList extensions = window->property(DEVICE_EXTENSIONS_PROPERTY).value<QByteArrayList>();
+	if (!extensions.contains(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME))
+		extensions.append(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+	window->setDeviceExtensions(extensions);
+	window->setProperty(DEVICE_EXTENSIONS_PROPERTY, QVariant::fromValue(extensions));
+	window->setProperty(CALIBRATION_PROPERTY, true);
+}
+
+QVkGpuProfiler::QVkGpuProfiler(QVulkanWindow* window, int maxScopes)
+	: window_(window)
+	, maxScopes_(std::max(maxScopes, 1))
+{
+}
+
+QVkGpuProfiler::~QVkGpuProfiler()
+{
+	releaseResources();
+}
+
+void QVkGpuProfiler::initResources()
+{
+	releaseResources();
+	const VkPhysicalDeviceLimits& limits = window_->physicalDeviceProperties()->limits;
+	vk::PhysicalDevice physicalDevice = window_->physicalDevice();
+	const uint32_t validBits = physicalDevice.getQueueFamilyProperties()[window_->graphicsQueueFamilyIndex()].timestampValidBits;
+	if (validBits == 0 || limits.timestampPeriod <= 0.0f) {
+		qWarning() << "QVkGpuProfiler: Timestamp queries are not supported on the graphics queue";
+		return;
+	}
+	timestampPeriod_ = limits.timestampPeriod;
+	timestampMask_ = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	vk::Device device = window_->device();
+	vk::QueryPoolCreateInfo queryPoolInfo;
+	queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+	queryPoolInfo.queryCount = maxScopes_ * 2;
+	frames_.resize(window_->concurrentFrameCount());
+	for (FrameSlot& slot : frames_) {
+		slot.pool = device.createQueryPool(queryPoolInfo);
+		slot.scopes.reserve(maxScopes_);
+	}
+	queryData_.resize(maxScopes_ * 4);			//每个查询一个值加一个可用性标志
+
+	// 主机时间域须与QVkTraceRecorder::nowNs使用的steady_clock一致
+#ifdef Q_OS_WIN
+	const vk::TimeDomainEXT hostTimeDomain = vk::TimeDomainEXT::eQueryPerformanceCounter;
+#else
+	const vk::TimeDomainEXT hostTimeDomain = vk::TimeDomainEXT::eClockMonotonic;
+#endif
+	hostTimeDomain_.reset();
+	if (window_->property(CALIBRATION_PROPERTY).toBool() && window_->supportedDeviceExtensions().contains(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)) {
+		const std::vector<vk::TimeDomainEXT> timeDomains = physicalDevice.getCalibrateableTimeDomainsEXT();
+		if (std::find(timeDomains.begin(), timeDomains.end(), vk::TimeDomainEXT::eDevice) != timeDomains.end()
+			&& std::find(timeDomains.begin(), timeDomains.end(), hostTimeDomain) != timeDomains.end())
+			hostTimeDomain_ = hostTimeDomain;
+	}
+	if (!hostTimeDomain_ || !calibrate()) {
+		hostTimeDomain_.reset();
+		calibrateBySubmit();
+	}
+}
+
+bool QVkGpuProfiler::calibrate()
+{
+	vk::CalibratedTimestampInfoEXT timestampInfos[2];
+	timestampInfos[0].timeDomain = vk::TimeDomainEXT::eDevice;
+	timestampInfos[1].timeDomain = *hostTimeDomain_;
+	uint64_t timestamps[2];
+	uint64_t maxDeviation;
+	vk::Device device = window_->device();
+	if (device.getCalibratedTimestampsEXT(2, timestampInfos, timestamps, &maxDeviation) != vk::Result::eSuccess)
+		return false;
+	calibrationTimestamp_ = timestamps[0] & timestampMask_;
+#ifdef Q_OS_WIN
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	const int64_t ticks = timestamps[1];
+	calibrationHostNs_ = ticks / frequency.QuadPart * 1000000000ll + ticks % frequency.QuadPart * 1000000000ll / frequency.QuadPart;
+#else
+	calibrationHostNs_ = timestamps[1];
+#endif
+	return true;
+}
+
+void QVkGpuProfiler::calibrateBySubmit()
+{
+	// 没有扩展时提交一个只写时间戳的命令缓冲区并等待，取提交前后的中点作为对应的主机时间，误差不超过往返时间的一半
+	vk::Device device = window_->device();
+	vk::CommandBufferAllocateInfo cmdBufferAllocInfo;
+	cmdBufferAllocInfo.commandBufferCount = 1;
+	cmdBufferAllocInfo.commandPool = window_->graphicsCommandPool();
+	cmdBufferAllocInfo.level = vk::CommandBufferLevel::ePrimary;
+	vk::CommandBuffer cmdBuffer = device.allocateCommandBuffers(cmdBufferAllocInfo).front();
+	vk::CommandBufferBeginInfo cmdBufferBeginInfo;
+	cmdBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	cmdBuffer.begin(cmdBufferBeginInfo);
+	cmdBuffer.resetQueryPool(frames_[0].pool, 0, 1);
+	cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, frames_[0].pool, 0);
+	cmdBuffer.end();
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmdBuffer;
+	vk::Queue queue = window_->graphicsQueue();
+	const int64_t submitNs = QVkTraceRecorder::nowNs();
+	queue.submit(submitInfo);
+	queue.waitIdle();
+	const int64_t doneNs = QVkTraceRecorder::nowNs();
+
+	uint64_t timestamp = 0;
+	device.getQueryPoolResults(frames_[0].pool, 0, 1, sizeof(uint64_t), &timestamp, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+	device.freeCommandBuffers(window_->graphicsCommandPool(), cmdBuffer);
+	calibrationTimestamp_ = timestamp & timestampMask_;
+	calibrationHostNs_ = submitNs + (doneNs - submitNs) / 2;
+}
+
+int64_t QVkGpuProfiler::toHostNs(uint64_t timestamp) const
+{
+	// 按有效位数做符号扩展，时间戳可以早于校准点
+	int64_t ticks = int64_t((timestamp - calibrationTimestamp_) & timestampMask_);
+	if (timestampMask_ != ~0ull && uint64_t(ticks) > (timestampMask_ >> 1))
+		ticks -= int64_t(timestampMask_) + 1;
+	return calibrationHostNs_ + int64_t(ticks * timestampPeriod_);
+}
+
+void QVkGpuProfiler::releaseResources()
+{
+	if (frames_.empty())
+		return;
+	vk::Device device = window_->device();
+	for (FrameSlot& slot : frames_)
+		device.destroyQueryPool(slot.pool);
+	frames_.clear();
+	current_ = nullptr;
+	depth_ = 0;
+}
+
+void QVkGpuProfiler::beginFrame(vk::CommandBuffer cmdBuffer)
+{
+	current_ = nullptr;
+	if (!enabled_ || frames_.empty())
+		return;
+	FrameSlot& slot = frames_[window_->currentFrame() % frames_.size()];
+	if (slot.recorded)
+		collect(slot);
+	if (hostTimeDomain_ && QVkTraceRecorder::nowNs() - calibrationHostNs_ > CALIBRATION_INTERVAL_NS)
+		calibrate();
+
+	cmdBuffer.resetQueryPool(slot.pool, 0, maxScopes_ * 2);
+	slot.scopes.clear();
+	slot.frameIndex = frameCount_++;
+	slot.recorded = true;
+	current_ = &slot;
+	depth_ = 0;
+	beginScope(cmdBuffer, "Frame");
+}
+
+void QVkGpuProfiler::endFrame(vk::CommandBuffer cmdBuffer)
+{
+	if (!isRecording())
+		return;
+	endScope(cmdBuffer, 0);
+	current_ = nullptr;
+}
+
+int QVkGpuProfiler::beginScope(vk::CommandBuffer cmdBuffer, const char* name, vk::PipelineStageFlagBits stage)
+{
+	if (!isRecording() || current_->scopes.size() >= maxScopes_)
+		return -1;
+	const int scope = current_->scopes.size();
+	current_->scopes.push_back({ name, depth_++, false });
+	cmdBuffer.writeTimestamp(stage, current_->pool, scope * 2);
+	return scope;
+}
+
+void QVkGpuProfiler::endScope(vk::CommandBuffer cmdBuffer, int scope, vk::PipelineStageFlagBits stage)
+{
+	if (!isRecording() || scope < 0 || scope >= current_->scopes.size() || current_->scopes[scope].closed)
+		return;
+	cmdBuffer.writeTimestamp(stage, current_->pool, scope * 2 + 1);
+	current_->scopes[scope].closed = true;
+	depth_ = current_->scopes[scope].depth;
+}
+
+void QVkGpuProfiler::collect(FrameSlot& slot)
+{
+	slot.recorded = false;
+	const uint32_t queryCount = slot.scopes.size() * 2;
+	if (queryCount == 0)
+		return;
+	// 不带eWait：未就绪时返回eNotReady，丢弃这一帧而不是等待
+	vk::Device device = window_->device();
+	const vk::Result result = device.getQueryPoolResults(slot.pool, 0, queryCount, queryCount * 2 * sizeof(uint64_t), queryData_.data(), 2 * sizeof(uint64_t),
+		vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+	auto available = [this](int query) { return queryData_[query * 2 + 1] != 0; };
+	auto timestamp = [this](int query) { return queryData_[query * 2] & timestampMask_; };
+	if ((result != vk::Result::eSuccess && result != vk::Result::eNotReady) || !available(0) || !available(1)) {
+		droppedFrameCount_++;
+		return;
+	}
+
+	const uint64_t base = timestamp(0);
+	const double msPerTick = timestampPeriod_ / 1e6;
+	lastResult_.frameIndex = slot.frameIndex;
+	lastResult_.hostBeginNs = toHostNs(base);
+	lastResult_.scopes.clear();
+	for (int i = 0; i < slot.scopes.size(); i++) {
+		if (!slot.scopes[i].closed || !available(i * 2) || !available(i * 2 + 1))
+			continue;					//未结束的区间没有结束时间戳
+		const uint64_t begin = timestamp(i * 2);
+		const uint64_t end = timestamp(i * 2 + 1);
+		lastResult_.scopes.push_back({ QByteArray(slot.scopes[i].name), slot.scopes[i].depth, ((begin - base) & timestampMask_) * msPerTick, ((end - begin) & timestampMask_) * msPerTick });
+	}
+	if (callback_)
+		callback_(lastResult_);
+	QVkTraceRecorder& recorder = QVkTraceRecorder::instance();
+	if (recorder.isRecording())
+		recorder.addGpuFrame(lastResult_);
+}
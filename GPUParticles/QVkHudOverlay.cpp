@@ -0,0 +1,321 @@
+#include "QVkHudOverlay.h"
+#include <QDebug>
+#include <QVersionNumber>
+#include <QVulkanInstance>
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include "imgui.h"
+#include "backends/imgui_impl_vulkan.h"
+#include "QVkMetricsRegistry.h"
+
+#define HUD_MEMORY_INTERVAL_MS 250			//显存占用的刷新间隔
+
+void QVkHudOverlay::History::push(float value)
+{
+	if (values.empty())
+		return;
+	values[offset] = value;
+	offset = (offset + 1) % values.size();
+	count = std::min<int>(count + 1, values.size());
+}
+
+float QVkHudOverlay::History::last() const
+{
+	return count ? values[(offset + values.size() - 1) % values.size()] : 0.0f;
+}
+
+float QVkHudOverlay::History::max() const
+{
+	return count ? *std::max_element(values.begin(), values.begin() + count) : 0.0f;
+}
+
+float QVkHudOverlay::History::average() const
+{
+	float sum = 0.0f;
+	for (int i = 0; i < count; i++)
+		sum += values[i];
+	return count ? sum / count : 0.0f;
+}
+
+QVkHudOverlay::QVkHudOverlay(int historySize)
+	: historySize_(std::max(historySize, 2))
+{
+	cpuFrameMs_.values.resize(historySize_);
+	gpuFrameMs_.values.resize(historySize_);
+	memoryMb_.values.resize(historySize_);
+}
+
+QVkHudOverlay::~QVkHudOverlay()
+{
+	if (context_)
+		ImGui::DestroyContext(context_);
+}
+
+void QVkHudOverlay::addMetricPlot(const QByteArray& name)
+{
+	History history;
+	history.values.resize(historySize_);
+	metrics_.push_back({ name, history });
+}
+
+void QVkHudOverlay::initResources()
+{
+	enabled_ = false;
+	if (window_->sampleCountFlagBits() != VK_SAMPLE_COUNT_1_BIT) {
+		qWarning() << "QVkHudOverlay: Multisampled windows are not supported, the overlay is disabled";
+		return;
+	}
+	if (!context_) {
+		IMGUI_CHECKVERSION();
+		context_ = ImGui::CreateContext();
+		ImGui::SetCurrentContext(context_);
+		ImGuiIO& io = ImGui::GetIO();
+		io.IniFilename = nullptr;				//不写imgui.ini
+		ImGui::StyleColorsDark();
+	}
+	ImGui::SetCurrentContext(context_);
+
+	// imgui_impl_vulkan以IMGUI_IMPL_VULKAN_NO_PROTOTYPES编译，函数通过QVulkanInstance加载
+	ImGui_ImplVulkan_LoadFunctions([](const char* name, void* userData) {
+		return static_cast<QVulkanInstance*>(userData)->getInstanceProcAddr(name);
+	}, window_->vulkanInstance());
+
+	vk::Device device = window_->device();
+	createRenderPass();
+	vk::DescriptorPoolSize descPoolSize(vk::DescriptorType::eCombinedImageSampler, 1);		//只有字体纹理
+	vk::DescriptorPoolCreateInfo descPoolInfo;
+	descPoolInfo.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
+	descPoolInfo.maxSets = 1;
+	descPoolInfo.poolSizeCount = 1;
+	descPoolInfo.pPoolSizes = &descPoolSize;
+	descPool_ = device.createDescriptorPool(descPoolInfo);
+
+	const uint32_t frameCount = std::max(window_->concurrentFrameCount(), 2);
+	ImGui_ImplVulkan_InitInfo initInfo = {};
+	initInfo.Instance = window_->vulkanInstance()->vkInstance();
+	initInfo.PhysicalDevice = window_->physicalDevice();
+	initInfo.Device = device;
+	initInfo.QueueFamily = window_->graphicsQueueFamilyIndex();
+	initInfo.Queue = window_->graphicsQueue();
+	initInfo.DescriptorPool = descPool_;
+	initInfo.Subpass = 0;
+	initInfo.MinImageCount = 2;
+	initInfo.ImageCount = frameCount;		//每录制一次轮换一组顶点/索引缓冲区，数量不少于同时在途的帧数即可
+	initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+	ImGui_ImplVulkan_Init(&initInfo, renderPass_);
+	uploadFonts();
+
+	// 显存预算需要VK_EXT_memory_budget与Vulkan 1.1的vkGetPhysicalDeviceMemoryProperties2
+	memoryBudgetSupported_ = window_->supportedDeviceExtensions().contains(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)
+		&& window_->vulkanInstance()->apiVersion() >= QVersionNumber(1, 1);
+	memoryTimer_.invalidate();
+	frameTimer_.invalidate();
+	enabled_ = true;
+}
+
+void QVkHudOverlay::createRenderPass()
+{
+	// 与默认渲染通道兼容（附件格式与采样数一致），颜色使用eLoad保留场景内容
+	vk::AttachmentDescription attachments[2];
+	attachments[0].format = (vk::Format)window_->colorFormat();
+	attachments[0].samples = vk::SampleCountFlagBits::e1;
+	attachments[0].loadOp = vk::AttachmentLoadOp::eLoad;
+	attachments[0].storeOp = vk::AttachmentStoreOp::eStore;
+	attachments[0].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+	attachments[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+	attachments[0].initialLayout = vk::ImageLayout::ePresentSrcKHR;
+	attachments[0].finalLayout = vk::ImageLayout::ePresentSrcKHR;
+
+	attachments[1].format = (vk::Format)window_->depthStencilFormat();
+	attachments[1].samples = vk::SampleCountFlagBits::e1;
+	attachments[1].loadOp = vk::AttachmentLoadOp::eDontCare;
+	attachments[1].storeOp = vk::AttachmentStoreOp::eDontCare;
+	attachments[1].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+	attachments[1].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+	attachments[1].initialLayout = vk::ImageLayout::eUndefined;
+	attachments[1].finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+	vk::AttachmentReference colorRef(0, vk::ImageLayout::eColorAttachmentOptimal);
+	vk::AttachmentReference depthRef(1, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+	vk::SubpassDescription subpass;
+	subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorRef;
+	subpass.pDepthStencilAttachment = &depthRef;
+
+	// 等待之前的渲染器写完颜色与深度附件，深度以eUndefined重新开始前也必须等其写完
+	vk::SubpassDependency dependency;
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+	dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+	dependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+	dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+	vk::RenderPassCreateInfo renderPassInfo;
+	renderPassInfo.attachmentCount = 2;
+	renderPassInfo.pAttachments = attachments;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 1;
+	renderPassInfo.pDependencies = &dependency;
+	renderPass_ = window_->device().createRenderPass(renderPassInfo);
+}
+
+void QVkHudOverlay::uploadFonts()
+{
+	vk::Device device = window_->device();
+	vk::CommandBufferAllocateInfo cmdBufferAllocInfo;
+	cmdBufferAllocInfo.commandBufferCount = 1;
+	cmdBufferAllocInfo.commandPool = window_->graphicsCommandPool();
+	cmdBufferAllocInfo.level = vk::CommandBufferLevel::ePrimary;
+	vk::CommandBuffer cmdBuffer = device.allocateCommandBuffers(cmdBufferAllocInfo).front();
+	vk::CommandBufferBeginInfo cmdBufferBeginInfo;
+	cmdBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	cmdBuffer.begin(cmdBufferBeginInfo);
+	ImGui_ImplVulkan_CreateFontsTexture(cmdBuffer);
+	cmdBuffer.end();
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmdBuffer;
+	vk::Queue queue = window_->graphicsQueue();
+	queue.submit(submitInfo);
+	queue.waitIdle();
+	device.freeCommandBuffers(window_->graphicsCommandPool(), cmdBuffer);
+	ImGui_ImplVulkan_DestroyFontUploadObjects();
+}
+
+void QVkHudOverlay::initSwapChainResources()
+{
+}
+
+void QVkHudOverlay::releaseSwapChainResources()
+{
+}
+
+void QVkHudOverlay::releaseResources()
+{
+	if (!enabled_)
+		return;
+	ImGui::SetCurrentContext(context_);
+	ImGui_ImplVulkan_Shutdown();
+	vk::Device device = window_->device();
+	device.destroyDescriptorPool(descPool_);
+	device.destroyRenderPass(renderPass_);
+	enabled_ = false;
+}
+
+void QVkHudOverlay::startNextFrame()
+{
+	if (!enabled_)
+		return;
+	QElapsedTimer hudTimer;
+	hudTimer.start();
+	ImGui::SetCurrentContext(context_);
+	updateHistories();
+
+	const QSize size = window_->swapChainImageSize();
+	ImGuiIO& io = ImGui::GetIO();
+	io.DisplaySize = ImVec2(size.width(), size.height());
+	io.DeltaTime = std::max(cpuFrameMs_.last() / 1000.0f, 1e-4f);
+	ImGui_ImplVulkan_NewFrame();
+	ImGui::NewFrame();
+	buildUi();
+	ImGui::Render();
+
+	vk::CommandBuffer cmdBuffer = window_->currentCommandBuffer();
+	vk::RenderPassBeginInfo beginInfo;
+	beginInfo.renderPass = renderPass_;
+	beginInfo.framebuffer = window_->currentFramebuffer();
+	beginInfo.renderArea.extent.width = size.width();
+	beginInfo.renderArea.extent.height = size.height();
+	cmdBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
+	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmdBuffer);
+	cmdBuffer.endRenderPass();
+	hudCpuMs_ = hudTimer.nsecsElapsed() / 1e6;
+}
+
+void QVkHudOverlay::updateHistories()
+{
+	if (frameTimer_.isValid())
+		cpuFrameMs_.push(frameTimer_.nsecsElapsed() / 1e6);
+	frameTimer_.start();
+
+	// GPU结果晚若干帧到达，只在新结果到达时追加
+	const QVkGpuProfiler::FrameResult& result = window_->gpuProfiler()->lastResult();
+	if (!result.scopes.isEmpty() && result.frameIndex != lastGpuFrame_) {
+		lastGpuFrame_ = result.frameIndex;
+		gpuFrameMs_.push(result.totalMs());
+		for (const QVkGpuProfiler::ScopeResult& scope : result.scopes) {
+			if (scope.depth != 1)
+				continue;
+			History& history = passMs_[scope.name];
+			if (history.values.empty())
+				history.values.resize(historySize_);
+			history.push(scope.durationMs);
+		}
+	}
+
+	QVkMetricsRegistry& registry = QVkMetricsRegistry::instance();
+	for (auto& metric : metrics_) {
+		const QVkMetricsRegistry::Metric value = registry.metric(metric.first);
+		if (value.count)
+			metric.second.push(value.last);
+	}
+
+	if (memoryBudgetSupported_ && (!memoryTimer_.isValid() || memoryTimer_.elapsed() >= HUD_MEMORY_INTERVAL_MS)) {
+		memoryTimer_.start();
+		updateMemoryUsage();
+	}
+}
+
+void QVkHudOverlay::updateMemoryUsage()
+{
+	vk::PhysicalDevice physicalDevice = window_->physicalDevice();
+	auto properties = physicalDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+	const vk::PhysicalDeviceMemoryProperties& memoryProperties = properties.get<vk::PhysicalDeviceMemoryProperties2>().memoryProperties;
+	const vk::PhysicalDeviceMemoryBudgetPropertiesEXT& budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+	double usage = 0.0;
+	double total = 0.0;
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+		if (memoryProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+			usage += budget.heapUsage[i];
+			total += budget.heapBudget[i];
+		}
+	}
+	memoryMb_.push(usage / (1024.0 * 1024.0));
+	memoryBudgetMb_ = total / (1024.0 * 1024.0);
+}
+
+void QVkHudOverlay::plot(const char* label, const History& history, const char* unit)
+{
+	char overlay[64];
+	snprintf(overlay, sizeof(overlay), "%.2f %s (avg %.2f, max %.2f)", history.last(), unit, history.average(), history.max());
+	ImGui::PlotLines(label, history.values.data(), history.values.size(), history.offset, overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+}
+
+void QVkHudOverlay::buildUi()
+{
+	ImGui::SetNextWindowPos(ImVec2(8, 8), ImGuiCond_Always);
+	ImGui::SetNextWindowSize(ImVec2(420, 0), ImGuiCond_Always);
+	ImGui::SetNextWindowBgAlpha(0.6f);
+	const ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav;
+	ImGui::Begin("QVkHudOverlay", nullptr, flags);
+	ImGui::PushItemWidth(-150);
+	plot("CPU frame", cpuFrameMs_, "ms");
+	plot("GPU frame", gpuFrameMs_, "ms");
+	for (const auto& pass : passMs_)
+		plot(pass.first.constData(), pass.second, "ms");
+	if (memoryBudgetSupported_) {
+		char label[64];
+		snprintf(label, sizeof(label), "VRAM / %.0f MB", memoryBudgetMb_);
+		plot(label, memoryMb_, "MB");
+	}
+	for (const auto& metric : metrics_)
+		plot(metric.first.constData(), metric.second, "");
+	ImGui::PopItemWidth();
+	ImGui::Text("HUD CPU: %.3f ms, dropped GPU frames: %d", hudCpuMs_, window_->gpuProfiler()->droppedFrameCount());
+	ImGui::End();
+}
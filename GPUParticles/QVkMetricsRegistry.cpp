@@ -0,0 +1,88 @@
+#include "QVkMetricsRegistry.h"
+#include <QDebug>
+#include <algorithm>
+
+QVkMetricsRegistry& QVkMetricsRegistry::instance()
+{
+	static QVkMetricsRegistry registry;
+	return registry;
+}
+
+QVkMetricsRegistry::~QVkMetricsRegistry()
+{
+	closeCsv();
+}
+
+void QVkMetricsRegistry::record(const QByteArray& name, double value, uint64_t frameIndex)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	Metric& metric = metrics_[name];
+	metric.min = metric.count ? std::min(metric.min, value) : value;
+	metric.max = metric.count ? std::max(metric.max, value) : value;
+	metric.last = value;
+	metric.sum += value;
+	metric.count++;
+	metric.frameIndex = frameIndex;
+
+	auto limit = limits_.find(name);
+	if (limit != limits_.end() && value > limit->second && !exceededLimits_.contains(name)) {
+		exceededLimits_.push_back(name);
+		qWarning() << "QVkMetricsRegistry:" << name << "=" << value << "exceeds limit" << limit->second << "at frame" << frameIndex;
+	}
+	if (csv_.isOpen())
+		csv_.write(QByteArray::number(frameIndex) + ',' + name + ',' + QByteArray::number(value, 'g', 10) + '\n');
+}
+
+QVkMetricsRegistry::Metric QVkMetricsRegistry::metric(const QByteArray& name) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto iter = metrics_.find(name);
+	return iter != metrics_.end() ? iter->second : Metric();
+}
+
+QList<QByteArray> QVkMetricsRegistry::names() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	QList<QByteArray> names;
+	for (const auto& metric : metrics_)
+		names.push_back(metric.first);
+	return names;
+}
+
+void QVkMetricsRegistry::reset()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	metrics_.clear();
+	exceededLimits_.clear();
+}
+
+void QVkMetricsRegistry::setLimit(const QByteArray& name, double maxValue)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	limits_[name] = maxValue;
+}
+
+QList<QByteArray> QVkMetricsRegistry::exceededLimits() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return exceededLimits_;
+}
+
+bool QVkMetricsRegistry::openCsv(const QString& filePath)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	csv_.close();
+	csv_.setFileName(filePath);
+	if (!csv_.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qWarning() << "QVkMetricsRegistry: Failed to open" << filePath;
+		return false;
+	}
+	csv_.write("frame,metric,value\n");
+	return true;
+}
+
+void QVkMetricsRegistry::closeCsv()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	csv_.close();
+}
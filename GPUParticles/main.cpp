@@ -3,16 +3,12 @@
 #include <QVulkanInstance>
 #include <vulkan/vulkan.hpp>
 #include "ParitclesRenderer.h"
+#include "QVkHudOverlay.h"
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
 Q_LOGGING_CATEGORY(lcVk, "qt.vulkan")
 
-class VulkanWindow : public QVulkanWindow {
-public:
-	QVulkanWindowRenderer* createRenderer() override { return new ParticlesRenderer(this); }
-};
-
 int main(int argc, char* argv[]) {
 	QGuiApplication app(argc, argv);
 
@@ -22,14 +18,21 @@ int main(int argc, char* argv[]) {
 
 	QVulkanInstance instance;
 	instance.setLayers({ "VK_LAYER_KHRONOS_validation" });
+	instance.setApiVersion(QVersionNumber(1, 1));
 	if (!instance.create())
 		qFatal("Failed to create Vulkan instance: %d", instance.errorCode());
 	VULKAN_HPP_DEFAULT_DISPATCHER.init(instance.vkInstance());
 
 	QLoggingCategory::setFilterRules(QStringLiteral("qt.vulkan=true"));
-	VulkanWindow vkWindow;
+	QVkWindow vkWindow;
 	vkWindow.setVulkanInstance(&instance);
 	vkWindow.resize(1024, 768);
+	vkWindow.addRenderer(std::make_shared<ParticlesRenderer>());
+	if (app.arguments().contains("--hud")) {			//叠加性能HUD，并绘制ParticleSystem每帧记录的粒子数
+		auto hud = std::make_shared<QVkHudOverlay>();
+		hud->addMetricPlot("particles");
+		vkWindow.setOverlay(hud);
+	}
 	vkWindow.show();
 	return app.exec();
 }
\ No newline at end of file
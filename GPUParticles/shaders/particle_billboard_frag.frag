@@ -0,0 +1,13 @@
+#version 450
+
+layout(location = 0) in vec2 uv;
+
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+	float alpha = 1.0 - smoothstep(0.0, 1.0, length(uv));     //柔和的圆形粒子
+	if (alpha <= 0.0)
+		discard;
+	fragColor = vec4(1.0, 0.85, 0.6, alpha * 0.5);
+}
@@ -0,0 +1,42 @@
+#version 450
+
+#define STORAGE_AOS 0
+
+layout(constant_id = 0) const uint STORAGE_MODE = STORAGE_AOS;
+
+layout(std430, binding = 0) readonly buffer InputParticle{
+    int inputCounter;
+    uint inputPadding[3];
+    float inputData[];
+};
+
+layout(std430, binding = 3) readonly buffer SortBuffer{
+    uvec2 sortData[];
+};
+
+layout(push_constant) uniform PushConstant{
+    mat4 viewProjection;
+    vec2 billboardScale;        //粒子尺寸乘以投影矩阵的缩放分量
+}pushConstant;
+
+layout(location = 0) out vec2 uv;
+
+out gl_PerVertex { 
+    vec4 gl_Position;
+};
+
+const vec2 corners[6] = vec2[](
+    vec2(-1, -1), vec2(1, -1), vec2(1, 1),
+    vec2(-1, -1), vec2(1, 1), vec2(-1, 1)
+);
+
+void main(){
+    const uint index = sortData[gl_InstanceIndex].y;                 //按从远到近的顺序绘制
+    const uint base = index * (STORAGE_MODE == STORAGE_AOS ? 8 : 3);
+    const vec3 position = vec3(inputData[base], inputData[base + 1], inputData[base + 2]);
+    const vec2 corner = corners[gl_VertexIndex];
+
+    gl_Position = pushConstant.viewProjection * vec4(position, 1);
+    gl_Position.xy += corner * pushConstant.billboardScale;          //在裁剪空间偏移，保留透视缩放
+    uv = corner;
+}
@@ -0,0 +1,84 @@
+// 粒子缓冲区的存储布局，由特化常量 STORAGE_MODE 选择
+//   STORAGE_AOS      : Particle{ vec3 position; float life; vec3 velocity; } 数组，每个粒子32字节
+//   STORAGE_SOA      : position[capacity] (vec3) | velocity[capacity] (vec3) | life[capacity] (float)
+//   STORAGE_SOA_HALF : position[capacity] (vec3) | velocity+life[capacity] (4 x f16)
+
+#define STORAGE_AOS 0
+#define STORAGE_SOA 1
+#define STORAGE_SOA_HALF 2
+
+layout(constant_id = 0) const uint STORAGE_MODE = STORAGE_AOS;
+
+struct Particle{
+    vec3 position;
+    float life;
+    vec3 velocity;
+};
+
+layout(std430, binding = 0) buffer InputParticle{
+    int inputCounter;
+    uint inputPadding[3];
+    uint inputData[];
+};
+
+layout(std430, binding = 1) buffer OutputParticle{
+    int outputCounter;
+    uint outputPadding[3];
+    uint outputData[];
+};
+
+Particle loadInputParticle(uint index, uint capacity) {
+    Particle particle;
+    if (STORAGE_MODE == STORAGE_AOS) {
+        const uint base = index * 8;
+        particle.position = uintBitsToFloat(uvec3(inputData[base], inputData[base + 1], inputData[base + 2]));
+        particle.life = uintBitsToFloat(inputData[base + 3]);
+        particle.velocity = uintBitsToFloat(uvec3(inputData[base + 4], inputData[base + 5], inputData[base + 6]));
+        return particle;
+    }
+    const uint posBase = index * 3;
+    particle.position = uintBitsToFloat(uvec3(inputData[posBase], inputData[posBase + 1], inputData[posBase + 2]));
+    if (STORAGE_MODE == STORAGE_SOA) {
+        const uint velBase = capacity * 3 + index * 3;
+        particle.velocity = uintBitsToFloat(uvec3(inputData[velBase], inputData[velBase + 1], inputData[velBase + 2]));
+        particle.life = uintBitsToFloat(inputData[capacity * 6 + index]);
+    }
+    else {
+        const uint velBase = capacity * 3 + index * 2;
+        const vec2 xy = unpackHalf2x16(inputData[velBase]);
+        const vec2 zw = unpackHalf2x16(inputData[velBase + 1]);
+        particle.velocity = vec3(xy, zw.x);
+        particle.life = zw.y;
+    }
+    return particle;
+}
+
+void storeOutputParticle(uint index, uint capacity, Particle particle) {
+    if (STORAGE_MODE == STORAGE_AOS) {
+        const uint base = index * 8;
+        outputData[base] = floatBitsToUint(particle.position.x);
+        outputData[base + 1] = floatBitsToUint(particle.position.y);
+        outputData[base + 2] = floatBitsToUint(particle.position.z);
+        outputData[base + 3] = floatBitsToUint(particle.life);
+        outputData[base + 4] = floatBitsToUint(particle.velocity.x);
+        outputData[base + 5] = floatBitsToUint(particle.velocity.y);
+        outputData[base + 6] = floatBitsToUint(particle.velocity.z);
+        return;
+    }
+    const uint posBase = index * 3;
+    outputData[posBase] = floatBitsToUint(particle.position.x);
+    outputData[posBase + 1] = floatBitsToUint(particle.position.y);
+    outputData[posBase + 2] = floatBitsToUint(particle.position.z);
+    if (STORAGE_MODE == STORAGE_SOA) {
+        const uint velBase = capacity * 3 + index * 3;
+        outputData[velBase] = floatBitsToUint(particle.velocity.x);
+        outputData[velBase + 1] = floatBitsToUint(particle.velocity.y);
+        outputData[velBase + 2] = floatBitsToUint(particle.velocity.z);
+        outputData[capacity * 6 + index] = floatBitsToUint(particle.life);
+    }
+    else {
+        const uint velBase = capacity * 3 + index * 2;
+        outputData[velBase] = packHalf2x16(particle.velocity.xy);
+        outputData[velBase + 1] = packHalf2x16(vec2(particle.velocity.z, particle.life));
+    }
+}
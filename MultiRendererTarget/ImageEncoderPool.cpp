@@ -0,0 +1,206 @@
+#include "ImageEncoderPool.h"
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <cstring>
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+#define QOI_OP_RGBA 0xff
+#define QOI_MAX_RUN 62
+
+ImageEncoderPool::ImageEncoderPool(int threadCount, int maxQueued)
+{
+	if (threadCount <= 0)
+		threadCount = std::max<int>(std::thread::hardware_concurrency() - 1, 1);		//留一个线程给渲染
+	maxQueued_ = maxQueued > 0 ? maxQueued : threadCount * 2;
+	for (int i = 0; i < threadCount; i++)
+		workers_.emplace_back(&ImageEncoderPool::run, this);
+}
+
+ImageEncoderPool::~ImageEncoderPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	taskAvailable_.notify_all();
+	for (auto& worker : workers_)
+		worker.join();
+}
+
+void ImageEncoderPool::encode(const QImage& image, const QString& filePath, Format format)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	spaceAvailable_.wait(lock, [this]() { return queue_.size() < maxQueued_; });
+	queue_.push_back({ image, filePath, format });
+	lock.unlock();
+	taskAvailable_.notify_one();
+}
+
+void ImageEncoderPool::encode(const uint8_t* data, QSize size, int bytesPerLine, const QString& filePath, Format format)
+{
+	// 先等待空位再复制，队列满时不会额外占用内存
+	std::unique_lock<std::mutex> lock(mutex_);
+	spaceAvailable_.wait(lock, [this]() { return queue_.size() < maxQueued_; });
+	lock.unlock();
+	QImage image(size, QImage::Format_RGBA8888);
+	for (int y = 0; y < size.height(); y++)
+		memcpy(image.scanLine(y), data + qsizetype(bytesPerLine) * y, size.width() * 4);
+	encode(image, filePath, format);
+}
+
+void ImageEncoderPool::waitForDone()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	spaceAvailable_.wait(lock, [this]() { return queue_.empty() && busyCount_ == 0; });
+}
+
+int ImageEncoderPool::failedCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return failedCount_;
+}
+
+ImageEncoderPool::Format ImageEncoderPool::formatForFile(const QString& filePath)
+{
+	const QString suffix = QFileInfo(filePath).suffix().toLower();
+	if (suffix == "qoi")
+		return Format::Qoi;
+	if (suffix == "rgba" || suffix == "raw")
+		return Format::Raw;
+	return Format::Png;
+}
+
+QString ImageEncoderPool::suffix(Format format)
+{
+	switch (format) {
+	case Format::Qoi: return "qoi";
+	case Format::Raw: return "rgba";
+	default: return "png";
+	}
+}
+
+void ImageEncoderPool::run()
+{
+	while (true) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		taskAvailable_.wait(lock, [this]() { return quit_ || !queue_.empty(); });
+		if (queue_.empty())
+			return;					//quit_时先把队列中剩余的任务写完
+		Task task = std::move(queue_.front());
+		queue_.pop_front();
+		busyCount_++;
+		lock.unlock();
+		spaceAvailable_.notify_all();
+
+		const bool ok = write(task);
+		if (!ok)
+			qWarning() << "ImageEncoderPool: Failed to write" << task.filePath;
+
+		lock.lock();
+		busyCount_--;
+		failedCount_ += ok ? 0 : 1;
+		lock.unlock();
+		spaceAvailable_.notify_all();
+	}
+}
+
+bool ImageEncoderPool::write(const Task& task)
+{
+	if (task.format == Format::Png)
+		return task.image.save(task.filePath, "PNG");
+
+	QImage image = task.image.convertToFormat(QImage::Format_RGBA8888);
+	QFile file(task.filePath);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	if (task.format == Format::Qoi) {
+		const QByteArray data = encodeQoi(image);
+		return file.write(data) == data.size();
+	}
+	for (int y = 0; y < image.height(); y++) {
+		if (file.write((const char*)image.constScanLine(y), image.width() * 4) != image.width() * 4)
+			return false;
+	}
+	return true;
+}
+
+QByteArray ImageEncoderPool::encodeQoi(const QImage& source)
+{
+	const QImage image = source.convertToFormat(QImage::Format_RGBA8888);
+	const int width = image.width();
+	const int height = image.height();
+
+	QByteArray data;
+	data.reserve(14 + qsizetype(width) * height * 5 + 8);		//最坏情况每个像素5字节
+	auto put32 = [&data](uint32_t value) {
+		for (int shift = 24; shift >= 0; shift -= 8)
+			data.append(char(value >> shift));
+	};
+	data.append("qoif", 4);
+	put32(width);
+	put32(height);
+	data.append(char(4));			//channels: RGBA
+	data.append(char(0));			//colorspace: sRGB + linear alpha
+
+	uint8_t index[64][4] = {};
+	uint8_t prev[4] = { 0, 0, 0, 255 };
+	int run = 0;
+	const qsizetype pixelCount = qsizetype(width) * height;
+	qsizetype pixelIndex = 0;
+	for (int y = 0; y < height; y++) {
+		const uint8_t* line = image.constScanLine(y);
+		for (int x = 0; x < width; x++, pixelIndex++) {
+			const uint8_t* px = line + x * 4;
+			if (memcmp(px, prev, 4) == 0) {
+				run++;
+				if (run == QOI_MAX_RUN || pixelIndex == pixelCount - 1) {
+					data.append(char(QOI_OP_RUN | (run - 1)));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0) {
+				data.append(char(QOI_OP_RUN | (run - 1)));
+				run = 0;
+			}
+			const int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+			if (memcmp(index[hash], px, 4) == 0) {
+				data.append(char(QOI_OP_INDEX | hash));
+			}
+			else {
+				memcpy(index[hash], px, 4);
+				if (px[3] == prev[3]) {
+					const int8_t vr = int8_t(px[0] - prev[0]);
+					const int8_t vg = int8_t(px[1] - prev[1]);
+					const int8_t vb = int8_t(px[2] - prev[2]);
+					const int8_t vgR = vr - vg;
+					const int8_t vgB = vb - vg;
+					if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+						data.append(char(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+					}
+					else if (vgR > -9 && vgR < 8 && vg > -33 && vg < 32 && vgB > -9 && vgB < 8) {
+						data.append(char(QOI_OP_LUMA | (vg + 32)));
+						data.append(char((vgR + 8) << 4 | (vgB + 8)));
+					}
+					else {
+						data.append(char(QOI_OP_RGB));
+						data.append((const char*)px, 3);
+					}
+				}
+				else {
+					data.append(char(QOI_OP_RGBA));
+					data.append((const char*)px, 4);
+				}
+			}
+			memcpy(prev, px, 4);
+		}
+	}
+	static const char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	data.append(padding, 8);
+	return data;
+}
@@ -1,18 +1,58 @@
 #include "MRTRenderer.h"
+#include <QDebug>
 #include <QDesktopServices>
 #include <QUrl>
+#include <QtCore/qfloat16.h>
+
+// R16F/R32F转为16位灰度（截断到[0, 1]），RGBA16F直接对应QImage的半精度格式
+static QImage toImage(const QVkReadbackRing::Frame& frame, int index, vk::Format format)
+{
+	switch (format) {
+	case vk::Format::eR16G16B16A16Sfloat:
+		return frame.toImage(index, QImage::Format_RGBA16FPx4);
+	case vk::Format::eR16Sfloat:
+	case vk::Format::eR32Sfloat: {
+		QImage image(frame.size, QImage::Format_Grayscale16);
+		for (int y = 0; y < image.height(); y++) {
+			const uint8_t* src = frame.imageData(index) + qsizetype(frame.bytesPerLine(index)) * y;
+			quint16* dst = (quint16*)image.scanLine(y);
+			for (int x = 0; x < image.width(); x++) {
+				const float value = format == vk::Format::eR16Sfloat ? float(((const qfloat16*)src)[x]) : ((const float*)src)[x];
+				dst[x] = quint16(qBound(0.0f, value, 1.0f) * 65535.0f + 0.5f);
+			}
+		}
+		return image;
+	}
+	default:
+		return frame.toImage(index);
+	}
+}
 
 MRTRenderer::MRTRenderer(QVulkanWindow* window)
 	:window_(window)
+	, windowContext_(new QVkWindowContext(window))
+	, context_(windowContext_.get())
 {
 }
 
+MRTRenderer::MRTRenderer(QVkContext* context)
+	:context_(context)
+{
+}
+
+MRTRenderer::~MRTRenderer()
+{
+	releaseResources();
+}
+
 void MRTRenderer::initResources()
 {
+	// 各附件在工作线程中并行编码，不阻塞渲染线程；releaseResources时等待写完
+	encoder_.reset(new ImageEncoderPool);
 	QVector<QImage> images = createImages({ 800,600 }, { QColor(0,100,200),QColor(50,200,100),QColor(15,15,15) });
 	for (int i = 0; i < images.size(); i++)
 	{
-		images[i].save("output" + QString::number(i) + ".png");
+		encoder_->encode(images[i], "output" + QString::number(i) + ".png");
 	}
 	QDesktopServices::openUrl(QUrl("file:", QUrl::TolerantMode));
 }
@@ -27,6 +67,9 @@ void MRTRenderer::releaseSwapChainResources()
 
 void MRTRenderer::releaseResources()
 {
+	encoder_.reset();
+	readback_.reset();
+	destroyTargets();
 }
 
 void MRTRenderer::startNextFrame()
@@ -37,8 +80,80 @@ QVector<QImage> MRTRenderer::createImages(QSize size, QVector<QColor> colors)
 {
 	if (colors.isEmpty())
 		return {};
-	vk::Device device = window_->device();
-	QVector<vk::AttachmentDescription>  attachmentDesc(colors.size());
+	QVector<QImage> images;
+	renderFrame(size, colors, [this, &images](const QVkReadbackRing::Frame& frame) {
+		for (int i = 0; i < frame.imageCount; i++)
+			images.push_back(toImage(frame, i, attachmentFormat(i)));
+	});
+	flush();
+	return images;
+}
+
+void MRTRenderer::renderFrame(QSize size, const QVector<QColor>& colors, QVkReadbackRing::Callback callback)
+{
+	if (colors.isEmpty())
+		return;
+	QVector<vk::Format> formats(colors.size());
+	for (int i = 0; i < formats.size(); i++)
+		formats[i] = attachmentFormat(i);
+	if (size != targetSize_ || formats != targetFormats_) {
+		flush();
+		destroyTargets();
+		createTargets(size, formats);
+	}
+	if (!readback_)
+		readback_.reset(new QVkReadbackRing(context_));
+	QVector<vk::Image> images;
+	QVector<int> imageBytesPerPixel;
+	for (int i = 0; i < colorAttachments_.size(); i++) {
+		images.push_back(colorAttachments_[i].image);
+		imageBytesPerPixel.push_back(bytesPerPixel(formats[i]));
+	}
+	readback_->submit([this, colors](vk::CommandBuffer cmdBuffer) {
+		recordFrame(cmdBuffer, colors);
+	}, images, imageBytesPerPixel, size, std::move(callback));
+}
+
+void MRTRenderer::flush()
+{
+	if (readback_)
+		readback_->flush();
+}
+
+void MRTRenderer::setAttachmentFormats(const QVector<vk::Format>& formats)
+{
+	attachmentFormats_ = formats;
+	for (auto& format : attachmentFormats_) {
+		if (bytesPerPixel(format) == 0) {
+			qWarning() << "MRTRenderer: unsupported attachment format" << int(format) << ", using eR8G8B8A8Unorm";
+			format = vk::Format::eR8G8B8A8Unorm;
+		}
+	}
+}
+
+vk::Format MRTRenderer::attachmentFormat(int i) const
+{
+	return i < attachmentFormats_.size() ? attachmentFormats_[i] : vk::Format::eR8G8B8A8Unorm;
+}
+
+int MRTRenderer::bytesPerPixel(vk::Format format)
+{
+	switch (format) {
+	case vk::Format::eR8G8B8A8Unorm: return 4;
+	case vk::Format::eR16Sfloat: return 2;
+	case vk::Format::eR32Sfloat: return 4;
+	case vk::Format::eR16G16B16A16Sfloat: return 8;
+	default: return 0;
+	}
+}
+
+void MRTRenderer::createTargets(QSize size, const QVector<vk::Format>& formats)
+{
+	vk::Device device = context_->device();
+	const int attachmentCount = formats.size();
+	targetSize_ = size;
+	targetFormats_ = formats;
+	QVector<vk::AttachmentDescription>  attachmentDesc(attachmentCount);
 	attachmentDesc[0].format = vk::Format::eR8G8B8A8Unorm;
 	attachmentDesc[0].samples = vk::SampleCountFlagBits::e1;
 	attachmentDesc[0].loadOp = vk::AttachmentLoadOp::eClear;
@@ -50,8 +165,11 @@ QVector<QImage> MRTRenderer::createImages(QSize size, QVector<QColor> colors)
 	for (int i = 1; i < attachmentDesc.size(); i++) {
 		attachmentDesc[i] = attachmentDesc[0];
 	}
+	for (int i = 0; i < attachmentDesc.size(); i++) {
+		attachmentDesc[i].format = formats[i];
+	}
 
-	QVector<vk::AttachmentReference> attachmentRef(colors.size());
+	QVector<vk::AttachmentReference> attachmentRef(attachmentCount);
 	for (int i = 0; i < attachmentRef.size(); i++) {
 		attachmentRef[i].layout = vk::ImageLayout::eColorAttachmentOptimal;
 		attachmentRef[i].attachment = i;
@@ -62,14 +180,31 @@ QVector<QImage> MRTRenderer::createImages(QSize size, QVector<QColor> colors)
 	subpassDesc.colorAttachmentCount = attachmentRef.size();
 	subpassDesc.pColorAttachments = attachmentRef.data();
 
+	// 附件在帧间复用：写入前等待上一帧的复制读完，写入后才能被本帧的复制读取
+	std::array<vk::SubpassDependency, 2> dependencies;
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = vk::PipelineStageFlagBits::eTransfer;
+	dependencies[0].dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	dependencies[0].srcAccessMask = {};
+	dependencies[0].dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	dependencies[1].dstStageMask = vk::PipelineStageFlagBits::eTransfer;
+	dependencies[1].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	dependencies[1].dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
 	vk::RenderPassCreateInfo renderPassInfo;
 	renderPassInfo.attachmentCount = attachmentDesc.size();
 	renderPassInfo.pAttachments = attachmentDesc.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpassDesc;
-	vk::RenderPass offscreenRenderPass = device.createRenderPass(renderPassInfo);
+	renderPassInfo.dependencyCount = dependencies.size();
+	renderPassInfo.pDependencies = dependencies.data();
+	offscreenRenderPass_ = device.createRenderPass(renderPassInfo);
 
-	QVector<FramebufferAttachment> colorAttachments(colors.size());
+	colorAttachments_.resize(attachmentCount);
 
 	vk::ImageCreateInfo attachmentImageInfo;
 	attachmentImageInfo.imageType = vk::ImageType::e2D;
@@ -83,10 +218,12 @@ QVector<QImage> MRTRenderer::createImages(QSize size, QVector<QColor> colors)
 	attachmentImageInfo.tiling = vk::ImageTiling::eOptimal;
 	attachmentImageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
 
-	for (auto& colorAttachment : colorAttachments) {
+	for (int i = 0; i < colorAttachments_.size(); i++) {
+		auto& colorAttachment = colorAttachments_[i];
+		attachmentImageInfo.format = formats[i];
 		colorAttachment.image = device.createImage(attachmentImageInfo);
 		vk::MemoryRequirements memReq = device.getImageMemoryRequirements(colorAttachment.image);
-		vk::MemoryAllocateInfo memAllocInfo(memReq.size, window_->deviceLocalMemoryIndex());
+		vk::MemoryAllocateInfo memAllocInfo(memReq.size, context_->deviceLocalMemoryIndex());
 		colorAttachment.imageMemroy = device.allocateMemory(memAllocInfo);
 		device.bindImageMemory(colorAttachment.image, colorAttachment.imageMemroy, 0);
 	}
@@ -101,67 +238,55 @@ QVector<QImage> MRTRenderer::createImages(QSize size, QVector<QColor> colors)
 	imageViewInfo.components.b = vk::ComponentSwizzle::eB;
 	imageViewInfo.components.a = vk::ComponentSwizzle::eA;
 
-	QVector<vk::ImageView> attachmentImageViews(colors.size());
-	for (int i = 0; i < colorAttachments.size(); i++) {
-		imageViewInfo.image = colorAttachments[i].image;
-		colorAttachments[i].imageView = device.createImageView(imageViewInfo);
-		attachmentImageViews[i] = colorAttachments[i].imageView;
+	QVector<vk::ImageView> attachmentImageViews(attachmentCount);
+	for (int i = 0; i < colorAttachments_.size(); i++) {
+		imageViewInfo.format = formats[i];
+		imageViewInfo.image = colorAttachments_[i].image;
+		colorAttachments_[i].imageView = device.createImageView(imageViewInfo);
+		attachmentImageViews[i] = colorAttachments_[i].imageView;
 	}
 
 	vk::FramebufferCreateInfo framebufferInfo;
-	framebufferInfo.renderPass = offscreenRenderPass;
+	framebufferInfo.renderPass = offscreenRenderPass_;
 	framebufferInfo.attachmentCount = attachmentImageViews.size();
 	framebufferInfo.pAttachments = attachmentImageViews.data();
 	framebufferInfo.width = size.width();
 	framebufferInfo.height = size.height();
 	framebufferInfo.layers = 1;
-	vk::Framebuffer frameBuffer = device.createFramebuffer(framebufferInfo);
-
-	vk::ImageCreateInfo stagingImageInfo;
-	stagingImageInfo.imageType = vk::ImageType::e2D;
-	stagingImageInfo.format = vk::Format::eR8G8B8A8Unorm;
-	stagingImageInfo.extent.width = size.width();
-	stagingImageInfo.extent.height = size.height();
-	stagingImageInfo.extent.depth = 1;
-	stagingImageInfo.mipLevels = 1;
-	stagingImageInfo.arrayLayers = 1;
-	stagingImageInfo.samples = vk::SampleCountFlagBits::e1;
-	stagingImageInfo.tiling = vk::ImageTiling::eLinear;
-	stagingImageInfo.usage = vk::ImageUsageFlagBits::eTransferDst;
-	stagingImageInfo.initialLayout = vk::ImageLayout::eUndefined;
-	vk::Image stagingImage = device.createImage(stagingImageInfo);
-
-	vk::MemoryRequirements stagingMemReq = device.getImageMemoryRequirements(stagingImage);
-	vk::MemoryAllocateInfo stagingBufferAllocInfo(stagingMemReq.size, window_->hostVisibleMemoryIndex());
-	vk::DeviceMemory stagingImageMemory = device.allocateMemory(stagingBufferAllocInfo);
-	device.bindImageMemory(stagingImage, stagingImageMemory, 0);
-
-	vk::ImageSubresourceRange stagingSubResRange;
-	stagingSubResRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-	stagingSubResRange.baseMipLevel = 0;
-	stagingSubResRange.levelCount = 1;
-	stagingSubResRange.baseArrayLayer = 0;
-	stagingSubResRange.layerCount = 1;
+	frameBuffer_ = device.createFramebuffer(framebufferInfo);
+}
 
-	vk::CommandBufferAllocateInfo cmdBufferAlllocInfo;
-	cmdBufferAlllocInfo.level = vk::CommandBufferLevel::ePrimary;
-	cmdBufferAlllocInfo.commandPool = window_->graphicsCommandPool();
-	cmdBufferAlllocInfo.commandBufferCount = 1;
-	vk::CommandBuffer cmdBuffer = device.allocateCommandBuffers(cmdBufferAlllocInfo).front();
-	vk::CommandBufferBeginInfo cmdBufferBeginInfo;
-	cmdBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue;
-	cmdBuffer.begin(cmdBufferBeginInfo);
+void MRTRenderer::destroyTargets()
+{
+	if (!offscreenRenderPass_)
+		return;
+	vk::Device device = context_->device();
+	device.destroyFramebuffer(frameBuffer_);
+	for (int i = 0; i < colorAttachments_.size(); i++) {
+		device.destroyImageView(colorAttachments_[i].imageView);
+		device.destroyImage(colorAttachments_[i].image);
+		device.freeMemory(colorAttachments_[i].imageMemroy);
+	}
+	device.destroyRenderPass(offscreenRenderPass_);
+	colorAttachments_.clear();
+	frameBuffer_ = nullptr;
+	offscreenRenderPass_ = nullptr;
+	targetSize_ = QSize();
+	targetFormats_.clear();
+}
 
+void MRTRenderer::recordFrame(vk::CommandBuffer cmdBuffer, const QVector<QColor>& colors)
+{
 	QVector<vk::ClearValue> clearValues(colors.size());
 	for (int i = 0; i < clearValues.size(); i++) {
 		clearValues[i] = vk::ClearColorValue(std::array<float, 4>{colors[i].redF(), colors[i].greenF(), colors[i].blueF(), colors[i].alphaF() });
 	}
 
 	vk::RenderPassBeginInfo beginInfo;
-	beginInfo.renderPass = offscreenRenderPass;
-	beginInfo.framebuffer = frameBuffer;
-	beginInfo.renderArea.extent.width = size.width();
-	beginInfo.renderArea.extent.height = size.height();
+	beginInfo.renderPass = offscreenRenderPass_;
+	beginInfo.framebuffer = frameBuffer_;
+	beginInfo.renderArea.extent.width = targetSize_.width();
+	beginInfo.renderArea.extent.height = targetSize_.height();
 	beginInfo.clearValueCount = clearValues.size();
 	beginInfo.pClearValues = clearValues.data();
 
@@ -169,95 +294,16 @@ QVector<QImage> MRTRenderer::createImages(QSize size, QVector<QColor> colors)
 	vk::Viewport viewport;
 	viewport.x = 0;
 	viewport.y = 0;
-	viewport.width = size.width();
-	viewport.height = size.height();
+	viewport.width = targetSize_.width();
+	viewport.height = targetSize_.height();
 	viewport.minDepth = 0;
 	viewport.maxDepth = 1;
 	cmdBuffer.setViewport(0, viewport);
 
 	vk::Rect2D scissor;
 	scissor.offset.x = scissor.offset.y = 0;
-	scissor.extent.width = size.width();
-	scissor.extent.height = size.height();
+	scissor.extent.width = targetSize_.width();
+	scissor.extent.height = targetSize_.height();
 	cmdBuffer.setScissor(0, scissor);
 	cmdBuffer.endRenderPass();
-
-	vk::ImageMemoryBarrier barrier;
-	barrier.image = stagingImage;
-	barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-	barrier.oldLayout = vk::ImageLayout::eUndefined;
-	barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
-	barrier.subresourceRange = stagingSubResRange;
-	cmdBuffer.pipelineBarrier(
-		vk::PipelineStageFlagBits::eTransfer,
-		vk::PipelineStageFlagBits::eTransfer,
-		{},
-		0, nullptr,
-		0, nullptr,
-		1, &barrier
-	);
-	cmdBuffer.end();
-
-	vk::Queue graphicsQueue = window_->graphicsQueue();
-	vk::SubmitInfo submitInfo;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmdBuffer;
-	graphicsQueue.submit(submitInfo);
-	graphicsQueue.waitIdle();
-
-	vk::ImageSubresource stagingSubRes;
-	stagingSubRes.aspectMask = vk::ImageAspectFlagBits::eColor;
-	stagingSubRes.arrayLayer = 0;
-	stagingSubRes.mipLevel = 0;
-
-	vk::ImageCopy imageCopy;
-	imageCopy.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-	imageCopy.srcSubresource.layerCount = 1;
-	imageCopy.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-	imageCopy.dstSubresource.layerCount = 1;
-	imageCopy.extent.width = size.width();
-	imageCopy.extent.height = size.height();
-	imageCopy.extent.depth = 1;
-
-	vk::SubresourceLayout layout = device.getImageSubresourceLayout(stagingImage, stagingSubRes);
-
-	QVector<QImage> images;
-	QImage readBackImage(size, QImage::Format::Format_RGBA8888);
-
-	for (int i = 0; i < colors.size(); i++) {
-		cmdBuffer = device.allocateCommandBuffers(cmdBufferAlllocInfo).front();
-		vk::CommandBufferBeginInfo cmdBufferBeginInfo;
-		cmdBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
-		cmdBuffer.begin(cmdBufferBeginInfo);
-		cmdBuffer.copyImage(colorAttachments[i].image, vk::ImageLayout::eTransferSrcOptimal, stagingImage, vk::ImageLayout::eTransferDstOptimal, imageCopy);
-		cmdBuffer.end();
-		graphicsQueue.submit(submitInfo);
-		graphicsQueue.waitIdle();
-
-		uint8_t* memPtr = (uint8_t*)device.mapMemory(stagingImageMemory, layout.offset, layout.size, {});
-		if (memPtr) {
-			for (int y = 0; y < readBackImage.height(); ++y) {
-				memcpy(readBackImage.scanLine(y), memPtr, readBackImage.width() * 4);
-				memPtr += layout.rowPitch;
-			}
-			device.unmapMemory(stagingImageMemory);
-		}
-		else {
-			qWarning("QVulkanWindow: Failed to map readback image memory after transfer");
-		}
-		images.push_back(readBackImage);
-	}
-
-	device.freeCommandBuffers(window_->graphicsCommandPool(), cmdBuffer);
-	for (int i = 0; i < colorAttachments.size(); i++) {
-		device.destroyImageView(colorAttachments[i].imageView);
-		device.destroyImage(colorAttachments[i].image);
-		device.freeMemory(colorAttachments[i].imageMemroy);
-	}
-	device.destroyImage(stagingImage);
-	device.freeMemory(stagingImageMemory);
-	device.destroyFramebuffer(frameBuffer);
-	device.destroyRenderPass(offscreenRenderPass);
-
-	return images;
 }
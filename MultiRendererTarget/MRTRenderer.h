@@ -3,24 +3,50 @@
 
 #include <QVulkanWindowRenderer>
 #include <vulkan\vulkan.hpp>
+#include "QVkContext.h"
+#include "QVkReadbackRing.h"
+#include "ImageEncoderPool.h"
 
 class MRTRenderer : public QVulkanWindowRenderer {
 public:
 	MRTRenderer(QVulkanWindow* window);
+	MRTRenderer(QVkContext* context);		//无窗口运行，直接调用createImages
+	~MRTRenderer();
 	void initResources() override;
 	void initSwapChainResources() override;
 	void releaseSwapChainResources() override;
 	void releaseResources() override;
 	void startNextFrame() override;
-private:
 	QVector<QImage> createImages(QSize size, QVector<QColor> colors);
+	// 连续渲染：附件与帧缓冲常驻，尺寸或附件数量变化时才重建；所有附件在同一次提交中回读到环中的一个缓冲区
+	void renderFrame(QSize size, const QVector<QColor>& colors, QVkReadbackRing::Callback callback);
+	void flush();
+	// 附件i的格式，支持 eR8G8B8A8Unorm（默认）、eR16Sfloat、eR32Sfloat、eR16G16B16A16Sfloat，
+	// 用于一次回读整个G-buffer（例如深度、法线与反照率）；回调中各附件的偏移见 Frame::imageOffsets
+	void setAttachmentFormats(const QVector<vk::Format>& formats);
+	vk::Format attachmentFormat(int i) const;
+	static int bytesPerPixel(vk::Format format);
+private:
+	void createTargets(QSize size, const QVector<vk::Format>& formats);
+	void destroyTargets();
+	void recordFrame(vk::CommandBuffer cmdBuffer, const QVector<QColor>& colors);
 private:
 	QVulkanWindow* window_ = nullptr;
+	std::unique_ptr<QVkWindowContext> windowContext_;
+	QVkContext* context_ = nullptr;
 	struct FramebufferAttachment {
 		vk::Image image;
 		vk::DeviceMemory imageMemroy;
 		vk::ImageView imageView;
 	};
+	QVector<vk::Format> attachmentFormats_;
+	QSize targetSize_;
+	QVector<vk::Format> targetFormats_;
+	vk::RenderPass offscreenRenderPass_;
+	QVector<FramebufferAttachment> colorAttachments_;
+	vk::Framebuffer frameBuffer_;
+	std::unique_ptr<QVkReadbackRing> readback_;
+	std::unique_ptr<ImageEncoderPool> encoder_;
 };
 
 #endif // MRTRenderer_h__
\ No newline at end of file
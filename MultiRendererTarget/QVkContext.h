@@ -0,0 +1,73 @@
+#ifndef QVkContext_h__
+#define QVkContext_h__
+
+#include <QVulkanWindow>
+#include <memory>
+#include <vulkan\vulkan.hpp>
+
+// 离屏渲染只需要设备、队列和命令池，这里抽出与QVulkanWindow同名的访问接口，
+// 使渲染器既能挂在窗口上运行，也能在没有X/Wayland的批处理或CI环境中运行
+class QVkContext {
+public:
+	virtual ~QVkContext() = default;
+	virtual VkDevice device() const = 0;
+	virtual VkPhysicalDevice physicalDevice() const = 0;
+	virtual const VkPhysicalDeviceProperties* physicalDeviceProperties() const = 0;
+	virtual VkQueue graphicsQueue() const = 0;
+	virtual VkCommandPool graphicsCommandPool() const = 0;
+	virtual uint32_t hostVisibleMemoryIndex() const = 0;
+	virtual uint32_t deviceLocalMemoryIndex() const = 0;
+};
+
+// 直接转发QVulkanWindow的设备资源
+class QVkWindowContext : public QVkContext {
+public:
+	QVkWindowContext(QVulkanWindow* window) :window_(window) {}
+	VkDevice device() const override { return window_->device(); }
+	VkPhysicalDevice physicalDevice() const override { return window_->physicalDevice(); }
+	const VkPhysicalDeviceProperties* physicalDeviceProperties() const override { return window_->physicalDeviceProperties(); }
+	VkQueue graphicsQueue() const override { return window_->graphicsQueue(); }
+	VkCommandPool graphicsCommandPool() const override { return window_->graphicsCommandPool(); }
+	uint32_t hostVisibleMemoryIndex() const override { return window_->hostVisibleMemoryIndex(); }
+	uint32_t deviceLocalMemoryIndex() const override { return window_->deviceLocalMemoryIndex(); }
+private:
+	QVulkanWindow* window_ = nullptr;
+};
+
+// 不依赖窗口系统，自行创建VkInstance与VkDevice
+// 设备选择：QT_VK_PHYSICAL_DEVICE_INDEX 指定的设备优先，否则按 独显 > 集显 > 虚拟 > CPU(lavapipe等) 选择第一个带图形队列的设备
+class QVkHeadlessContext : public QVkContext {
+public:
+	QVkHeadlessContext() = default;
+	~QVkHeadlessContext();
+	QVkHeadlessContext(const QVkHeadlessContext&) = delete;
+	QVkHeadlessContext& operator=(const QVkHeadlessContext&) = delete;
+
+	void setLayers(const std::vector<const char*>& layers) { layers_ = layers; }		//需在create之前设置，不可用的层会被忽略
+	bool create();
+	void destroy();
+	bool isValid() const { return bool(device_); }
+
+	vk::Instance instance() const { return instance_; }
+	VkDevice device() const override { return device_; }
+	VkPhysicalDevice physicalDevice() const override { return physicalDevice_; }
+	const VkPhysicalDeviceProperties* physicalDeviceProperties() const override { return &physicalDeviceProperties_; }
+	VkQueue graphicsQueue() const override { return graphicsQueue_; }
+	uint32_t graphicsQueueFamilyIndex() const { return graphicsQueueFamilyIndex_; }
+	VkCommandPool graphicsCommandPool() const override { return graphicsCommandPool_; }
+	uint32_t hostVisibleMemoryIndex() const override { return hostVisibleMemoryIndex_; }
+	uint32_t deviceLocalMemoryIndex() const override { return deviceLocalMemoryIndex_; }
+private:
+	std::vector<const char*> layers_;
+	vk::Instance instance_;
+	vk::PhysicalDevice physicalDevice_;
+	VkPhysicalDeviceProperties physicalDeviceProperties_ = {};
+	vk::Device device_;
+	vk::Queue graphicsQueue_;
+	uint32_t graphicsQueueFamilyIndex_ = 0;
+	vk::CommandPool graphicsCommandPool_;
+	uint32_t hostVisibleMemoryIndex_ = 0;
+	uint32_t deviceLocalMemoryIndex_ = 0;
+};
+
+#endif // QVkContext_h__
@@ -1,7 +1,12 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QGuiApplication>
 #include <QLoggingCategory>
 #include <QVulkanInstance>
 #include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <cstring>
 #include "MRTRenderer.h"
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
@@ -14,12 +19,58 @@ public:
 };
 
 int main(int argc, char* argv[]) {
-	QGuiApplication app(argc, argv);
-
 	static vk::DynamicLoader  dynamicLoader;
 	PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dynamicLoader.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
 	VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
 
+	// --headless：不创建窗口，也不需要显示服务器，可用于批处理与CI容器（例如配合lavapipe）
+	if (std::find_if(argv + 1, argv + argc, [](const char* arg) { return strcmp(arg, "--headless") == 0; }) != argv + argc) {
+		QCoreApplication app(argc, argv);
+		QVkHeadlessContext context;
+		context.setLayers({ "VK_LAYER_KHRONOS_validation" });
+		if (!context.create())
+			qFatal("Failed to create headless Vulkan context");
+		MRTRenderer renderer(&context);
+		// --gbuffer N：以反照率(RGBA8)、法线(RGBA16F)、深度(R32F)三个附件连续渲染N帧，
+		// 每帧的打包缓冲区原样追加到gbuffer.bin（各附件偏移见日志），用于离线处理
+		int gbufferFrames = 0;
+		for (int i = 1; i + 1 < argc; i++) {
+			if (strcmp(argv[i], "--gbuffer") == 0)
+				gbufferFrames = QByteArray(argv[i + 1]).toInt();
+		}
+		if (gbufferFrames > 0) {
+			renderer.setAttachmentFormats({ vk::Format::eR8G8B8A8Unorm, vk::Format::eR16G16B16A16Sfloat, vk::Format::eR32Sfloat });
+			QFile file("gbuffer.bin");
+			if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+				qFatal("Failed to open gbuffer.bin");
+			bool ok = true;
+			qint64 bytes = 0;
+			QElapsedTimer timer;
+			timer.start();
+			for (int i = 0; i < gbufferFrames && ok; i++) {
+				const float depth = float(i % 100) / 100.0f;
+				renderer.renderFrame({ 800,600 }, { QColor(0,100,200), QColor::fromRgbF(0.5f, 0.5f, 1.0f), QColor::fromRgbF(depth, 0, 0) }, [&](const QVkReadbackRing::Frame& frame) {
+					if (frame.index == 0)
+						qDebug() << "gbuffer frame bytes:" << frame.byteCount << "offsets:" << frame.imageOffsets;
+					ok = file.write((const char*)frame.data, frame.byteCount) == frame.byteCount && ok;
+					bytes += frame.byteCount;
+				});
+			}
+			renderer.flush();
+			const double seconds = timer.nsecsElapsed() / 1e9;
+			qDebug("%d frames in %.3f s, %.1f fps, %.1f MB/s", gbufferFrames, seconds, gbufferFrames / seconds, bytes / seconds / 1e6);
+			return ok ? 0 : 1;
+		}
+		QVector<QImage> images = renderer.createImages({ 800,600 }, { QColor(0,100,200),QColor(50,200,100),QColor(15,15,15) });
+		ImageEncoderPool encoder;
+		for (int i = 0; i < images.size(); i++)
+			encoder.encode(images[i], "output" + QString::number(i) + ".png");
+		encoder.waitForDone();
+		return encoder.failedCount() == 0 ? 0 : 1;
+	}
+
+	QGuiApplication app(argc, argv);
+
 	QVulkanInstance instance;
 	instance.setLayers({ "VK_LAYER_KHRONOS_validation" });
 	if (!instance.create())
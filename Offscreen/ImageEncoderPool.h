@@ -0,0 +1,60 @@
+#ifndef ImageEncoderPool_h__
+#define ImageEncoderPool_h__
+
+#include <QImage>
+#include <QString>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 在工作线程中编码并写出回读结果，使渲染线程不被PNG压缩拖慢
+// 队列满时encode阻塞调用者（背压），防止渲染远快于编码时内存无限增长
+class ImageEncoderPool {
+public:
+	enum class Format {
+		Png,
+		Qoi,			//https://qoiformat.org，无损且编码速度远快于PNG
+		Raw,			//紧密排列的RGBA8888像素，不含文件头
+	};
+
+	ImageEncoderPool(int threadCount = 0, int maxQueued = 0);		//threadCount为0时使用(硬件线程数-1)，maxQueued为0时取线程数的2倍
+	~ImageEncoderPool();					//等待所有任务写完
+	ImageEncoderPool(const ImageEncoderPool&) = delete;
+	ImageEncoderPool& operator=(const ImageEncoderPool&) = delete;
+
+	// QImage为隐式共享，入队不复制像素
+	void encode(const QImage& image, const QString& filePath, Format format);
+	void encode(const QImage& image, const QString& filePath) { encode(image, filePath, formatForFile(filePath)); }
+	// 复制一份像素后立即返回，data在返回后即可复用（例如QVkReadbackRing的回调中）
+	void encode(const uint8_t* data, QSize size, int bytesPerLine, const QString& filePath, Format format);
+	void waitForDone();
+
+	int threadCount() const { return workers_.size(); }
+	int failedCount() const;
+
+	static Format formatForFile(const QString& filePath);			//按后缀选择：.qoi、.rgba/.raw，其余为PNG
+	static QString suffix(Format format);
+	static QByteArray encodeQoi(const QImage& image);
+private:
+	struct Task {
+		QImage image;
+		QString filePath;
+		Format format;
+	};
+	void run();
+	static bool write(const Task& task);
+private:
+	std::vector<std::thread> workers_;
+	std::deque<Task> queue_;
+	size_t maxQueued_;
+	int busyCount_ = 0;
+	int failedCount_ = 0;
+	bool quit_ = false;
+	mutable std::mutex mutex_;
+	std::condition_variable taskAvailable_;
+	std::condition_variable spaceAvailable_;		//队列有空位或全部完成
+};
+
+#endif // ImageEncoderPool_h__
@@ -1,14 +1,46 @@
 #include "OffscreenRenderer.h"
+#include <QDebug>
 #include <QDesktopServices>
+#include <QFile>
 #include <QUrl>
+#include <fstream>
+
+static std::vector<char> readFile(const std::string& filename) {
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open file!");
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+
+	file.close();
+
+	return buffer;
+}
 
 OffscreenRenderer::OffscreenRenderer(QVulkanWindow* window)
-	:window_(window) {
+	:window_(window)
+	, windowContext_(new QVkWindowContext(window))
+	, context_(windowContext_.get()) {
+}
+
+OffscreenRenderer::OffscreenRenderer(QVkContext* context)
+	:context_(context) {
+}
+
+OffscreenRenderer::~OffscreenRenderer() {
+	releaseResources();
 }
 
 void OffscreenRenderer::initResources() {
-	QImage image = createImage({ 800,600 }, QColor(0, 100, 200));
-	image.save("output.png");
+	// 编码在工作线程中进行，不阻塞渲染线程；releaseResources时等待写完
+	encoder_.reset(new ImageEncoderPool);
+	encoder_->encode(createImage({ 800,600 }, QColor(0, 100, 200)), "output.png");
 	QDesktopServices::openUrl(QUrl("file:", QUrl::TolerantMode));	// QUrl::TolerantMode表示在解析过程中尽可能地接受并纠正不规范的URL格式。
 }
 
@@ -20,6 +52,10 @@ void OffscreenRenderer::releaseSwapChainResources()
 }
 
 void OffscreenRenderer::releaseResources() {
+	encoder_.reset();
+	readback_.reset();
+	destroyTargets();
+	destroyYuvPipline();
 }
 
 void OffscreenRenderer::startNextFrame() {
@@ -27,7 +63,283 @@ void OffscreenRenderer::startNextFrame() {
 
 QImage OffscreenRenderer::createImage(QSize size, QColor color)
 {
-	vk::Device device = window_->device();
+	QImage image;
+	renderFrame(size, color, [&image](const QVkReadbackRing::Frame& frame) {
+		image = frame.toImage();
+	});
+	flush();
+	return image;
+}
+
+void OffscreenRenderer::renderFrame(QSize size, QColor color, QVkReadbackRing::Callback callback)
+{
+	submitFrame(size, color, sceneMatrix(size), std::move(callback));
+}
+
+void OffscreenRenderer::submitFrame(QSize size, QColor color, const QMatrix4x4& mvp, QVkReadbackRing::Callback callback)
+{
+	if (size != targetSize_) {
+		flush();
+		destroyTargets();
+		createTargets(size);
+	}
+	if (!readback_)
+		readback_.reset(new QVkReadbackRing(context_));
+	readback_->submit([this, color, mvp](vk::CommandBuffer cmdBuffer) {
+		recordFrame(cmdBuffer, color, mvp);
+	}, { colorAttachment_ }, size, std::move(callback));
+}
+
+void OffscreenRenderer::flush()
+{
+	if (readback_)
+		readback_->flush();
+}
+
+bool OffscreenRenderer::renderTiled(QSize size, QColor color, const QString& filePath, QSize tileSize)
+{
+	const int maxDimension = context_->physicalDeviceProperties()->limits.maxImageDimension2D;
+	tileSize = tileSize.boundedTo(QSize(maxDimension, maxDimension)).boundedTo(size);
+	if (tileSize.isEmpty())
+		return false;
+
+	// PAM：文本头之后是逐行紧密排列的RGBA像素，可以按偏移直接写入
+	QFile file(filePath);
+	if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate))
+		return false;
+	const QByteArray header = QString("P7\nWIDTH %1\nHEIGHT %2\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n").arg(size.width()).arg(size.height()).toLatin1();
+	const qint64 rowBytes = qint64(size.width()) * 4;
+	if (file.write(header) != header.size() || !file.resize(header.size() + rowBytes * size.height()))
+		return false;
+
+	// 边缘的tile仍按tileSize渲染，避免重建附件，只写回有效部分；每个tile只映射它覆盖的文件区间
+	// 投影按附件实际覆盖的区域（可能超出图像边缘）裁剪，有效部分与整幅渲染的对应区域一致
+	const QMatrix4x4 mvp = sceneMatrix(size);
+	bool ok = true;
+	for (int y = 0; y < size.height(); y += tileSize.height()) {
+		for (int x = 0; x < size.width(); x += tileSize.width()) {
+			const QRect tile(QPoint(x, y), tileSize.boundedTo(QSize(size.width() - x, size.height() - y)));
+			submitFrame(tileSize, color, tileProjection(QRect(QPoint(x, y), tileSize), size) * mvp, [&, tile](const QVkReadbackRing::Frame& frame) {
+				const qint64 offset = header.size() + tile.y() * rowBytes + tile.x() * 4;
+				uchar* dst = file.map(offset, (tile.height() - 1) * rowBytes + tile.width() * 4);
+				if (!dst) {
+					ok = false;
+					return;
+				}
+				for (int row = 0; row < tile.height(); row++)
+					memcpy(dst + row * rowBytes, frame.data + qsizetype(row) * frame.bytesPerLine(), tile.width() * 4);
+				file.unmap(dst);
+			});
+		}
+	}
+	flush();
+	if (!ok)
+		qWarning() << "OffscreenRenderer: Failed to map" << filePath;
+	return ok;
+}
+
+QMatrix4x4 OffscreenRenderer::tileProjection(QRect tile, QSize size)
+{
+	// tile在NDC中的范围缩放平移到[-1, 1]，在裁剪空间中作用，透视投影同样适用
+	const float scaleX = float(size.width()) / tile.width();
+	const float scaleY = float(size.height()) / tile.height();
+	const float centerX = -1.0f + float(2 * tile.x() + tile.width()) / size.width();
+	const float centerY = -1.0f + float(2 * tile.y() + tile.height()) / size.height();
+	QMatrix4x4 matrix;
+	matrix.translate(-centerX * scaleX, -centerY * scaleY);
+	matrix.scale(scaleX, scaleY, 1.0f);
+	return matrix;
+}
+
+QMatrix4x4 OffscreenRenderer::sceneMatrix(QSize size)
+{
+	// 与QVulkanWindow::clipCorrectionMatrix()相同，无窗口时也能使用
+	const QMatrix4x4 clipCorrection(1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, -1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.5f, 0.5f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+	QMatrix4x4 projection;
+	projection.perspective(45.0f, float(size.width()) / size.height(), 0.1f, 100.0f);
+	QMatrix4x4 view;
+	view.lookAt(QVector3D(0.0f, 0.0f, 3.0f), QVector3D(0.0f, 0.0f, 0.0f), QVector3D(0.0f, 1.0f, 0.0f));
+	return clipCorrection * projection * view;
+}
+
+bool OffscreenRenderer::renderFrameYuv(QSize size, QColor color, QVkReadbackRing::Callback callback)
+{
+	if (size.width() % 8 != 0 || size.height() % 2 != 0) {
+		qWarning() << "OffscreenRenderer: YUV420 output requires width % 8 == 0 and even height:" << size;
+		return false;
+	}
+	if (size != targetSize_) {
+		flush();
+		destroyTargets();
+		createTargets(size);
+	}
+	if (!yuvPipline_)
+		createYuvPipline();
+	if (!yuvBuffer_)
+		createYuvBuffer();
+	if (!readback_)
+		readback_.reset(new QVkReadbackRing(context_));
+	readback_->submit([this, color, mvp = sceneMatrix(size)](vk::CommandBuffer cmdBuffer) {
+		recordFrame(cmdBuffer, color, mvp);
+		recordYuvConversion(cmdBuffer);
+	}, yuvBuffer_, yuvBufferSize_, std::move(callback));
+	return true;
+}
+
+void OffscreenRenderer::createYuvPipline()
+{
+	vk::Device device = context_->device();
+
+	vk::SamplerCreateInfo samplerInfo;
+	samplerInfo.magFilter = vk::Filter::eNearest;
+	samplerInfo.minFilter = vk::Filter::eNearest;
+	samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+	samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+	samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+	yuvSampler_ = device.createSampler(samplerInfo);
+
+	std::array<vk::DescriptorSetLayoutBinding, 2> bindings;
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = vk::ShaderStageFlagBits::eCompute;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = vk::DescriptorType::eStorageBuffer;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = vk::ShaderStageFlagBits::eCompute;
+
+	vk::DescriptorSetLayoutCreateInfo descSetLayoutInfo;
+	descSetLayoutInfo.bindingCount = bindings.size();
+	descSetLayoutInfo.pBindings = bindings.data();
+	yuvDescSetLayout_ = device.createDescriptorSetLayout(descSetLayoutInfo);
+
+	std::array<vk::DescriptorPoolSize, 2> descPoolSizes = {
+		vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 1),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 1),
+	};
+	vk::DescriptorPoolCreateInfo descPoolInfo;
+	descPoolInfo.maxSets = 1;
+	descPoolInfo.poolSizeCount = descPoolSizes.size();
+	descPoolInfo.pPoolSizes = descPoolSizes.data();
+	yuvDescPool_ = device.createDescriptorPool(descPoolInfo);
+
+	vk::DescriptorSetAllocateInfo descSetAllocInfo;
+	descSetAllocInfo.descriptorPool = yuvDescPool_;
+	descSetAllocInfo.descriptorSetCount = 1;
+	descSetAllocInfo.pSetLayouts = &yuvDescSetLayout_;
+	yuvDescSet_ = device.allocateDescriptorSets(descSetAllocInfo).front();
+
+	vk::PushConstantRange pushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t) * 2);
+	vk::PipelineLayoutCreateInfo piplineLayoutInfo;
+	piplineLayoutInfo.setLayoutCount = 1;
+	piplineLayoutInfo.pSetLayouts = &yuvDescSetLayout_;
+	piplineLayoutInfo.pushConstantRangeCount = 1;
+	piplineLayoutInfo.pPushConstantRanges = &pushConstant;
+	yuvPiplineLayout_ = device.createPipelineLayout(piplineLayoutInfo);
+
+	auto yuv420_comp = readFile("./yuv420_comp.spv");
+	vk::ShaderModuleCreateInfo shaderInfo;
+	shaderInfo.codeSize = yuv420_comp.size();
+	shaderInfo.pCode = reinterpret_cast<uint32_t*>(yuv420_comp.data());
+	vk::ShaderModule computeShaderModule = device.createShaderModule(shaderInfo);
+
+	vk::ComputePipelineCreateInfo computePiplineInfo;
+	computePiplineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+	computePiplineInfo.stage.module = computeShaderModule;
+	computePiplineInfo.stage.pName = "main";
+	computePiplineInfo.layout = yuvPiplineLayout_;
+	yuvPipline_ = device.createComputePipeline(nullptr, computePiplineInfo).value;
+	device.destroyShaderModule(computeShaderModule);
+}
+
+void OffscreenRenderer::destroyYuvPipline()
+{
+	if (!yuvPipline_)
+		return;
+	vk::Device device = context_->device();
+	device.destroyPipeline(yuvPipline_);
+	device.destroyPipelineLayout(yuvPiplineLayout_);
+	device.destroyDescriptorPool(yuvDescPool_);
+	device.destroyDescriptorSetLayout(yuvDescSetLayout_);
+	device.destroySampler(yuvSampler_);
+	yuvPipline_ = nullptr;
+	yuvPiplineLayout_ = nullptr;
+	yuvDescPool_ = nullptr;
+	yuvDescSet_ = nullptr;
+	yuvDescSetLayout_ = nullptr;
+	yuvSampler_ = nullptr;
+}
+
+void OffscreenRenderer::createYuvBuffer()
+{
+	vk::Device device = context_->device();
+	const vk::DeviceSize pixels = vk::DeviceSize(targetSize_.width()) * targetSize_.height();
+	yuvBufferSize_ = pixels + pixels / 2;
+
+	vk::BufferCreateInfo bufferInfo;
+	bufferInfo.size = yuvBufferSize_;
+	bufferInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc;
+	yuvBuffer_ = device.createBuffer(bufferInfo);
+	vk::MemoryRequirements memReq = device.getBufferMemoryRequirements(yuvBuffer_);
+	vk::MemoryAllocateInfo memAllocInfo(memReq.size, context_->deviceLocalMemoryIndex());
+	yuvBufferMemory_ = device.allocateMemory(memAllocInfo);
+	device.bindBufferMemory(yuvBuffer_, yuvBufferMemory_, 0);
+
+	// 附件与缓冲区都随尺寸重建，这里一并更新描述符
+	vk::DescriptorImageInfo descImageInfo(yuvSampler_, imageView_, vk::ImageLayout::eShaderReadOnlyOptimal);
+	vk::DescriptorBufferInfo descBufferInfo(yuvBuffer_, 0, yuvBufferSize_);
+	std::array<vk::WriteDescriptorSet, 2> writeDescSets;
+	writeDescSets[0].dstSet = yuvDescSet_;
+	writeDescSets[0].dstBinding = 0;
+	writeDescSets[0].descriptorCount = 1;
+	writeDescSets[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+	writeDescSets[0].pImageInfo = &descImageInfo;
+	writeDescSets[1].dstSet = yuvDescSet_;
+	writeDescSets[1].dstBinding = 1;
+	writeDescSets[1].descriptorCount = 1;
+	writeDescSets[1].descriptorType = vk::DescriptorType::eStorageBuffer;
+	writeDescSets[1].pBufferInfo = &descBufferInfo;
+	device.updateDescriptorSets(writeDescSets, {});
+}
+
+void OffscreenRenderer::recordYuvConversion(vk::CommandBuffer cmdBuffer)
+{
+	// 附件：渲染通道结束时为TransferSrc，转为着色器只读；缓冲区：等待上一帧的复制读完再写入
+	vk::ImageMemoryBarrier imageBarrier;
+	imageBarrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	imageBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	imageBarrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+	imageBarrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	imageBarrier.srcQueueFamilyIndex = imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = colorAttachment_;
+	imageBarrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	vk::BufferMemoryBarrier bufferBarrier;
+	bufferBarrier.srcAccessMask = {};
+	bufferBarrier.dstAccessMask = vk::AccessFlagBits::eShaderWrite;
+	bufferBarrier.srcQueueFamilyIndex = bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.buffer = yuvBuffer_;
+	bufferBarrier.size = VK_WHOLE_SIZE;
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, {}, bufferBarrier, imageBarrier);
+
+	const uint32_t params[2] = { uint32_t(targetSize_.width()), uint32_t(targetSize_.height()) };
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, yuvPipline_);
+	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, yuvPiplineLayout_, 0, yuvDescSet_, {});
+	cmdBuffer.pushConstants(yuvPiplineLayout_, vk::ShaderStageFlagBits::eCompute, 0, sizeof(params), params);
+	// 每个调用处理8x2像素，工作组为8x8个调用
+	cmdBuffer.dispatch((params[0] / 8 + 7) / 8, (params[1] / 2 + 7) / 8, 1);
+
+	bufferBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+	bufferBarrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, {}, {}, bufferBarrier, {});
+}
+
+void OffscreenRenderer::createTargets(QSize size)
+{
+	vk::Device device = context_->device();
+	targetSize_ = size;
 
 	vk::AttachmentDescription attachmentDesc;
 	attachmentDesc.format = vk::Format::eR8G8B8A8Unorm;
@@ -50,14 +362,31 @@ QImage OffscreenRenderer::createImage(QSize size, QColor color)
 	subpassDesc.colorAttachmentCount = 1;
 	subpassDesc.pColorAttachments = &attachmentRef;
 
+	// 图像在帧间复用：写入前等待上一帧的复制读完，写入后才能被本帧的复制读取
+	std::array<vk::SubpassDependency, 2> dependencies;
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader;		//上一帧的YUV转换也会读取附件
+	dependencies[0].dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	dependencies[0].srcAccessMask = {};
+	dependencies[0].dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	dependencies[1].dstStageMask = vk::PipelineStageFlagBits::eTransfer;
+	dependencies[1].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	dependencies[1].dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
 	// 创建渲染通道创建信息 
 	vk::RenderPassCreateInfo renderPassInfo;
 	renderPassInfo.attachmentCount = 1;
 	renderPassInfo.pAttachments = &attachmentDesc;
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpassDesc;
+	renderPassInfo.dependencyCount = dependencies.size();
+	renderPassInfo.pDependencies = dependencies.data();
 	// 创建渲染通道
-	vk::RenderPass offscreenRenderPass = device.createRenderPass(renderPassInfo);
+	offscreenRenderPass_ = device.createRenderPass(renderPassInfo);
 
 	// 创建颜色附件图像
 	vk::ImageCreateInfo attachmentImageInfo;
@@ -70,15 +399,15 @@ QImage OffscreenRenderer::createImage(QSize size, QColor color)
 	attachmentImageInfo.arrayLayers = 1;
 	attachmentImageInfo.samples = vk::SampleCountFlagBits::e1;
 	attachmentImageInfo.tiling = vk::ImageTiling::eOptimal;
-	attachmentImageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
-	vk::Image colorAttachment = device.createImage(attachmentImageInfo);
+	attachmentImageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eSampled;
+	colorAttachment_ = device.createImage(attachmentImageInfo);
 
 	// 分配和绑定图像内存
-	vk::MemoryRequirements memReq = device.getImageMemoryRequirements(colorAttachment);
-	vk::MemoryAllocateInfo memAllocInfo(memReq.size, window_->deviceLocalMemoryIndex());
+	vk::MemoryRequirements memReq = device.getImageMemoryRequirements(colorAttachment_);
+	vk::MemoryAllocateInfo memAllocInfo(memReq.size, context_->deviceLocalMemoryIndex());
 	// 创建内存分配信息，分配设备内存并将其绑定到颜色附件图像。
-	vk::DeviceMemory attachmentImageMemory = device.allocateMemory(memAllocInfo);
-	device.bindImageMemory(colorAttachment, attachmentImageMemory, 0);
+	attachmentImageMemory_ = device.allocateMemory(memAllocInfo);
+	device.bindImageMemory(colorAttachment_, attachmentImageMemory_, 0);
 
 	vk::ImageViewCreateInfo imageViewInfo;
 	imageViewInfo.viewType = vk::ImageViewType::e2D;
@@ -89,35 +418,134 @@ QImage OffscreenRenderer::createImage(QSize size, QColor color)
 	imageViewInfo.components.g = vk::ComponentSwizzle::eG;
 	imageViewInfo.components.b = vk::ComponentSwizzle::eB;
 	imageViewInfo.components.a = vk::ComponentSwizzle::eA;
-	imageViewInfo.image = colorAttachment;
-	vk::ImageView imageView = device.createImageView(imageViewInfo);
+	imageViewInfo.image = colorAttachment_;
+	imageView_ = device.createImageView(imageViewInfo);
 
 	// 使用离屏渲染通道、颜色附件视图及尺寸信息创建帧缓冲
 	vk::FramebufferCreateInfo framebufferInfo;
-	framebufferInfo.renderPass = offscreenRenderPass;
+	framebufferInfo.renderPass = offscreenRenderPass_;
 	framebufferInfo.attachmentCount = 1;
-	framebufferInfo.pAttachments = &imageView;
+	framebufferInfo.pAttachments = &imageView_;
 	framebufferInfo.width = size.width();
 	framebufferInfo.height = size.height();
 	framebufferInfo.layers = 1;
-	vk::Framebuffer frameBuffer = device.createFramebuffer(framebufferInfo);
+	frameBuffer_ = device.createFramebuffer(framebufferInfo);
+
+	createScenePipline();
+}
+
+void OffscreenRenderer::createScenePipline()
+{
+	vk::Device device = context_->device();
+
+	vk::PushConstantRange pushConstant(vk::ShaderStageFlagBits::eVertex, 0, sizeof(float) * 16);
+	vk::PipelineLayoutCreateInfo piplineLayoutInfo;
+	piplineLayoutInfo.pushConstantRangeCount = 1;
+	piplineLayoutInfo.pPushConstantRanges = &pushConstant;
+	scenePiplineLayout_ = device.createPipelineLayout(piplineLayoutInfo);
 
-	vk::CommandBufferAllocateInfo cmdBufferAlllocInfo;
-	cmdBufferAlllocInfo.level = vk::CommandBufferLevel::ePrimary;
-	cmdBufferAlllocInfo.commandPool = window_->graphicsCommandPool();
-	cmdBufferAlllocInfo.commandBufferCount = 1;
-	vk::CommandBuffer cmdBuffer = device.allocateCommandBuffers(cmdBufferAlllocInfo).front();
-	vk::CommandBufferBeginInfo cmdBufferBeginInfo;
-	cmdBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue;
-	cmdBuffer.begin(cmdBufferBeginInfo);
+	auto vertShaderCode = readFile("./scene_vert.spv");
+	auto fragShaderCode = readFile("./scene_frag.spv");
+	vk::ShaderModuleCreateInfo shaderInfo;
+	shaderInfo.codeSize = vertShaderCode.size();
+	shaderInfo.pCode = reinterpret_cast<uint32_t*>(vertShaderCode.data());
+	vk::ShaderModule vertShader = device.createShaderModule(shaderInfo);
+	shaderInfo.codeSize = fragShaderCode.size();
+	shaderInfo.pCode = reinterpret_cast<uint32_t*>(fragShaderCode.data());
+	vk::ShaderModule fragShader = device.createShaderModule(shaderInfo);
 
+	vk::PipelineShaderStageCreateInfo piplineShaderStage[2];
+	piplineShaderStage[0].stage = vk::ShaderStageFlagBits::eVertex;
+	piplineShaderStage[0].module = vertShader;
+	piplineShaderStage[0].pName = "main";
+	piplineShaderStage[1].stage = vk::ShaderStageFlagBits::eFragment;
+	piplineShaderStage[1].module = fragShader;
+	piplineShaderStage[1].pName = "main";
+
+	vk::GraphicsPipelineCreateInfo piplineInfo;
+	piplineInfo.stageCount = 2;
+	piplineInfo.pStages = piplineShaderStage;
+
+	vk::PipelineVertexInputStateCreateInfo vertexInputState;
+	piplineInfo.pVertexInputState = &vertexInputState;
+
+	vk::PipelineInputAssemblyStateCreateInfo vertexAssemblyState({}, vk::PrimitiveTopology::eTriangleList);
+	piplineInfo.pInputAssemblyState = &vertexAssemblyState;
+
+	vk::PipelineViewportStateCreateInfo viewportState;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+	piplineInfo.pViewportState = &viewportState;
+
+	vk::PipelineRasterizationStateCreateInfo rasterizationState;
+	rasterizationState.polygonMode = vk::PolygonMode::eFill;
+	rasterizationState.cullMode = vk::CullModeFlagBits::eNone;
+	rasterizationState.frontFace = vk::FrontFace::eCounterClockwise;
+	rasterizationState.lineWidth = 1.0f;
+	piplineInfo.pRasterizationState = &rasterizationState;
+
+	vk::PipelineMultisampleStateCreateInfo MSState;
+	MSState.rasterizationSamples = vk::SampleCountFlagBits::e1;
+	piplineInfo.pMultisampleState = &MSState;
+
+	vk::PipelineColorBlendStateCreateInfo colorBlendState;
+	vk::PipelineColorBlendAttachmentState colorBlendAttachmentState;
+	colorBlendAttachmentState.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+	colorBlendState.attachmentCount = 1;
+	colorBlendState.pAttachments = &colorBlendAttachmentState;
+	piplineInfo.pColorBlendState = &colorBlendState;
+
+	// 视口随附件尺寸变化，在recordFrame中设置
+	vk::DynamicState dynamicEnables[] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+	vk::PipelineDynamicStateCreateInfo dynamicState;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicEnables;
+	piplineInfo.pDynamicState = &dynamicState;
+
+	piplineInfo.layout = scenePiplineLayout_;
+	piplineInfo.renderPass = offscreenRenderPass_;
+	scenePipline_ = device.createGraphicsPipeline(nullptr, piplineInfo).value;
+
+	device.destroyShaderModule(vertShader);
+	device.destroyShaderModule(fragShader);
+}
+
+void OffscreenRenderer::destroyTargets()
+{
+	if (!offscreenRenderPass_)
+		return;
+	vk::Device device = context_->device();
+	device.destroyBuffer(yuvBuffer_);
+	device.freeMemory(yuvBufferMemory_);
+	yuvBuffer_ = nullptr;
+	yuvBufferMemory_ = nullptr;
+	yuvBufferSize_ = 0;
+	device.destroyPipeline(scenePipline_);
+	device.destroyPipelineLayout(scenePiplineLayout_);
+	scenePipline_ = nullptr;
+	scenePiplineLayout_ = nullptr;
+	device.destroyFramebuffer(frameBuffer_);
+	device.destroyImageView(imageView_);
+	device.destroyImage(colorAttachment_);
+	device.freeMemory(attachmentImageMemory_);
+	device.destroyRenderPass(offscreenRenderPass_);
+	frameBuffer_ = nullptr;
+	imageView_ = nullptr;
+	colorAttachment_ = nullptr;
+	attachmentImageMemory_ = nullptr;
+	offscreenRenderPass_ = nullptr;
+	targetSize_ = QSize();
+}
+
+void OffscreenRenderer::recordFrame(vk::CommandBuffer cmdBuffer, QColor color, const QMatrix4x4& mvp)
+{
 	vk::ClearValue clearValues = vk::ClearColorValue(std::array<float, 4>{color.redF(), color.greenF(), color.blueF(), color.alphaF() });
 	// 创建渲染通道开始信息（包括渲染通道、帧缓冲、渲染区域、清除值数量和指针）
 	vk::RenderPassBeginInfo beginInfo;
-	beginInfo.renderPass = offscreenRenderPass;
-	beginInfo.framebuffer = frameBuffer;
-	beginInfo.renderArea.extent.width = size.width();
-	beginInfo.renderArea.extent.height = size.height();
+	beginInfo.renderPass = offscreenRenderPass_;
+	beginInfo.framebuffer = frameBuffer_;
+	beginInfo.renderArea.extent.width = targetSize_.width();
+	beginInfo.renderArea.extent.height = targetSize_.height();
 	beginInfo.clearValueCount = 1;
 	beginInfo.pClearValues = &clearValues;
 
@@ -126,111 +554,20 @@ QImage OffscreenRenderer::createImage(QSize size, QColor color)
 	vk::Viewport viewport;
 	viewport.x = 0;
 	viewport.y = 0;
-	viewport.width = size.width();
-	viewport.height = size.height();
+	viewport.width = targetSize_.width();
+	viewport.height = targetSize_.height();
 	viewport.minDepth = 0;
 	viewport.maxDepth = 1;
 	cmdBuffer.setViewport(0, viewport);
 
 	vk::Rect2D scissor;
 	scissor.offset.x = scissor.offset.y = 0;
-	scissor.extent.width = size.width();
-	scissor.extent.height = size.height();
+	scissor.extent.width = targetSize_.width();
+	scissor.extent.height = targetSize_.height();
 	cmdBuffer.setScissor(0, scissor);
-	cmdBuffer.endRenderPass();
-
-	// 创建临时（转储）图像 (vk::Image): 创建一个线性铺排、用于转储目的的临时图像
-	vk::ImageCreateInfo stagingImageInfo;
-	stagingImageInfo.imageType = vk::ImageType::e2D;
-	stagingImageInfo.format = vk::Format::eR8G8B8A8Unorm;
-	stagingImageInfo.extent.width = size.width();
-	stagingImageInfo.extent.height = size.height();
-	stagingImageInfo.extent.depth = 1;
-	stagingImageInfo.mipLevels = 1;
-	stagingImageInfo.arrayLayers = 1;
-	stagingImageInfo.samples = vk::SampleCountFlagBits::e1;
-	stagingImageInfo.tiling = vk::ImageTiling::eLinear;
-	stagingImageInfo.usage = vk::ImageUsageFlagBits::eTransferDst;
-	stagingImageInfo.initialLayout = vk::ImageLayout::eUndefined;
-	vk::Image stagingImage = device.createImage(stagingImageInfo);
-	// 分配和绑定临时图像内存
-	vk::MemoryRequirements stagingMemReq = device.getImageMemoryRequirements(stagingImage);
-	vk::MemoryAllocateInfo stagingBufferAllocInfo(stagingMemReq.size, window_->hostVisibleMemoryIndex());
-	vk::DeviceMemory stagingImageMemory = device.allocateMemory(stagingBufferAllocInfo);
-	device.bindImageMemory(stagingImage, stagingImageMemory, 0);
-
-	vk::ImageSubresourceRange stagingSubResRange;
-	stagingSubResRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-	stagingSubResRange.baseMipLevel = 0;
-	stagingSubResRange.levelCount = 1;
-	stagingSubResRange.baseArrayLayer = 0;
-	stagingSubResRange.layerCount = 1;
-
-	// 定义图像内存屏障 创建一个内存屏障，用于将临时图像从未定义布局转换为转储目标优化布局。
-	vk::ImageMemoryBarrier barrier;
-	barrier.image = stagingImage;
-	barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-	barrier.oldLayout = vk::ImageLayout::eUndefined;
-	barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
-	barrier.subresourceRange = stagingSubResRange;
-	cmdBuffer.pipelineBarrier(
-		vk::PipelineStageFlagBits::eTransfer,
-		vk::PipelineStageFlagBits::eTransfer,
-		{},
-		0, nullptr,
-		0, nullptr,
-		1, &barrier
-	);
-
-	// 记录图像复制命令 (vk::ImageCopy): 定义从颜色附件到临时图像的图像复制操作。
-	vk::ImageCopy imageCopy;
-	imageCopy.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-	imageCopy.srcSubresource.layerCount = 1;
-	imageCopy.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-	imageCopy.dstSubresource.layerCount = 1;
-	imageCopy.extent.width = size.width();
-	imageCopy.extent.height = size.height();
-	imageCopy.extent.depth = 1;
-
-	cmdBuffer.copyImage(colorAttachment, vk::ImageLayout::eTransferSrcOptimal, stagingImage, vk::ImageLayout::eTransferDstOptimal, imageCopy);
-
-	cmdBuffer.end();
-
-	vk::Queue graphicsQueue = window_->graphicsQueue();
-	vk::SubmitInfo submitInfo;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmdBuffer;
-	graphicsQueue.submit(submitInfo);
-	graphicsQueue.waitIdle();
-	device.freeCommandBuffers(window_->graphicsCommandPool(), cmdBuffer);
-
-	// 映射临时图像内存: 获取临时图像的子资源布局，映射其内存到主机可访问的指针（memPtr）。
-	vk::ImageSubresource stagingSubRes;
-	stagingSubRes.aspectMask = vk::ImageAspectFlagBits::eColor;
-	stagingSubRes.arrayLayer = 0;
-	stagingSubRes.mipLevel = 0;
-	vk::SubresourceLayout layout = device.getImageSubresourceLayout(stagingImage, stagingSubRes);
-	uint8_t* memPtr = (uint8_t*)device.mapMemory(stagingImageMemory, layout.offset, layout.size, {});
-
-	QImage readBackImage(size, QImage::Format::Format_RGBA8888);
-	if (memPtr) {
-		for (int y = 0; y < readBackImage.height(); ++y) {
-			memcpy(readBackImage.scanLine(y), memPtr, readBackImage.width() * 4);
-			memPtr += layout.rowPitch;
-		}
-		device.unmapMemory(stagingImageMemory);
-	}
-	else {
-		qWarning("QVulkanWindow: Failed to map readback image memory after transfer");
-	}
 
-	device.destroyImage(stagingImage);
-	device.freeMemory(stagingImageMemory);
-	device.destroyImageView(imageView);
-	device.destroyImage(colorAttachment);
-	device.freeMemory(attachmentImageMemory);
-	device.destroyFramebuffer(frameBuffer);
-	device.destroyRenderPass(offscreenRenderPass);
-
-	return readBackImage;
-}
\ No newline at end of file
+	cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, scenePipline_);
+	cmdBuffer.pushConstants(scenePiplineLayout_, vk::ShaderStageFlagBits::eVertex, 0, sizeof(float) * 16, mvp.constData());
+	cmdBuffer.draw(3, 1, 0, 0);
+	cmdBuffer.endRenderPass();
+}
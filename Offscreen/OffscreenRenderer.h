@@ -2,20 +2,69 @@
 #define OffscreenRenderer_h__
 
 #include <QVulkanWindowRenderer>
+#include <QMatrix4x4>
 #include <vulkan\vulkan.hpp>
+#include "QVkContext.h"
+#include "QVkReadbackRing.h"
+#include "ImageEncoderPool.h"
 
 class OffscreenRenderer : public QVulkanWindowRenderer {
 public:
 	OffscreenRenderer(QVulkanWindow* window);
+	OffscreenRenderer(QVkContext* context);		//无窗口运行，直接调用createImage
+	~OffscreenRenderer();
 	void initResources() override;
 	void initSwapChainResources() override;
 	void releaseSwapChainResources() override;
 	void releaseResources() override;
 	void startNextFrame() override;
-private:
 	QImage createImage(QSize size, QColor color);
+	// 连续渲染：渲染通道、图像与帧缓冲常驻，尺寸变化时才重建；回读经由QVkReadbackRing流水线化，不等待GPU
+	void renderFrame(QSize size, QColor color, QVkReadbackRing::Callback callback);
+	void flush();				//等待所有在途的帧回读完成
+	// 分块渲染：按tileSize（不超过maxImageDimension2D）逐块渲染，回读后直接写入内存映射的PAM文件（RGBA8888）
+	// 显存与内存占用只与tileSize有关，与输出分辨率无关
+	bool renderTiled(QSize size, QColor color, const QString& filePath, QSize tileSize = QSize(2048, 2048));
+	// 将整幅图像的投影矩阵裁剪到tile：projection' = tileProjection(tile, size) * projection
+	static QMatrix4x4 tileProjection(QRect tile, QSize size);
+	// 整幅图像的场景MVP，已包含Vulkan的裁剪空间修正（Y向下、深度0~1）
+	static QMatrix4x4 sceneMatrix(QSize size);
+	// 渲染后在计算着色器中转换为I420（BT.601有限范围）再回读，每像素1.5字节；宽度须为8的倍数、高度须为偶数
+	bool renderFrameYuv(QSize size, QColor color, QVkReadbackRing::Callback callback);
+private:
+	void createTargets(QSize size);
+	void destroyTargets();
+	void submitFrame(QSize size, QColor color, const QMatrix4x4& mvp, QVkReadbackRing::Callback callback);
+	void recordFrame(vk::CommandBuffer cmdBuffer, QColor color, const QMatrix4x4& mvp);
+	void createScenePipline();
+	void createYuvPipline();
+	void destroyYuvPipline();
+	void createYuvBuffer();
+	void recordYuvConversion(vk::CommandBuffer cmdBuffer);
 private:
 	QVulkanWindow* window_ = nullptr;
+	std::unique_ptr<QVkWindowContext> windowContext_;
+	QVkContext* context_ = nullptr;
+	QSize targetSize_;
+	vk::RenderPass offscreenRenderPass_;
+	vk::Image colorAttachment_;
+	vk::DeviceMemory attachmentImageMemory_;
+	vk::ImageView imageView_;
+	vk::Framebuffer frameBuffer_;
+	vk::PipelineLayout scenePiplineLayout_;
+	vk::Pipeline scenePipline_;				//依赖渲染通道，随附件一起重建
+	std::unique_ptr<QVkReadbackRing> readback_;
+	std::unique_ptr<ImageEncoderPool> encoder_;
+
+	vk::Sampler yuvSampler_;
+	vk::DescriptorSetLayout yuvDescSetLayout_;
+	vk::DescriptorPool yuvDescPool_;
+	vk::DescriptorSet yuvDescSet_;
+	vk::PipelineLayout yuvPiplineLayout_;
+	vk::Pipeline yuvPipline_;
+	vk::Buffer yuvBuffer_;					//随附件一起重建
+	vk::DeviceMemory yuvBufferMemory_;
+	vk::DeviceSize yuvBufferSize_ = 0;
 };
 
 #endif // OffscreenRenderer_h__
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "QVkContext.h"
+#include <QDebug>
+#include <cstring>
+
+QVkHeadlessContext::~QVkHeadlessContext()
+{
+	destroy();
+}
+
+bool QVkHeadlessContext::create()
+{
+	if (device_)
+		return true;
+
+	std::vector<const char*> enabledLayers;
+	std::vector<vk::LayerProperties> availableLayers = vk::enumerateInstanceLayerProperties();
+	for (const char* layer : layers_) {
+		bool found = false;
+		for (const auto& properties : availableLayers)
+			found |= strcmp(properties.layerName, layer) == 0;
+		if (found)
+			enabledLayers.push_back(layer);
+		else
+			qWarning() << "QVkHeadlessContext: layer not available:" << layer;
+	}
+
+	vk::ApplicationInfo appInfo;
+	appInfo.pApplicationName = "QVkHeadlessContext";
+	appInfo.apiVersion = VK_API_VERSION_1_1;
+	vk::InstanceCreateInfo instanceInfo;
+	instanceInfo.pApplicationInfo = &appInfo;
+	instanceInfo.enabledLayerCount = enabledLayers.size();
+	instanceInfo.ppEnabledLayerNames = enabledLayers.data();
+	if (vk::createInstance(&instanceInfo, nullptr, &instance_) != vk::Result::eSuccess) {
+		qWarning("QVkHeadlessContext: Failed to create Vulkan instance");
+		return false;
+	}
+	VULKAN_HPP_DEFAULT_DISPATCHER.init(instance_);
+
+	// 按设备类型排序，软件光栅器排在最后但仍然可用
+	auto typeRank = [](vk::PhysicalDeviceType type) {
+		switch (type) {
+		case vk::PhysicalDeviceType::eDiscreteGpu: return 0;
+		case vk::PhysicalDeviceType::eIntegratedGpu: return 1;
+		case vk::PhysicalDeviceType::eVirtualGpu: return 2;
+		case vk::PhysicalDeviceType::eCpu: return 3;
+		default: return 4;
+		}
+	};
+	auto findGraphicsQueue = [](vk::PhysicalDevice physicalDevice) {
+		std::vector<vk::QueueFamilyProperties> queueFamilies = physicalDevice.getQueueFamilyProperties();
+		for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+			if (queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics)
+				return int(i);
+		}
+		return -1;
+	};
+
+	std::vector<vk::PhysicalDevice> physicalDevices = instance_.enumeratePhysicalDevices();
+	int selected = -1;
+	bool ok = false;
+	const int requested = qEnvironmentVariableIntValue("QT_VK_PHYSICAL_DEVICE_INDEX", &ok);
+	ok = ok && requested >= 0 && requested < int(physicalDevices.size()) && findGraphicsQueue(physicalDevices[requested]) >= 0;
+	if (ok)
+		selected = requested;
+	for (int i = 0; !ok && i < int(physicalDevices.size()); i++) {
+		if (findGraphicsQueue(physicalDevices[i]) < 0)
+			continue;
+		if (selected < 0 || typeRank(physicalDevices[i].getProperties().deviceType) < typeRank(physicalDevices[selected].getProperties().deviceType))
+			selected = i;
+	}
+	if (selected < 0) {
+		qWarning("QVkHeadlessContext: No physical device with a graphics queue");
+		destroy();
+		return false;
+	}
+	physicalDevice_ = physicalDevices[selected];
+	physicalDeviceProperties_ = physicalDevice_.getProperties();
+	graphicsQueueFamilyIndex_ = findGraphicsQueue(physicalDevice_);
+	qDebug() << "QVkHeadlessContext: using physical device" << selected << physicalDeviceProperties_.deviceName;
+
+	const float queuePriority = 1.0f;
+	vk::DeviceQueueCreateInfo queueInfo({}, graphicsQueueFamilyIndex_, 1, &queuePriority);
+	vk::DeviceCreateInfo deviceInfo;
+	deviceInfo.queueCreateInfoCount = 1;
+	deviceInfo.pQueueCreateInfos = &queueInfo;
+	device_ = physicalDevice_.createDevice(deviceInfo);
+	graphicsQueue_ = device_.getQueue(graphicsQueueFamilyIndex_, 0);
+
+	vk::CommandPoolCreateInfo cmdPoolInfo;
+	cmdPoolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+	cmdPoolInfo.queueFamilyIndex = graphicsQueueFamilyIndex_;
+	graphicsCommandPool_ = device_.createCommandPool(cmdPoolInfo);
+
+	// 与QVulkanWindow一致：主机可见优先选择带缓存的类型，设备本地找不到时退回主机可见
+	vk::PhysicalDeviceMemoryProperties memProperties = physicalDevice_.getMemoryProperties();
+	hostVisibleMemoryIndex_ = deviceLocalMemoryIndex_ = UINT32_MAX;
+	bool hostVisibleCached = false;
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+		const vk::MemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+		if ((flags & vk::MemoryPropertyFlagBits::eHostVisible) && (flags & vk::MemoryPropertyFlagBits::eHostCoherent)) {
+			const bool cached = bool(flags & vk::MemoryPropertyFlagBits::eHostCached);
+			if (hostVisibleMemoryIndex_ == UINT32_MAX || (cached && !hostVisibleCached)) {
+				hostVisibleMemoryIndex_ = i;
+				hostVisibleCached = cached;
+			}
+		}
+		if ((flags & vk::MemoryPropertyFlagBits::eDeviceLocal) && deviceLocalMemoryIndex_ == UINT32_MAX)
+			deviceLocalMemoryIndex_ = i;
+	}
+	if (deviceLocalMemoryIndex_ == UINT32_MAX)
+		deviceLocalMemoryIndex_ = hostVisibleMemoryIndex_;
+	return true;
+}
+
+void QVkHeadlessContext::destroy()
+{
+	if (device_) {
+		device_.waitIdle();
+		device_.destroyCommandPool(graphicsCommandPool_);
+		device_.destroy();
+	}
+	if (instance_)
+		instance_.destroy();
+	graphicsCommandPool_ = nullptr;
+	graphicsQueue_ = nullptr;
+	device_ = nullptr;
+	physicalDevice_ = nullptr;
+	instance_ = nullptr;
+}
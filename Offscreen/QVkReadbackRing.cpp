@@ -0,0 +1,190 @@
+#include "QVkReadbackRing.h"
+#include <QDebug>
+#include <algorithm>
+
+QVkReadbackRing::QVkReadbackRing(QVkContext* context, int slotCount)
+	:context_(context)
+	, slots_(std::max(slotCount, 1))
+{
+	vk::Device device = context_->device();
+	for (auto& slot : slots_)
+		slot.fence = device.createFence(vk::FenceCreateInfo());
+}
+
+QVkReadbackRing::~QVkReadbackRing()
+{
+	flush();
+	vk::Device device = context_->device();
+	for (auto& slot : slots_) {
+		if (slot.mapped)
+			device.unmapMemory(slot.memory);
+		device.destroyBuffer(slot.buffer);
+		device.freeMemory(slot.memory);
+		device.destroyFence(slot.fence);
+	}
+}
+
+void QVkReadbackRing::submit(const RecordFunction& record, const QVector<vk::Image>& images, QSize size, Callback callback)
+{
+	submit(record, images, QVector<int>(images.size(), 4), size, std::move(callback));
+}
+
+void QVkReadbackRing::submit(const RecordFunction& record, const QVector<vk::Image>& images, const QVector<int>& bytesPerPixel, QSize size, Callback callback)
+{
+	QVector<qsizetype> offsets(images.size());
+	vk::DeviceSize byteCount = 0;
+	for (int i = 0; i < images.size(); i++) {
+		offsets[i] = byteCount;
+		byteCount += (vk::DeviceSize(size.width()) * size.height() * bytesPerPixel[i] + 15) & ~vk::DeviceSize(15);
+	}
+	submit(record, [&](vk::CommandBuffer cmdBuffer, vk::Buffer dst) {
+		// bufferRowLength为0表示紧密排列，映射后可直接按行宽 width*bytesPerPixel 访问，无需逐行拷贝
+		vk::BufferImageCopy region;
+		region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = vk::Extent3D(size.width(), size.height(), 1);
+		for (int i = 0; i < images.size(); i++) {
+			region.bufferOffset = offsets[i];
+			cmdBuffer.copyImageToBuffer(images[i], vk::ImageLayout::eTransferSrcOptimal, dst, region);
+		}
+	}, byteCount, size, offsets, bytesPerPixel, std::move(callback));
+}
+
+void QVkReadbackRing::submit(const RecordFunction& record, vk::Buffer buffer, vk::DeviceSize size, Callback callback)
+{
+	submit(record, [&](vk::CommandBuffer cmdBuffer, vk::Buffer dst) {
+		cmdBuffer.copyBuffer(buffer, dst, vk::BufferCopy(0, 0, size));
+	}, size, QSize(), {}, {}, std::move(callback));
+}
+
+void QVkReadbackRing::submit(const RecordFunction& record, const CopyFunction& copy, vk::DeviceSize byteCount, QSize size, const QVector<qsizetype>& imageOffsets, const QVector<int>& imageBytesPerPixel, Callback callback)
+{
+	Slot& slot = slots_[next_];
+	if (slot.pending)
+		complete(slot);				//环已满，等待最早的一帧
+	next_ = (next_ + 1) % slots_.size();
+	reserve(slot, byteCount);
+
+	vk::Device device = context_->device();
+	vk::CommandBufferAllocateInfo cmdBufferAllocInfo;
+	cmdBufferAllocInfo.level = vk::CommandBufferLevel::ePrimary;
+	cmdBufferAllocInfo.commandPool = context_->graphicsCommandPool();
+	cmdBufferAllocInfo.commandBufferCount = 1;
+	slot.cmdBuffer = device.allocateCommandBuffers(cmdBufferAllocInfo).front();
+	vk::CommandBufferBeginInfo cmdBufferBeginInfo;
+	cmdBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	slot.cmdBuffer.begin(cmdBufferBeginInfo);
+
+	if (record)
+		record(slot.cmdBuffer);
+	copy(slot.cmdBuffer, slot.buffer);
+
+	// 复制结果对主机可见
+	vk::BufferMemoryBarrier barrier;
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+	barrier.srcQueueFamilyIndex = barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = slot.buffer;
+	barrier.size = VK_WHOLE_SIZE;
+	slot.cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, {}, barrier, {});
+	slot.cmdBuffer.end();
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &slot.cmdBuffer;
+	vk::Queue(context_->graphicsQueue()).submit(submitInfo, slot.fence);
+
+	slot.pending = true;
+	slot.index = submitCount_++;
+	slot.size = size;
+	slot.imageOffsets = imageOffsets;
+	slot.imageBytesPerPixel = imageBytesPerPixel;
+	slot.byteCount = byteCount;
+	slot.callback = std::move(callback);
+
+	poll();
+}
+
+std::future<QVector<QImage>> QVkReadbackRing::submit(const RecordFunction& record, const QVector<vk::Image>& images, QSize size)
+{
+	auto promise = std::make_shared<std::promise<QVector<QImage>>>();
+	std::future<QVector<QImage>> future = promise->get_future();
+	submit(record, images, size, [promise](const Frame& frame) {
+		QVector<QImage> images;
+		for (int i = 0; i < frame.imageCount; i++)
+			images << frame.toImage(i);
+		promise->set_value(images);
+	});
+	return future;
+}
+
+void QVkReadbackRing::poll()
+{
+	// 从最早提交的槽开始，遇到未完成的即停止，保证回调顺序与提交顺序一致
+	vk::Device device = context_->device();
+	for (size_t i = 0; i < slots_.size(); i++) {
+		Slot& slot = slots_[(next_ + i) % slots_.size()];
+		if (!slot.pending)
+			continue;
+		if (device.getFenceStatus(slot.fence) != vk::Result::eSuccess)
+			break;
+		complete(slot);
+	}
+}
+
+void QVkReadbackRing::flush()
+{
+	for (size_t i = 0; i < slots_.size(); i++) {
+		Slot& slot = slots_[(next_ + i) % slots_.size()];
+		if (slot.pending)
+			complete(slot);
+	}
+}
+
+int QVkReadbackRing::pendingCount() const
+{
+	return std::count_if(slots_.begin(), slots_.end(), [](const Slot& slot) { return slot.pending; });
+}
+
+void QVkReadbackRing::reserve(Slot& slot, vk::DeviceSize size)
+{
+	if (size <= slot.capacity)
+		return;
+	vk::Device device = context_->device();
+	if (slot.mapped)
+		device.unmapMemory(slot.memory);
+	device.destroyBuffer(slot.buffer);
+	device.freeMemory(slot.memory);
+
+	vk::BufferCreateInfo bufferInfo;
+	bufferInfo.size = size;
+	bufferInfo.usage = vk::BufferUsageFlagBits::eTransferDst;
+	slot.buffer = device.createBuffer(bufferInfo);
+	// hostVisibleMemoryIndex 优先选择带缓存的类型，CPU读取速度远高于写合并内存，且一定是coherent，不需要invalidate
+	vk::MemoryRequirements memReq = device.getBufferMemoryRequirements(slot.buffer);
+	vk::MemoryAllocateInfo memAllocInfo(memReq.size, context_->hostVisibleMemoryIndex());
+	slot.memory = device.allocateMemory(memAllocInfo);
+	device.bindBufferMemory(slot.buffer, slot.memory, 0);
+	slot.mapped = (uint8_t*)device.mapMemory(slot.memory, 0, VK_WHOLE_SIZE);
+	slot.capacity = size;
+	if (!slot.mapped)
+		qWarning("QVkReadbackRing: Failed to map readback buffer memory");
+}
+
+void QVkReadbackRing::complete(Slot& slot)
+{
+	vk::Device device = context_->device();
+	if (device.waitForFences(slot.fence, true, UINT64_MAX) != vk::Result::eSuccess)
+		qWarning("QVkReadbackRing: Failed to wait for readback fence");
+	device.resetFences(slot.fence);
+	device.freeCommandBuffers(context_->graphicsCommandPool(), slot.cmdBuffer);
+	slot.cmdBuffer = nullptr;
+	slot.pending = false;
+
+	Callback callback = std::move(slot.callback);
+	slot.callback = nullptr;
+	if (callback && slot.mapped) {
+		Frame frame{ slot.index, slot.size, int(slot.imageOffsets.size()), slot.mapped, qsizetype(slot.byteCount), slot.imageOffsets, slot.imageBytesPerPixel };
+		callback(frame);
+	}
+}
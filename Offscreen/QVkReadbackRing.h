@@ -0,0 +1,78 @@
+#ifndef QVkReadbackRing_h__
+#define QVkReadbackRing_h__
+
+#include <QImage>
+#include <QVector>
+#include <functional>
+#include <future>
+#include "QVkContext.h"
+
+// 持续回读渲染结果：每帧的图像通过copyImageToBuffer写入环中一个常驻映射的主机缓冲区，以fence判断完成。
+// 提交第N+k帧时不等待第N帧，只有环满时才等待最早的一帧（背压），CPU处理第N帧与GPU渲染后续帧重叠
+class QVkReadbackRing {
+public:
+	struct Frame {
+		uint64_t index;				//提交序号，从0开始
+		QSize size;
+		int imageCount;				//回读缓冲区时为0
+		const uint8_t* data;		//只在回调期间有效，回调返回后缓冲区会被复用
+		qsizetype byteCount;
+		QVector<qsizetype> imageOffsets;		//各图像在data中的偏移，图像的行紧密排列
+		QVector<int> imageBytesPerPixel;
+		int bytesPerPixel(int i = 0) const { return imageBytesPerPixel[i]; }
+		int bytesPerLine(int i = 0) const { return size.width() * bytesPerPixel(i); }
+		qsizetype imageBytes(int i = 0) const { return qsizetype(bytesPerLine(i)) * size.height(); }
+		const uint8_t* imageData(int i) const { return data + imageOffsets[i]; }
+		QImage toImage(int i = 0, QImage::Format format = QImage::Format_RGBA8888) const { return QImage(imageData(i), size.width(), size.height(), bytesPerLine(i), format).copy(); }
+	};
+	using Callback = std::function<void(const Frame&)>;
+	using RecordFunction = std::function<void(vk::CommandBuffer)>;
+
+	QVkReadbackRing(QVkContext* context, int slotCount = 3);
+	~QVkReadbackRing();
+	QVkReadbackRing(const QVkReadbackRing&) = delete;
+	QVkReadbackRing& operator=(const QVkReadbackRing&) = delete;
+
+	// record 录制渲染命令，执行完后 images 须处于 eTransferSrcOptimal，且尺寸均为 size；此重载的格式均为 eR8G8B8A8Unorm
+	// 回调在调用 submit/poll/flush 的线程上按提交顺序执行
+	void submit(const RecordFunction& record, const QVector<vk::Image>& images, QSize size, Callback callback);
+	// 各图像的格式可以不同（例如G-buffer中的R32F深度、RGBA16F法线与RGBA8反照率），bytesPerPixel与images一一对应，
+	// 全部复制到同一个缓冲区中，每幅图像的起始偏移按16字节对齐
+	void submit(const RecordFunction& record, const QVector<vk::Image>& images, const QVector<int>& bytesPerPixel, QSize size, Callback callback);
+	// 回读缓冲区（例如计算着色器的输出），record 中须已用屏障使 buffer 的写入对传输阶段可见
+	void submit(const RecordFunction& record, vk::Buffer buffer, vk::DeviceSize size, Callback callback);
+	// future 在后续的 submit/poll/flush 中兑现，单次使用时需先 flush 再 get
+	std::future<QVector<QImage>> submit(const RecordFunction& record, const QVector<vk::Image>& images, QSize size);
+
+	void poll();			//按顺序派发已完成的帧，不阻塞
+	void flush();			//等待并派发所有在途的帧
+	int slotCount() const { return slots_.size(); }
+	int pendingCount() const;
+private:
+	struct Slot {
+		vk::Buffer buffer;
+		vk::DeviceMemory memory;
+		vk::DeviceSize capacity = 0;
+		uint8_t* mapped = nullptr;
+		vk::CommandBuffer cmdBuffer;
+		vk::Fence fence;
+		bool pending = false;
+		uint64_t index = 0;
+		QSize size;
+		QVector<qsizetype> imageOffsets;
+		QVector<int> imageBytesPerPixel;
+		vk::DeviceSize byteCount = 0;
+		Callback callback;
+	};
+	using CopyFunction = std::function<void(vk::CommandBuffer, vk::Buffer)>;
+	void submit(const RecordFunction& record, const CopyFunction& copy, vk::DeviceSize byteCount, QSize size, const QVector<qsizetype>& imageOffsets, const QVector<int>& imageBytesPerPixel, Callback callback);
+	void reserve(Slot& slot, vk::DeviceSize size);
+	void complete(Slot& slot);
+private:
+	QVkContext* context_ = nullptr;
+	std::vector<Slot> slots_;
+	size_t next_ = 0;
+	uint64_t submitCount_ = 0;
+};
+
+#endif // QVkReadbackRing_h__
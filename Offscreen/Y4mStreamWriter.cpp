@@ -0,0 +1,61 @@
+#include "Y4mStreamWriter.h"
+#include <QDebug>
+#include <cstdio>
+#ifdef Q_OS_WIN
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+bool Y4mStreamWriter::open(const QString& path, QSize size, int fps, Format format)
+{
+	close();
+	size_ = size;
+	format_ = format;
+	frameCount_ = 0;
+	if (path == "-") {
+#ifdef Q_OS_WIN
+		_setmode(_fileno(stdout), _O_BINARY);		//避免换行符被转换
+#endif
+		if (!file_.open(fileno(stdout), QIODevice::WriteOnly | QIODevice::Unbuffered))
+			return false;
+	}
+	else {
+		file_.setFileName(path);
+		if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+			return false;
+	}
+	if (format_ == Format::Yuv420) {
+		// 色度取2x2的平均值，采样位置在四个像素中心，对应C420jpeg
+		const QByteArray header = QString("YUV4MPEG2 W%1 H%2 F%3:1 Ip A1:1 C420jpeg\n").arg(size.width()).arg(size.height()).arg(fps).toLatin1();
+		if (file_.write(header) != header.size()) {
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+qsizetype Y4mStreamWriter::frameBytes() const
+{
+	const qsizetype pixels = qsizetype(size_.width()) * size_.height();
+	return format_ == Format::Yuv420 ? pixels + pixels / 2 : pixels * 4;
+}
+
+bool Y4mStreamWriter::writeFrame(const uint8_t* data, qsizetype byteCount)
+{
+	if (!file_.isOpen() || byteCount < frameBytes())
+		return false;
+	if (format_ == Format::Yuv420 && file_.write("FRAME\n", 6) != 6)
+		return false;
+	if (file_.write((const char*)data, frameBytes()) != frameBytes()) {
+		qWarning() << "Y4mStreamWriter: Failed to write frame" << frameCount_ << file_.errorString();
+		return false;
+	}
+	frameCount_++;
+	return true;
+}
+
+void Y4mStreamWriter::close()
+{
+	file_.close();
+}
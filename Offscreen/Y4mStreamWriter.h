@@ -0,0 +1,31 @@
+#ifndef Y4mStreamWriter_h__
+#define Y4mStreamWriter_h__
+
+#include <QFile>
+#include <QSize>
+
+// 将连续的原始帧写到文件或管道（路径为"-"时写到标准输出），供ffmpeg等外部编码器直接读取：
+//   Yuv420：YUV4MPEG2（I420，BT.601有限范围），ffmpeg -i output.y4m ...
+//   Rgba：无文件头的RGBA8888帧，ffmpeg -f rawvideo -pix_fmt rgba -s WxH -r FPS -i output.rgba ...
+class Y4mStreamWriter {
+public:
+	enum class Format {
+		Yuv420,
+		Rgba,
+	};
+	~Y4mStreamWriter() { close(); }
+
+	bool open(const QString& path, QSize size, int fps, Format format);
+	bool writeFrame(const uint8_t* data, qsizetype byteCount);
+	void close();
+	bool isOpen() const { return file_.isOpen(); }
+	qsizetype frameBytes() const;
+	qint64 frameCount() const { return frameCount_; }
+private:
+	QFile file_;
+	QSize size_;
+	Format format_ = Format::Yuv420;
+	qint64 frameCount_ = 0;
+};
+
+#endif // Y4mStreamWriter_h__
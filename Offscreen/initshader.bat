@@ -0,0 +1,4 @@
+@REM D:\VulkanSDK\1.3.216.0\Bin\glslangValidator.exe -V quad_vert.vert 
+@REM D:\VulkanSDK\1.3.216.0\Bin\glslangValidator.exe -V quad_frag.frag
+python GlslTranSpv.py
+pause
\ No newline at end of file
@@ -1,8 +1,14 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QGuiApplication>
 #include <QLoggingCategory>
 #include <QVulkanInstance>
 #include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <cstring>
 #include "OffscreenRenderer.h"
+#include "Y4mStreamWriter.h"
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
@@ -14,12 +20,106 @@ public:
 };
 
 int main(int argc, char* argv[]) {
-	QGuiApplication app(argc, argv);
-
 	static vk::DynamicLoader  dynamicLoader;
 	PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dynamicLoader.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
 	VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
 
+	// --headless：不创建窗口，也不需要显示服务器，可用于批处理与CI容器（例如配合lavapipe）
+	if (std::find_if(argv + 1, argv + argc, [](const char* arg) { return strcmp(arg, "--headless") == 0; }) != argv + argc) {
+		QCoreApplication app(argc, argv);
+		QVkHeadlessContext context;
+		context.setLayers({ "VK_LAYER_KHRONOS_validation" });
+		if (!context.create())
+			qFatal("Failed to create headless Vulkan context");
+		OffscreenRenderer renderer(&context);
+		// --frames N：连续渲染N帧并统计持续吞吐量，回读与渲染重叠，最后一帧保存为output.png
+		// --encode png|qoi|raw：同时将每一帧交给编码线程池写到frames目录，队列满时渲染等待编码
+		// --tiled WxH：分块渲染任意尺寸的图像到output.pam，内存占用与分辨率无关
+		// --y4m PATH / --rgba-stream PATH：将--frames帧（默认300）作为原始视频流写到文件或管道，PATH为"-"时写到标准输出
+		int frameCount = 0;
+		QString encodeFormat;
+		QSize tiledSize;
+		QString streamPath;
+		Y4mStreamWriter::Format streamFormat = Y4mStreamWriter::Format::Yuv420;
+		for (int i = 1; i + 1 < argc; i++) {
+			if (strcmp(argv[i], "--frames") == 0)
+				frameCount = QByteArray(argv[i + 1]).toInt();
+			else if (strcmp(argv[i], "--encode") == 0)
+				encodeFormat = argv[i + 1];
+			else if (strcmp(argv[i], "--y4m") == 0 || strcmp(argv[i], "--rgba-stream") == 0) {
+				streamPath = argv[i + 1];
+				streamFormat = strcmp(argv[i], "--y4m") == 0 ? Y4mStreamWriter::Format::Yuv420 : Y4mStreamWriter::Format::Rgba;
+			}
+			else if (strcmp(argv[i], "--tiled") == 0) {
+				const QList<QByteArray> dimensions = QByteArray(argv[i + 1]).split('x');
+				if (dimensions.size() == 2)
+					tiledSize = QSize(dimensions[0].toInt(), dimensions[1].toInt());
+			}
+		}
+		if (!tiledSize.isEmpty()) {
+			QElapsedTimer timer;
+			timer.start();
+			if (!renderer.renderTiled(tiledSize, QColor(0, 100, 200), "output.pam"))
+				qFatal("Failed to write output.pam");
+			qDebug("%dx%d rendered in %.3f s", tiledSize.width(), tiledSize.height(), timer.nsecsElapsed() / 1e9);
+			return 0;
+		}
+		if (!streamPath.isEmpty()) {
+			const QSize size(800, 600);
+			frameCount = frameCount > 0 ? frameCount : 300;
+			Y4mStreamWriter writer;
+			if (!writer.open(streamPath, size, 60, streamFormat))
+				qFatal("Failed to open %s", qPrintable(streamPath));
+			bool ok = true;
+			QElapsedTimer timer;
+			timer.start();
+			for (int i = 0; i < frameCount && ok; i++) {
+				auto callback = [&](const QVkReadbackRing::Frame& frame) {
+					ok = writer.writeFrame(frame.data, frame.byteCount) && ok;
+				};
+				const QColor color = QColor::fromHsv(i % 360, 200, 200);
+				if (streamFormat == Y4mStreamWriter::Format::Yuv420)
+					ok = renderer.renderFrameYuv(size, color, callback) && ok;
+				else
+					renderer.renderFrame(size, color, callback);
+			}
+			renderer.flush();
+			const double seconds = timer.nsecsElapsed() / 1e9;
+			qDebug("%lld frames in %.3f s, %.1f fps, %.1f MB/s", writer.frameCount(), seconds, writer.frameCount() / seconds, writer.frameCount() * writer.frameBytes() / seconds / 1e6);
+			return ok ? 0 : 1;
+		}
+		ImageEncoderPool encoder;
+		if (frameCount > 0) {
+			const ImageEncoderPool::Format format = ImageEncoderPool::formatForFile("frame." + encodeFormat);
+			if (!encodeFormat.isEmpty())
+				QDir().mkpath("frames");
+			uint64_t checksum = 0;
+			QElapsedTimer timer;
+			timer.start();
+			for (int i = 0; i < frameCount; i++) {
+				renderer.renderFrame({ 800,600 }, QColor::fromHsv(i % 360, 200, 200), [&](const QVkReadbackRing::Frame& frame) {
+					checksum += frame.data[(frame.index % frame.size.width()) * 4];		//读取回读数据，模拟CPU侧的消费
+					if (!encodeFormat.isEmpty())
+						encoder.encode(frame.data, frame.size, frame.bytesPerLine(), QString("frames/frame_%1.%2").arg(frame.index, 5, 10, QChar('0')).arg(ImageEncoderPool::suffix(format)), format);
+					if (frame.index == uint64_t(frameCount - 1))
+						encoder.encode(frame.toImage(), "output.png");
+				});
+			}
+			renderer.flush();
+			encoder.waitForDone();
+			const double seconds = timer.nsecsElapsed() / 1e9;
+			qDebug("%d frames in %.3f s, %.1f fps (checksum %llu)", frameCount, seconds, frameCount / seconds, (unsigned long long)checksum);
+			return encoder.failedCount() == 0 ? 0 : 1;
+		}
+		encoder.encode(renderer.createImage({ 800,600 }, QColor(0, 100, 200)), "output.png");
+		encoder.waitForDone();
+		if (encoder.failedCount() > 0)
+			qFatal("Failed to save output.png");
+		return 0;
+	}
+
+	QGuiApplication app(argc, argv);
+
 	QVulkanInstance instance;
 	instance.setLayers({ "VK_LAYER_KHRONOS_validation" });
 	if (!instance.create())
@@ -0,0 +1,28 @@
+#version 450
+
+// 场景只有一个三角形，顶点写在着色器中，不需要顶点缓冲
+vec3 positions[3] = vec3[](
+	vec3(-1.0, -1.0, 0.0),
+	vec3( 1.0, -1.0, 0.0),
+	vec3( 0.0,  1.0, 0.0)
+);
+
+vec3 colors[3] = vec3[](
+	vec3(1.0, 0.0, 0.0),
+	vec3(0.0, 1.0, 0.0),
+	vec3(0.0, 0.0, 1.0)
+);
+
+layout(push_constant) uniform PushConstant {
+	mat4 mvp;			//分块渲染时已左乘tileProjection
+} pushConstant;
+
+layout(location = 0) out vec3 v_color;
+
+out gl_PerVertex { vec4 gl_Position; };
+
+void main()
+{
+	v_color = colors[gl_VertexIndex];
+	gl_Position = pushConstant.mvp * vec4(positions[gl_VertexIndex], 1.0);
+}
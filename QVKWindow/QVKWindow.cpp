@@ -1,5 +1,14 @@
 #include "QVKWindow.h"
 #include <memory>
+#include <typeinfo>
+#include "QVkTraceRecorder.h"
+
+QVkScene::QVkScene(QVkWindow* window)
+	: window_(window)
+	, gpuProfiler_(window)
+	, pipelineStatistics_(window)
+{
+}
 
 void QVkScene::addRenderer(std::shared_ptr<QVkRenderer> renderer)
 {
@@ -17,12 +26,32 @@ void QVkScene::removeRenderer(std::shared_ptr<QVkRenderer> renderer)
 	rendererList_.remove(renderer);
 }
 
+void QVkScene::setOverlay(std::shared_ptr<QVkRenderer> overlay)
+{
+	if (overlay_ && window_->device()) {
+		overlay_->releaseSwapChainResources();
+		overlay_->releaseResources();
+	}
+	overlay_ = overlay;
+	if (overlay_) {
+		overlay_->setWindow(window_);
+		if (window_->device()) {
+			overlay_->initResources();
+			overlay_->initSwapChainResources();
+		}
+	}
+}
+
 void QVkScene::initResources()
 {
+	gpuProfiler_.initResources();
+	pipelineStatistics_.initResources();
 	for (auto& renderer : rendererList_)
 	{
 		renderer->initResources();
 	}
+	if (overlay_)
+		overlay_->initResources();
 }
 
 void QVkScene::releaseResources()
@@ -31,6 +60,10 @@ void QVkScene::releaseResources()
 	{
 		renderer->releaseResources();
 	}
+	if (overlay_)
+		overlay_->releaseResources();
+	gpuProfiler_.releaseResources();
+	pipelineStatistics_.releaseResources();
 }
 
 void QVkScene::initSwapChainResources()
@@ -39,6 +72,8 @@ void QVkScene::initSwapChainResources()
 	{
 		renderer->initSwapChainResources();
 	}
+	if (overlay_)
+		overlay_->initSwapChainResources();
 }
 
 void QVkScene::releaseSwapChainResources()
@@ -46,14 +81,31 @@ void QVkScene::releaseSwapChainResources()
 	for (auto& renderer : rendererList_) {
 		renderer->releaseSwapChainResources();
 	}
+	if (overlay_)
+		overlay_->releaseSwapChainResources();
 }
 
 void QVkScene::startNextFrame()
 {
+	QVkTraceRecorder::Scope frameTrace("QVkScene::startNextFrame");
+	vk::CommandBuffer cmdBuffer = window_->currentCommandBuffer();
+	gpuProfiler_.beginFrame(cmdBuffer);
+	pipelineStatistics_.beginFrame(cmdBuffer);
 	for (auto& renderer : rendererList_)
 	{
+		const char* name = typeid(*renderer).name();
+		QVkTraceRecorder::Scope trace(name);
+		QVkGpuProfiler::Scope scope(&gpuProfiler_, cmdBuffer, name);
+		QVkPipelineStatistics::Scope statistics(&pipelineStatistics_, cmdBuffer, name);
 		renderer->startNextFrame();
 	}
+	pipelineStatistics_.endFrame();
+	if (overlay_) {
+		QVkTraceRecorder::Scope trace("Overlay");
+		QVkGpuProfiler::Scope scope(&gpuProfiler_, cmdBuffer, "Overlay");
+		overlay_->startNextFrame();
+	}
+	gpuProfiler_.endFrame(cmdBuffer);
 
 	window_->frameReady();
 	window_->requestUpdate();
@@ -3,6 +3,8 @@
 #include <qvulkanwindow.h>
 #include <vulkan/vulkan.hpp>
 #include "QFPSCamera.h"
+#include "QVkGpuProfiler.h"
+#include "QVkPipelineStatistics.h"
 
 class QVkWindow;
 
@@ -31,17 +33,23 @@ protected:
 
 class QVkScene : public QVulkanWindowRenderer {
 public:
-	QVkScene(QVkWindow* window) :window_(window) {}
+	QVkScene(QVkWindow* window);
 	void addRenderer(std::shared_ptr<QVkRenderer> renderer);
 	void removeRenderer(std::shared_ptr<QVkRenderer> renderer);
+	void setOverlay(std::shared_ptr<QVkRenderer> overlay);
 	void initResources() override;
 	void releaseResources() override;
 	void initSwapChainResources() override;
 	void releaseSwapChainResources() override;
 	void startNextFrame() override;
+	QVkGpuProfiler* gpuProfiler() { return &gpuProfiler_; }
+	QVkPipelineStatistics* pipelineStatistics() { return &pipelineStatistics_; }
 protected:
 	QVkWindow* window_ = nullptr;
 	std::list<std::shared_ptr<QVkRenderer>> rendererList_;
+	std::shared_ptr<QVkRenderer> overlay_;		//在所有渲染器之后绘制
+	QVkGpuProfiler gpuProfiler_;		//每个渲染器的startNextFrame各为一个区间
+	QVkPipelineStatistics pipelineStatistics_;
 };
 
 class QVkWindow : public QVulkanWindow {
@@ -55,6 +63,18 @@ public:
 	void removeRenderer(std::shared_ptr<QVkRenderer> renderer) {
 		rendererGroup_->removeRenderer(renderer);
 	}
+	// 渲染器可用 QVkGpuProfiler::Scope scope(window_->gpuProfiler(), cmdBuffer, "Name") 细分自己的耗时
+	QVkGpuProfiler* gpuProfiler() {
+		return rendererGroup_->gpuProfiler();
+	}
+	// 例如QVkHudOverlay，始终在所有渲染器之后绘制
+	void setOverlay(std::shared_ptr<QVkRenderer> overlay) {
+		rendererGroup_->setOverlay(overlay);
+	}
+	// 开启后每个渲染器的管线统计写入QVkMetricsRegistry，指标名以渲染器的类型名为前缀
+	void setPipelineStatisticsEnabled(bool enabled) {
+		rendererGroup_->pipelineStatistics()->setEnabled(enabled);
+	}
 	QFpsCamera camera_;
 private:
 	QVulkanWindowRenderer* createRenderer() override {
@@ -0,0 +1,63 @@
+#ifndef QVkHudOverlay_h__
+#define QVkHudOverlay_h__
+
+#include <QElapsedTimer>
+#include <map>
+#include "QVKWindow.h"
+
+struct ImGuiContext;
+
+// 用imgui绘制的性能HUD，通过 QVkWindow::setOverlay 挂到场景上，在所有渲染器之后绘制：
+//   CPU帧间隔、QVkGpuProfiler的整帧与各渲染器（深度为1的区间）耗时、显存占用（VK_EXT_memory_budget）
+//   以及 addMetricPlot 指定的QVkMetricsRegistry指标（例如粒子数），均以滚动曲线显示
+// 顶点与索引由imgui_impl_vulkan写入每个帧槽位各一个的主机可见缓冲区；HUD不接收输入，自身的录制耗时也显示在面板上
+// 使用自己的渲染通道（eLoad）叠加在交换链图像上，只支持单采样的窗口
+// 仓库没有引入implot（3party只跟踪assimp与imgui，3party/implot是空目录），曲线用ImGui::PlotLines绘制
+class QVkHudOverlay : public QVkRenderer {
+public:
+	QVkHudOverlay(int historySize = 240);
+	~QVkHudOverlay();
+
+	void addMetricPlot(const QByteArray& name);
+	void initResources() override;
+	void initSwapChainResources() override;
+	void releaseSwapChainResources() override;
+	void releaseResources() override;
+	void startNextFrame() override;
+private:
+	// 环形缓冲区，offset为最旧样本的位置，与ImGui::PlotLines的values_offset一致
+	struct History {
+		std::vector<float> values;
+		int offset = 0;
+		int count = 0;
+		void push(float value);
+		float last() const;
+		float max() const;
+		float average() const;
+	};
+	void createRenderPass();
+	void uploadFonts();
+	void updateHistories();
+	void updateMemoryUsage();
+	void buildUi();
+	void plot(const char* label, const History& history, const char* unit);
+private:
+	int historySize_;
+	ImGuiContext* context_ = nullptr;
+	bool enabled_ = false;
+	vk::RenderPass renderPass_;
+	vk::DescriptorPool descPool_;
+	QElapsedTimer frameTimer_;
+	QElapsedTimer memoryTimer_;
+	bool memoryBudgetSupported_ = false;
+	double hudCpuMs_ = 0.0;
+	uint64_t lastGpuFrame_ = ~0ull;
+	History cpuFrameMs_;
+	History gpuFrameMs_;
+	History memoryMb_;
+	float memoryBudgetMb_ = 0.0f;
+	std::map<QByteArray, History> passMs_;
+	std::vector<std::pair<QByteArray, History>> metrics_;
+};
+
+#endif // QVkHudOverlay_h__
@@ -0,0 +1,47 @@
+#ifndef QVkMetricsRegistry_h__
+#define QVkMetricsRegistry_h__
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <map>
+#include <mutex>
+
+// 进程内的指标表：按名称累计最新值、最小/最大值与均值，可选地把每个样本追加到CSV（frame,metric,value）。
+// 为指标设置上限后，超出时输出一次警告并记录下来，用于自动发现过度绘制等性能退化
+class QVkMetricsRegistry {
+public:
+	struct Metric {
+		double last = 0.0;
+		double min = 0.0;
+		double max = 0.0;
+		double sum = 0.0;
+		uint64_t count = 0;			//为0表示还没有样本
+		uint64_t frameIndex = 0;	//最新样本所属的帧
+		double mean() const { return count ? sum / count : 0.0; }
+	};
+
+	static QVkMetricsRegistry& instance();
+
+	void record(const QByteArray& name, double value, uint64_t frameIndex);
+	Metric metric(const QByteArray& name) const;
+	QList<QByteArray> names() const;
+	void reset();					//清空样本与已超限的记录，上限保留
+
+	void setLimit(const QByteArray& name, double maxValue);
+	QList<QByteArray> exceededLimits() const;
+
+	bool openCsv(const QString& filePath);
+	void closeCsv();
+private:
+	QVkMetricsRegistry() = default;
+	~QVkMetricsRegistry();
+private:
+	mutable std::mutex mutex_;
+	std::map<QByteArray, Metric> metrics_;
+	std::map<QByteArray, double> limits_;
+	QList<QByteArray> exceededLimits_;
+	QFile csv_;
+};
+
+#endif // QVkMetricsRegistry_h__
@@ -0,0 +1,160 @@
+#include "QVkPipelineStatistics.h"
+#include <QDebug>
+#include "QVkMetricsRegistry.h"
+
+QVkPipelineStatistics::Scope::Scope(QVkPipelineStatistics* statistics, vk::CommandBuffer cmdBuffer, const char* name)
+	: statistics_(statistics)
+	, cmdBuffer_(cmdBuffer)
+	, scope_(statistics ? statistics->beginScope(cmdBuffer, name) : -1)
+{
+}
+
+QVkPipelineStatistics::Scope::~Scope()
+{
+	if (statistics_)
+		statistics_->endScope(cmdBuffer_, scope_);
+}
+
+QVkPipelineStatistics::QVkPipelineStatistics(QVulkanWindow* window, int maxScopes)
+	: window_(window)
+	, maxScopes_(std::max(maxScopes, 1))
+{
+}
+
+QVkPipelineStatistics::~QVkPipelineStatistics()
+{
+	releaseResources();
+}
+
+void QVkPipelineStatistics::initResources()
+{
+	releaseResources();
+	vk::PhysicalDevice physicalDevice = window_->physicalDevice();
+	const vk::PhysicalDeviceFeatures features = physicalDevice.getFeatures();
+	if (!features.pipelineStatisticsQuery) {
+		qWarning() << "QVkPipelineStatistics: pipelineStatisticsQuery is not supported";
+		return;
+	}
+
+	// 查询结果按标志位从低到高排列，表中须保持这一顺序
+	struct Statistic {
+		vk::QueryPipelineStatisticFlagBits flag;
+		const char* name;
+		bool enabled;
+	};
+	const Statistic statistics[] = {
+		{ vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices, "inputAssemblyVertices", true },
+		{ vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives, "inputAssemblyPrimitives", true },
+		{ vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations, "vertexShaderInvocations", true },
+		{ vk::QueryPipelineStatisticFlagBits::eClippingInvocations, "clippingInvocations", true },
+		{ vk::QueryPipelineStatisticFlagBits::eClippingPrimitives, "clippingPrimitives", true },
+		{ vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations, "fragmentShaderInvocations", true },
+		{ vk::QueryPipelineStatisticFlagBits::eTessellationControlShaderPatches, "tessellationControlShaderPatches", bool(features.tessellationShader) },
+		{ vk::QueryPipelineStatisticFlagBits::eTessellationEvaluationShaderInvocations, "tessellationEvaluationShaderInvocations", bool(features.tessellationShader) },
+	};
+	statisticFlags_ = {};
+	statisticNames_.clear();
+	fragmentInvocationIndex_ = -1;
+	for (const Statistic& statistic : statistics) {
+		if (!statistic.enabled)
+			continue;
+		if (statistic.flag == vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations)
+			fragmentInvocationIndex_ = statisticNames_.size();
+		statisticFlags_ |= statistic.flag;
+		statisticNames_.push_back(statistic.name);
+	}
+
+	vk::Device device = window_->device();
+	vk::QueryPoolCreateInfo queryPoolInfo;
+	queryPoolInfo.queryType = vk::QueryType::ePipelineStatistics;
+	queryPoolInfo.pipelineStatistics = statisticFlags_;
+	queryPoolInfo.queryCount = maxScopes_;
+	frames_.resize(window_->concurrentFrameCount());
+	for (FrameSlot& slot : frames_) {
+		slot.pool = device.createQueryPool(queryPoolInfo);
+		slot.scopes.reserve(maxScopes_);
+	}
+	queryData_.resize(maxScopes_ * (statisticNames_.size() + 1));		//每个查询末尾附带可用性标志
+}
+
+void QVkPipelineStatistics::releaseResources()
+{
+	if (frames_.empty())
+		return;
+	vk::Device device = window_->device();
+	for (FrameSlot& slot : frames_)
+		device.destroyQueryPool(slot.pool);
+	frames_.clear();
+	current_ = nullptr;
+	activeScope_ = -1;
+}
+
+void QVkPipelineStatistics::beginFrame(vk::CommandBuffer cmdBuffer)
+{
+	current_ = nullptr;
+	activeScope_ = -1;
+	if (frames_.empty())
+		return;
+	FrameSlot& slot = frames_[window_->currentFrame() % frames_.size()];
+	if (slot.recorded)
+		collect(slot);				//关闭后仍派发在途的结果
+	if (!enabled_)
+		return;
+
+	cmdBuffer.resetQueryPool(slot.pool, 0, maxScopes_);
+	slot.scopes.clear();
+	slot.frameIndex = frameCount_++;
+	slot.size = window_->swapChainImageSize();
+	slot.recorded = true;
+	current_ = &slot;
+}
+
+void QVkPipelineStatistics::endFrame()
+{
+	current_ = nullptr;
+}
+
+int QVkPipelineStatistics::beginScope(vk::CommandBuffer cmdBuffer, const char* name)
+{
+	if (!isRecording() || activeScope_ >= 0 || current_->scopes.size() >= maxScopes_)
+		return -1;				//同一时刻只能有一个管线统计查询处于活动状态
+	activeScope_ = current_->scopes.size();
+	current_->scopes.push_back(name);
+	cmdBuffer.beginQuery(current_->pool, activeScope_, {});
+	return activeScope_;
+}
+
+void QVkPipelineStatistics::endScope(vk::CommandBuffer cmdBuffer, int scope)
+{
+	if (!isRecording() || scope < 0 || scope != activeScope_)
+		return;
+	cmdBuffer.endQuery(current_->pool, scope);
+	activeScope_ = -1;
+}
+
+void QVkPipelineStatistics::collect(FrameSlot& slot)
+{
+	slot.recorded = false;
+	const uint32_t queryCount = slot.scopes.size();
+	if (queryCount == 0)
+		return;
+	const int stride = statisticNames_.size() + 1;
+	vk::Device device = window_->device();
+	const vk::Result result = device.getQueryPoolResults(slot.pool, 0, queryCount, queryCount * stride * sizeof(uint64_t), queryData_.data(), stride * sizeof(uint64_t),
+		vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+	if (result != vk::Result::eSuccess && result != vk::Result::eNotReady)
+		return;
+
+	QVkMetricsRegistry& registry = QVkMetricsRegistry::instance();
+	const double pixelCount = std::max(qint64(slot.size.width()) * slot.size.height(), qint64(1));
+	for (uint32_t i = 0; i < queryCount; i++) {
+		const uint64_t* values = queryData_.data() + i * stride;
+		if (values[stride - 1] == 0)
+			continue;				//未就绪时丢弃，不等待
+		const QByteArray prefix = QByteArray(slot.scopes[i]) + '/';
+		for (int j = 0; j < statisticNames_.size(); j++)
+			registry.record(prefix + statisticNames_[j], double(values[j]), slot.frameIndex);
+		if (fragmentInvocationIndex_ >= 0)
+			registry.record(prefix + "overdraw", values[fragmentInvocationIndex_] / pixelCount, slot.frameIndex);
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef QVkPipelineStatistics_h__
+#define QVkPipelineStatistics_h__
+
+#include <QByteArray>
+#include <QVector>
+#include <QVulkanWindow>
+#include <vulkan\vulkan.hpp>
+
+// 按区间收集管线统计查询（顶点/片段着色器调用次数、裁剪图元数等），结构与QVkGpuProfiler相同：
+// 每个帧槽位一个查询池，区间各占一个查询，槽位再次录制时不等待地读取上一次的结果并写入QVkMetricsRegistry，
+// 指标名为 "<区间名>/<统计项>"，另外记录 "<区间名>/overdraw" = 片段着色器调用次数 / 交换链像素数
+// 区间须在渲染通道之外开始与结束（可以包含完整的渲染通道），且不能嵌套
+class QVkPipelineStatistics {
+public:
+	class Scope {
+	public:
+		Scope(QVkPipelineStatistics* statistics, vk::CommandBuffer cmdBuffer, const char* name);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		QVkPipelineStatistics* statistics_;
+		vk::CommandBuffer cmdBuffer_;
+		int scope_;
+	};
+
+	QVkPipelineStatistics(QVulkanWindow* window, int maxScopes = 64);
+	~QVkPipelineStatistics();
+	QVkPipelineStatistics(const QVkPipelineStatistics&) = delete;
+	QVkPipelineStatistics& operator=(const QVkPipelineStatistics&) = delete;
+
+	void initResources();				//设备不支持pipelineStatisticsQuery时isSupported()返回false
+	void releaseResources();
+
+	void beginFrame(vk::CommandBuffer cmdBuffer);		//须在渲染通道之外调用
+	void endFrame();
+	int beginScope(vk::CommandBuffer cmdBuffer, const char* name);
+	void endScope(vk::CommandBuffer cmdBuffer, int scope);
+
+	void setEnabled(bool enabled) { enabled_ = enabled; }		//默认关闭
+	bool isEnabled() const { return enabled_; }
+	bool isSupported() const { return !frames_.empty(); }
+	const QVector<QByteArray>& statisticNames() const { return statisticNames_; }
+private:
+	struct FrameSlot {
+		vk::QueryPool pool;
+		QVector<const char*> scopes;
+		uint64_t frameIndex = 0;
+		QSize size;
+		bool recorded = false;
+	};
+	bool isRecording() const { return enabled_ && current_ != nullptr; }
+	void collect(FrameSlot& slot);
+private:
+	QVulkanWindow* window_ = nullptr;
+	int maxScopes_;
+	bool enabled_ = false;
+	vk::QueryPipelineStatisticFlags statisticFlags_;
+	QVector<QByteArray> statisticNames_;		//与查询结果中各值的顺序（标志位从低到高）一致
+	int fragmentInvocationIndex_ = -1;
+	std::vector<FrameSlot> frames_;
+	FrameSlot* current_ = nullptr;
+	int activeScope_ = -1;
+	uint64_t frameCount_ = 0;
+	std::vector<uint64_t> queryData_;
+};
+
+#endif // QVkPipelineStatistics_h__
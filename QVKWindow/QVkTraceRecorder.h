@@ -0,0 +1,62 @@
+#ifndef QVkTraceRecorder_h__
+#define QVkTraceRecorder_h__
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "QVkGpuProfiler.h"
+
+#define TRACE_MAX_EVENTS 1000000			//超出后不再记录，避免长时间录制时内存无限增长
+
+// 把CPU区间与GPU区间记录到同一条时间线上，导出为Chrome trace JSON（chrome://tracing 或 ui.perfetto.dev 可直接打开）
+//   CPU区间使用 nowNs() 的主机时钟；GPU区间来自QVkGpuProfiler，已由其换算到同一时钟
+//   未开始录制时Scope只读取一个原子变量，可以常驻在代码中
+class QVkTraceRecorder {
+public:
+	class Scope {
+	public:
+		Scope(const char* name, const char* category = "cpu");
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		const char* name_;
+		const char* category_;
+		int64_t beginNs_;
+	};
+
+	static QVkTraceRecorder& instance();
+	static int64_t nowNs();				//std::chrono::steady_clock，与VK_EXT_calibrated_timestamps的主机时间域一致
+
+	void start();						//清空之前的记录并开始
+	void stop();
+	bool isRecording() const { return recording_.load(std::memory_order_relaxed); }
+
+	void addCpuEvent(const char* name, const char* category, int64_t beginNs, int64_t endNs);
+	void addGpuFrame(const QVkGpuProfiler::FrameResult& result);
+	bool save(const QString& filePath) const;
+	int eventCount() const;
+	int droppedEventCount() const;
+private:
+	QVkTraceRecorder() = default;
+	struct Event {
+		QByteArray name;
+		const char* category;
+		int64_t beginNs;
+		int64_t durationNs;
+		int threadId;					//0为GPU
+		int64_t frameIndex;				//GPU区间所属的帧，CPU区间为-1
+	};
+	void addEvent(Event&& event);
+	static int currentThreadId();
+private:
+	std::atomic<bool> recording_ = false;
+	int64_t startNs_ = 0;
+	mutable std::mutex mutex_;
+	std::vector<Event> events_;
+	int droppedEventCount_ = 0;
+};
+
+#endif // QVkTraceRecorder_h__
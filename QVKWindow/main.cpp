@@ -1,7 +1,12 @@
+#include <QDebug>
 #include <QGuiApplication>
 #include <QLoggingCategory>
 #include <QVulkanInstance>
 #include <vulkan/vulkan.hpp>
+#include <cstring>
+#include "QVkHudOverlay.h"
+#include "QVkMetricsRegistry.h"
+#include "QVkTraceRecorder.h"
 #include "TriangleRenderer.h"
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
@@ -17,16 +22,55 @@ int main(int argc, char* argv[]) {
 
 	QVulkanInstance instance;
 	instance.setLayers({ "VK_LAYER_KHRONOS_validation" });
+	instance.setApiVersion(QVersionNumber(1, 1));			//HUD读取显存预算需要vkGetPhysicalDeviceMemoryProperties2
 	if (!instance.create())
 		qFatal("Failed to create Vulkan instance: %d", instance.errorCode());
 	VULKAN_HPP_DEFAULT_DISPATCHER.init(instance.vkInstance());
 
 	QLoggingCategory::setFilterRules(QStringLiteral("qt.vulkan=true"));
 
+	// --trace PATH：录制CPU与GPU时间线，退出时写出Chrome trace JSON
+	// --metrics-csv PATH：开启每个渲染器的管线统计，逐帧写入CSV，退出时输出各指标的均值
+	// --hud：在场景上叠加性能HUD
+	const char* tracePath = nullptr;
+	const char* metricsPath = nullptr;
+	bool hud = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--hud") == 0)
+			hud = true;
+		if (i + 1 >= argc)
+			break;
+		if (strcmp(argv[i], "--trace") == 0)
+			tracePath = argv[i + 1];
+		else if (strcmp(argv[i], "--metrics-csv") == 0)
+			metricsPath = argv[i + 1];
+	}
+
 	QVkWindow vkWindow;
 	vkWindow.setVulkanInstance(&instance);
 	vkWindow.resize(1024, 768);
+	if (tracePath) {
+		QVkGpuProfiler::enableCalibratedTimestamps(&vkWindow);
+		QVkTraceRecorder::instance().start();
+	}
+	if (metricsPath) {
+		vkWindow.setPipelineStatisticsEnabled(true);
+		QVkMetricsRegistry::instance().openCsv(metricsPath);
+	}
 	vkWindow.addRenderer(std::make_shared<TriangleRenderer>());
+	if (hud)
+		vkWindow.setOverlay(std::make_shared<QVkHudOverlay>());
 	vkWindow.show();
-	return app.exec();
+	const int ret = app.exec();
+	if (tracePath) {
+		QVkTraceRecorder::instance().stop();
+		QVkTraceRecorder::instance().save(tracePath);
+	}
+	if (metricsPath) {
+		QVkMetricsRegistry& registry = QVkMetricsRegistry::instance();
+		registry.closeCsv();
+		for (const QByteArray& name : registry.names())
+			qDebug() << name << "mean:" << registry.metric(name).mean() << "max:" << registry.metric(name).max;
+	}
+	return ret;
 }
\ No newline at end of file
@@ -28,6 +28,7 @@ static float vertexData[] = { // Y up, front = CCW
 
 TriangleRenderer::TriangleRenderer(QVulkanWindow* window)
 	:window_(window)
+	, gpuProfiler_(window)
 {
 	QList<int> sampleCounts = window->supportedSampleCounts();
 	if (!sampleCounts.isEmpty()) {
@@ -174,15 +175,16 @@ void TriangleRenderer::initResources()
 
 	// --------------------------------------------------------------------------------------------
 	vk::QueryPoolCreateInfo queryPoolInfo;
-	// 创建一个用于进行遮挡查询的查询池
+	// 创建一个用于进行遮挡查询的查询池，每个帧槽位一个查询
 	queryPoolInfo.queryType = vk::QueryType::eOcclusion;
-	queryPoolInfo.queryCount = 1;
+	queryPoolInfo.queryCount = window_->concurrentFrameCount();
 	occlusionQueryPool_ = device.createQueryPool(queryPoolInfo);
 
-	// 创建一个用于进行时间戳查询的查询池
-	queryPoolInfo.queryType = vk::QueryType::eTimestamp;
-	queryPoolInfo.queryCount = 2;
-	timestampQueryPool_ = device.createQueryPool(queryPoolInfo);
+	// 时间戳查询由gpuProfiler_管理，在回调中输出延迟若干帧到达的结果
+	gpuProfiler_.initResources();
+	gpuProfiler_.setCallback([](const QVkGpuProfiler::FrameResult& result) {
+		qDebug() << "Timestamp Query FragmentShader Stage : " << result.scopeMs("Triangle") << "ms -- frame : " << result.frameIndex;
+	});
 
 	// 创建一个用于收集管道统计信息的查询池
 	queryPoolInfo.queryType = vk::QueryType::ePipelineStatistics;
@@ -192,8 +194,9 @@ void TriangleRenderer::initResources()
 		vk::QueryPipelineStatisticFlagBits::eClippingInvocations |
 		vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
 		vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
-	queryPoolInfo.queryCount = 6;
+	queryPoolInfo.queryCount = window_->concurrentFrameCount();		//一个查询包含上述6个统计值
 	piplineQueryPool_ = device.createQueryPool(queryPoolInfo);
+	queryValid_.fill(false);
 	// --------------------------------------------------------------------------------------------
 }
 
@@ -215,7 +218,7 @@ void TriangleRenderer::releaseResources() {
 	device.destroyBuffer(vertexBuffer_);
 	device.freeMemory(vertexDevMemory_);
 	device.destroyQueryPool(occlusionQueryPool_);
-	device.destroyQueryPool(timestampQueryPool_);
+	gpuProfiler_.releaseResources();
 	device.destroyQueryPool(piplineQueryPool_);
 }
 
@@ -240,10 +243,30 @@ void TriangleRenderer::startNextFrame()
 	beginInfo.pClearValues = clearValues;
 
 	// ---------------------------------------------------------------------------------------------
-	cmdBuffer.resetQueryPool(occlusionQueryPool_, 0, 1);
-	cmdBuffer.resetQueryPool(timestampQueryPool_, 0,2);
-	cmdBuffer.resetQueryPool(piplineQueryPool_, 0, 6);
-	// device.resetQueryPool(queryPool_,0,1);
+	// QVulkanWindow在录制该帧槽位之前已等待过它上一次提交的fence，此时读取上一次的结果不会阻塞，
+	// 不使用eWait，结果未就绪时直接跳过
+	const int frame = window_->currentFrame();
+	if (queryValid_[frame]) {
+		uint64_t result;
+		if (device.getQueryPoolResults(occlusionQueryPool_, frame, 1, sizeof(uint64_t), &result, sizeof(uint64_t), vk::QueryResultFlagBits::e64) == vk::Result::eSuccess)
+			qDebug() << "Occlusion Query :  " << result;
+
+		uint64_t pipline[6];
+		if (device.getQueryPoolResults(piplineQueryPool_, frame, 1, sizeof(pipline), pipline, sizeof(uint64_t), vk::QueryResultFlagBits::e64) == vk::Result::eSuccess) {
+			qDebug() << "Pipeline Statistics Query : \n"
+				<< "     Input assembly vertex count :         " << pipline[0] << "\n"
+				<< "     Input assembly primitives count :     " << pipline[1] << "\n"
+				<< "     Vertex shader invocations :           " << pipline[2] << "\n"
+				<< "     Clipping stage primitives processed : " << pipline[3] << "\n"
+				<< "     Clipping stage primitives output :    " << pipline[4] << "\n"
+				<< "     Fragment shader invocations           " << pipline[5] << "\n"
+				;
+		}
+	}
+	cmdBuffer.resetQueryPool(occlusionQueryPool_, frame, 1);
+	cmdBuffer.resetQueryPool(piplineQueryPool_, frame, 1);
+	gpuProfiler_.beginFrame(cmdBuffer);			//同样先派发该槽位上一次的时间戳
+	queryValid_[frame] = true;
 	// ---------------------------------------------------------------------------------------------
 
 	cmdBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
@@ -270,46 +293,28 @@ void TriangleRenderer::startNextFrame()
 
 	cmdBuffer.bindVertexBuffers(0, vertexBuffer_, { 0 });
 
-	// 在图形管线的特定阶段记录一个时间戳，将其写入之前创建的时间戳查询池 timestampQueryPool_ 中的指定位置
-	cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eFragmentShader, timestampQueryPool_, 0);
+	// 在图形管线的特定阶段记录一个时间戳，写入gpuProfiler_当前帧槽位的查询池
+	const int scope = gpuProfiler_.beginScope(cmdBuffer, "Triangle", vk::PipelineStageFlagBits::eFragmentShader);
 
 	cmdBuffer.pushConstants<float>(piplineLayout_, pushConstant_.stageFlags, 0, QTime::currentTime().msecsSinceStartOfDay() / 1000.0f);
 
-	cmdBuffer.beginQuery(occlusionQueryPool_, 0, {});	// 启动视锥剔除（Occlusion Culling）查询。
+	cmdBuffer.beginQuery(occlusionQueryPool_, frame, {});	// 启动视锥剔除（Occlusion Culling）查询。
 
-	cmdBuffer.beginQuery(piplineQueryPool_, 0, {});		// 启动管线统计（Pipeline Statistics）查询。
+	cmdBuffer.beginQuery(piplineQueryPool_, frame, {});		// 启动管线统计（Pipeline Statistics）查询。
 
 	cmdBuffer.draw(3, 1, 0, 0);
 
-	cmdBuffer.endQuery(piplineQueryPool_, 0);
+	cmdBuffer.endQuery(piplineQueryPool_, frame);
 
-	cmdBuffer.endQuery(occlusionQueryPool_, 0);
+	cmdBuffer.endQuery(occlusionQueryPool_, frame);
 
-	cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eFragmentShader, timestampQueryPool_, 1);
+	gpuProfiler_.endScope(cmdBuffer, scope, vk::PipelineStageFlagBits::eFragmentShader);
 
 	cmdBuffer.endRenderPass();
 
-	window_->frameReady();
+	gpuProfiler_.endFrame(cmdBuffer);
 
-	uint64_t result;
-
-	device.getQueryPoolResults(occlusionQueryPool_, 0, 1, sizeof(uint64_t), &result, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
-	qDebug() << "Occlusion Query :  " << result;
-
-	uint64_t time[2];
-	device.getQueryPoolResults(timestampQueryPool_, 0, 2, sizeof(time), time, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
-	qDebug() << "Timestamp Query FragmentShader Stage : " << time[1] - time[0] << " -- start : " << time[0];
-
-	uint64_t pipline[6];
-	device.getQueryPoolResults(piplineQueryPool_, 0, 1, sizeof(pipline), pipline, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
-	qDebug() << "Pipeline Statistics Query : \n"
-		<< "     Input assembly vertex count :         " << pipline[0] << "\n"
-		<< "     Input assembly primitives count :     " << pipline[1] << "\n"
-		<< "     Vertex shader invocations :           " << pipline[2] << "\n"
-		<< "     Clipping stage primitives processed : " << pipline[3] << "\n"
-		<< "     Clipping stage primitives output :    " << pipline[4] << "\n"
-		<< "     Fragment shader invocations           " << pipline[5] << "\n"
-		;
+	window_->frameReady();
 
 	window_->requestUpdate();
 }
\ No newline at end of file
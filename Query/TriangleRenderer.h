@@ -3,6 +3,7 @@
 
 #include <QVulkanWindowRenderer>
 #include <vulkan\vulkan.hpp>
+#include "QVkGpuProfiler.h"
 
 class TriangleRenderer : public QVulkanWindowRenderer {
 public:
@@ -27,9 +28,11 @@ private:
 	vk::Pipeline pipline_;
 
 	vk::PushConstantRange pushConstant_;
+	// 遮挡与管线统计查询按帧槽位各占一个查询，槽位再次录制时读取其上一次的结果
 	vk::QueryPool occlusionQueryPool_;
-	vk::QueryPool timestampQueryPool_;
 	vk::QueryPool piplineQueryPool_;
+	std::array<bool, QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT> queryValid_ = {};
+	QVkGpuProfiler gpuProfiler_;
 };
 
 #endif // TriangleRenderer_h__
\ No newline at end of file